@@ -5,6 +5,7 @@
  */
 
 #include <common.h>
+#include <div64.h>
 #include <asm/mipsregs.h>
 
 unsigned long notrace timer_read_counter(void)
@@ -16,3 +17,8 @@ ulong notrace __weak get_tbclk(void)
 {
 	return CONFIG_SYS_MIPS_TIMER_FREQ;
 }
+
+ulong notrace __weak timer_get_boot_us(void)
+{
+	return lldiv(get_ticks(), get_tbclk() / 1000000);
+}
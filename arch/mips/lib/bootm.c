@@ -310,6 +310,9 @@ static void boot_jump_linux(bootm_headers_t *images)
 	bootstage_report();
 #endif
 
+	/* Let the console output go out before the kernel takes the UART */
+	serial_flush();
+
 	/* Restore EBASE for compatibility */
 	set_c0_status(ST0_BEV);
 	write_c0_ebase(KSEG0);
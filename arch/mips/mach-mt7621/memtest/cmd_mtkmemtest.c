@@ -0,0 +1,658 @@
+// SPDX-License-Identifier:	GPL-2.0+
+/*
+ * Copyright (C) 2020 MediaTek Inc. All Rights Reserved.
+ *
+ * Author: Weijie Gao <weijie.gao@mediatek.com>
+ *
+ * Multi-VPE cached DRAM test and DRAM bandwidth/latency benchmark
+ *
+ * Each available VPE works on a slice of the memory range, see ../mp.c for
+ * how the secondary VPEs are dispatched.
+ */
+
+#include <common.h>
+#include <command.h>
+#include <console.h>
+#include <linux/sizes.h>
+#include <asm/addrspace.h>
+#include <asm/cacheops.h>
+#include <asm/mipsregs.h>
+#include <asm/system.h>
+
+#include "../mp.h"
+
+DECLARE_GLOBAL_DATA_PTR;
+
+typedef unsigned long ul;
+
+#define UL_LEN			32
+#define UL_ONEBITS		0xffffffff
+#define CHECKERBOARD1		0x55555555
+#define CHECKERBOARD2		0xaaaaaaaa
+#define UL_BYTE(x)		((x) | (x) << 8 | (x) << 16 | (x) << 24)
+
+#define MP_MAX_VPES		MT7621_MAX_VPES
+#define MP_LOW_RESERVED		SZ_1M
+#define MP_TOP_RESERVED		SZ_1M
+
+#define STREAM_NTIMES		5
+#define STREAM_SCALAR		3
+#define LATENCY_STEPS		(1 << 20)
+
+enum mp_op {
+	MP_OP_PATTERN,
+	MP_OP_STREAM,
+};
+
+enum mp_pattern_type {
+	PAT_ADDR,		/* address, inverted on odd passes */
+	PAT_RANDOM,		/* pseudo-random stream */
+	PAT_SOLID,		/* same value for all words */
+	PAT_ALT,		/* value and its inverse alternately */
+};
+
+enum stream_kernel {
+	STREAM_COPY,
+	STREAM_SCALE,
+	STREAM_ADD,
+	STREAM_TRIAD,
+
+	__STREAM_MAX
+};
+
+struct mp_pattern {
+	const char *name;
+	enum mp_pattern_type type;
+	u32 passes;
+	ul (*value)(u32 pass);
+};
+
+struct mp_job {
+	/* Filled by VPE0 */
+	u32 cpu;
+	enum mp_op op;
+	const struct mp_pattern *pat;
+	enum stream_kernel kernel;
+	ul *start;
+	ul *end;
+	size_t stream_words;
+	u32 l1_size, l1_line;
+	u32 l2_size, l2_line;
+
+	/* Filled by the worker */
+	u32 errors;
+	ul *err_addr;
+	ul err_expected;
+	ul err_actual;
+} __aligned(32);
+
+static struct mp_job mp_jobs[MP_MAX_VPES];
+
+static ul pat_solid_bits(u32 pass)
+{
+	return (pass & 1) ? UL_ONEBITS : 0;
+}
+
+static ul pat_checkerboard(u32 pass)
+{
+	return (pass & 1) ? CHECKERBOARD2 : CHECKERBOARD1;
+}
+
+static ul pat_block_seq(u32 pass)
+{
+	return UL_BYTE(pass);
+}
+
+static ul pat_walk_bit(u32 pass)
+{
+	return 1UL << (pass < UL_LEN ? pass : UL_LEN * 2 - pass - 1);
+}
+
+static ul pat_walk_ones(u32 pass)
+{
+	return pat_walk_bit(pass);
+}
+
+static ul pat_walk_zeroes(u32 pass)
+{
+	return ~pat_walk_bit(pass);
+}
+
+static ul pat_bit_spread(u32 pass)
+{
+	ul v = pat_walk_bit(pass);
+
+	return v | (v << 2);
+}
+
+static ul pat_bit_flip(u32 pass)
+{
+	ul v = 1UL << (pass / 8);
+
+	return (pass & 1) ? ~v : v;
+}
+
+static const struct mp_pattern mp_patterns[] = {
+	{ "Stuck Address", PAT_ADDR, 16, NULL },
+	{ "Random Value", PAT_RANDOM, 4, NULL },
+	{ "Solid Bits", PAT_ALT, 64, pat_solid_bits },
+	{ "Block Sequential", PAT_SOLID, 256, pat_block_seq },
+	{ "Checkerboard", PAT_ALT, 64, pat_checkerboard },
+	{ "Bit Spread", PAT_ALT, UL_LEN * 2, pat_bit_spread },
+	{ "Bit Flip", PAT_ALT, UL_LEN * 8, pat_bit_flip },
+	{ "Walking Ones", PAT_SOLID, UL_LEN * 2, pat_walk_ones },
+	{ "Walking Zeroes", PAT_SOLID, UL_LEN * 2, pat_walk_zeroes },
+};
+
+/*
+ * Helpers below may run on any VPE. They must not touch gd, the console
+ * or anything else which is not SMP-safe.
+ */
+
+static inline u32 mp_xorshift(u32 x)
+{
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	return x;
+}
+
+/* Write back and invalidate the whole L1 D-cache and L2 cache */
+static void mp_flush_caches(const struct mp_job *job)
+{
+	ulong addr;
+
+	for (addr = KSEG0; addr < KSEG0 + job->l1_size; addr += job->l1_line)
+		mips_cache(INDEX_WRITEBACK_INV_D, (void *)addr);
+
+	for (addr = KSEG0; addr < KSEG0 + job->l2_size; addr += job->l2_line)
+		mips_cache(INDEX_WRITEBACK_INV_SD, (void *)addr);
+
+	__asm__ __volatile__("sync" : : : "memory");
+}
+
+static void mp_fill(const struct mp_job *job, u32 pass)
+{
+	const struct mp_pattern *pat = job->pat;
+	ul *p, v, inv;
+	u32 rnd;
+
+	switch (pat->type) {
+	case PAT_ADDR:
+		inv = (pass & 1) ? UL_ONEBITS : 0;
+		for (p = job->start; p < job->end; p++)
+			*p = (ul)p ^ inv;
+		break;
+
+	case PAT_RANDOM:
+		rnd = 0x2545f491 * (pass + 1) + job->cpu;
+		for (p = job->start; p < job->end; p++) {
+			rnd = mp_xorshift(rnd);
+			*p = rnd;
+		}
+		break;
+
+	case PAT_SOLID:
+		v = pat->value(pass);
+		for (p = job->start; p < job->end; p++)
+			*p = v;
+		break;
+
+	case PAT_ALT:
+		v = pat->value(pass);
+		for (p = job->start; p + 1 < job->end; p += 2) {
+			p[0] = v;
+			p[1] = ~v;
+		}
+		if (p < job->end)
+			*p = v;
+		break;
+	}
+}
+
+static void mp_report(struct mp_job *job, ul *p, ul expected)
+{
+	if (!job->errors++) {
+		job->err_addr = p;
+		job->err_expected = expected;
+		job->err_actual = *p;
+	}
+}
+
+static void mp_verify(struct mp_job *job, u32 pass)
+{
+	const struct mp_pattern *pat = job->pat;
+	ul *p, v, inv;
+	u32 rnd;
+
+	switch (pat->type) {
+	case PAT_ADDR:
+		inv = (pass & 1) ? UL_ONEBITS : 0;
+		for (p = job->start; p < job->end; p++)
+			if (*p != ((ul)p ^ inv))
+				mp_report(job, p, (ul)p ^ inv);
+		break;
+
+	case PAT_RANDOM:
+		rnd = 0x2545f491 * (pass + 1) + job->cpu;
+		for (p = job->start; p < job->end; p++) {
+			rnd = mp_xorshift(rnd);
+			if (*p != rnd)
+				mp_report(job, p, rnd);
+		}
+		break;
+
+	case PAT_SOLID:
+		v = pat->value(pass);
+		for (p = job->start; p < job->end; p++)
+			if (*p != v)
+				mp_report(job, p, v);
+		break;
+
+	case PAT_ALT:
+		v = pat->value(pass);
+		for (p = job->start; p < job->end; p++) {
+			if (*p != v)
+				mp_report(job, p, v);
+			v = ~v;
+		}
+		break;
+	}
+}
+
+static void mp_run_pattern(struct mp_job *job)
+{
+	u32 pass;
+
+	for (pass = 0; pass < job->pat->passes; pass++) {
+		mp_fill(job, pass);
+
+		/* Make sure data are read back from DRAM, not from caches */
+		mp_flush_caches(job);
+
+		mp_verify(job, pass);
+	}
+}
+
+static void mp_run_stream(struct mp_job *job)
+{
+	ul *a = job->start, *b = a + job->stream_words;
+	ul *c = b + job->stream_words;
+	size_t i, n = job->stream_words;
+
+	switch (job->kernel) {
+	case STREAM_COPY:
+		for (i = 0; i < n; i++)
+			c[i] = a[i];
+		break;
+	case STREAM_SCALE:
+		for (i = 0; i < n; i++)
+			b[i] = STREAM_SCALAR * c[i];
+		break;
+	case STREAM_ADD:
+		for (i = 0; i < n; i++)
+			c[i] = a[i] + b[i];
+		break;
+	case STREAM_TRIAD:
+		for (i = 0; i < n; i++)
+			a[i] = b[i] + STREAM_SCALAR * c[i];
+		break;
+	default:
+		break;
+	}
+}
+
+static void mp_run_job(struct mp_job *job)
+{
+	switch (job->op) {
+	case MP_OP_PATTERN:
+		mp_run_pattern(job);
+		break;
+	case MP_OP_STREAM:
+		mp_run_stream(job);
+		break;
+	}
+}
+
+static void mp_run_vpe(void *arg, u32 cpu)
+{
+	mp_run_job(&mp_jobs[cpu]);
+}
+
+/*
+ * Code below runs on VPE0 only
+ */
+
+static void mp_init_job(struct mp_job *job, u32 cpu)
+{
+	ulong conf2 = read_c0_config2();
+
+	memset(job, 0, sizeof(*job));
+
+	job->cpu = cpu;
+	job->l1_size = CONFIG_SYS_DCACHE_SIZE;
+	job->l1_line = CONFIG_SYS_DCACHE_LINE_SIZE;
+	job->l2_line = 2 << ((conf2 & MIPS_CONF2_SL) >> MIPS_CONF2_SL_SHF);
+	job->l2_size = (64 << ((conf2 & MIPS_CONF2_SS) >> MIPS_CONF2_SS_SHF)) *
+		       job->l2_line * (((conf2 & MIPS_CONF2_SA) >>
+					MIPS_CONF2_SA_SHF) + 1);
+
+	/* No L2 cache */
+	if (!(conf2 & MIPS_CONF2_SL))
+		job->l2_size = 0;
+}
+
+/* Split [start, end) into equal cache line aligned slices */
+static void mp_split(u32 mask, ul *start, ul *end)
+{
+	u32 cpu, n = hweight32(mask), i = 0;
+	size_t slice;
+
+	slice = ((ulong)end - (ulong)start) / n;
+	slice &= ~(CONFIG_SYS_DCACHE_LINE_SIZE - 1);
+
+	for (cpu = 0; cpu < MP_MAX_VPES; cpu++) {
+		if (!(mask & BIT(cpu)))
+			continue;
+
+		mp_init_job(&mp_jobs[cpu], cpu);
+		mp_jobs[cpu].start = (void *)start + i * slice;
+		mp_jobs[cpu].end = (void *)start + (i + 1) * slice;
+		i++;
+	}
+
+	/* Last slice takes the remainder */
+	mp_jobs[fls(mask) - 1].end = end;
+}
+
+static void mp_dispatch(u32 mask)
+{
+	mt7621_mp_run(mask, mp_run_vpe, NULL);
+}
+
+static int mp_check_range(ulong start, ulong size, ul **pstart, ul **pend)
+{
+	ulong top = CPHYSADDR(gd->start_addr_sp) - MP_TOP_RESERVED;
+
+	start = CPHYSADDR(start);
+
+	if (start < MP_LOW_RESERVED || start + size > top || start >= top ||
+	    size < SZ_64K) {
+		printf("Range must be within [0x%x, 0x%lx)\n", MP_LOW_RESERVED,
+		       top);
+		return -EINVAL;
+	}
+
+	*pstart = (ul *)CKSEG0ADDR(ALIGN(start, CONFIG_SYS_DCACHE_LINE_SIZE));
+	*pend = (ul *)CKSEG0ADDR((start + size) &
+				 ~(CONFIG_SYS_DCACHE_LINE_SIZE - 1));
+
+	return 0;
+}
+
+static void mp_default_range(ulong *start, ulong *size)
+{
+	*start = MP_LOW_RESERVED;
+	*size = CPHYSADDR(gd->start_addr_sp) - MP_TOP_RESERVED - *start;
+}
+
+static int do_memtest_mp(ul *start, ul *end, u32 mask, u32 loops)
+{
+	const struct mp_pattern *pat;
+	u32 loop, cpu, i, errors = 0;
+	ulong ts;
+
+	printf("Testing 0x%08lx - 0x%08lx with %u VPE(s), cached\n",
+	       (ulong)CPHYSADDR(start), (ulong)CPHYSADDR(end), hweight32(mask));
+
+	for (loop = 0; !loops || loop < loops; loop++) {
+		if (loops != 1)
+			printf("Loop %u:\n", loop + 1);
+
+		for (i = 0; i < ARRAY_SIZE(mp_patterns); i++) {
+			pat = &mp_patterns[i];
+
+			printf("  %-20s: ", pat->name);
+
+			mp_split(mask, start, end);
+			for (cpu = 0; cpu < MP_MAX_VPES; cpu++) {
+				mp_jobs[cpu].op = MP_OP_PATTERN;
+				mp_jobs[cpu].pat = pat;
+			}
+
+			ts = get_timer(0);
+			mp_dispatch(mask);
+			ts = get_timer(ts);
+
+			for (cpu = 0; cpu < MP_MAX_VPES; cpu++) {
+				if (!(mask & BIT(cpu)) || !mp_jobs[cpu].errors)
+					continue;
+
+				printf("\n    FAILURE: 0x%08lx != 0x%08lx at physical address 0x%08lx (VPE%u, %u error(s))",
+				       mp_jobs[cpu].err_actual,
+				       mp_jobs[cpu].err_expected,
+				       (ulong)CPHYSADDR(mp_jobs[cpu].err_addr), cpu,
+				       mp_jobs[cpu].errors);
+				errors += mp_jobs[cpu].errors;
+			}
+
+			printf("%s (%lu ms)\n", errors ? "" : "ok", ts);
+
+			if (ctrlc()) {
+				printf("Aborted\n");
+				return CMD_RET_FAILURE;
+			}
+		}
+	}
+
+	printf("Done, %u error(s)\n", errors);
+
+	return errors ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
+
+static void do_stream(ul *start, size_t words, u32 mask)
+{
+	static const char *const names[] = { "Copy", "Scale", "Add", "Triad" };
+	static const u32 words_moved[] = { 2, 2, 3, 3 };
+	u64 best[__STREAM_MAX];
+	u32 cpu, n = hweight32(mask), k, t;
+	ulong us;
+	ul *p;
+
+	mp_split(mask, start, start + words * 3 * n);
+
+	for (cpu = 0; cpu < MP_MAX_VPES; cpu++) {
+		if (!(mask & BIT(cpu)))
+			continue;
+
+		mp_jobs[cpu].op = MP_OP_STREAM;
+		mp_jobs[cpu].stream_words = words;
+
+		for (p = mp_jobs[cpu].start; p < mp_jobs[cpu].end; p++)
+			*p = 1;
+	}
+
+	for (k = 0; k < __STREAM_MAX; k++)
+		best[k] = U64_MAX;
+
+	for (t = 0; t < STREAM_NTIMES; t++) {
+		for (k = 0; k < __STREAM_MAX; k++) {
+			for (cpu = 0; cpu < MP_MAX_VPES; cpu++)
+				mp_jobs[cpu].kernel = k;
+
+			us = timer_get_us();
+			mp_dispatch(mask);
+			us = timer_get_us() - us;
+
+			/* The first run only warms up */
+			if (t && us < best[k])
+				best[k] = us;
+		}
+	}
+
+	printf("  %u VPE(s):", n);
+
+	for (k = 0; k < __STREAM_MAX; k++)
+		printf(" %s %llu MB/s", names[k],
+		       best[k] ? ((u64)words * n * words_moved[k] *
+				  sizeof(ul)) / best[k] : 0);
+
+	printf("\n");
+}
+
+static void do_latency(ul *start, size_t size)
+{
+	u32 line = CONFIG_SYS_DCACHE_LINE_SIZE, n = size / line, i, j, tmp;
+	u32 rnd = 0x12345678;
+	ulong us;
+	void **p;
+
+	/* Sattolo's algorithm: a random single cycle through all lines */
+	for (i = 0; i < n; i++)
+		*(u32 *)((void *)start + i * line) = i;
+
+	for (i = n - 1; i > 0; i--) {
+		rnd = mp_xorshift(rnd);
+		j = rnd % i;
+
+		tmp = *(u32 *)((void *)start + i * line);
+		*(u32 *)((void *)start + i * line) =
+			*(u32 *)((void *)start + j * line);
+		*(u32 *)((void *)start + j * line) = tmp;
+	}
+
+	for (i = 0; i < n; i++)
+		*(void **)((void *)start + i * line) = (void *)start +
+			*(u32 *)((void *)start + i * line) * line;
+
+	/* Warm up */
+	p = (void **)start;
+	for (i = 0; i < n; i++)
+		p = *p;
+
+	us = timer_get_us();
+
+	for (i = 0; i < LATENCY_STEPS; i += 8) {
+		p = *p; p = *p; p = *p; p = *p;
+		p = *p; p = *p; p = *p; p = *p;
+	}
+
+	us = timer_get_us() - us;
+
+	/* Keep the chain alive */
+	if (!p)
+		printf("?");
+
+	printf("  %8u KB: %llu.%llu ns\n", (u32)(size >> 10),
+	       (u64)us * 1000 / LATENCY_STEPS,
+	       ((u64)us * 10000 / LATENCY_STEPS) % 10);
+}
+
+static int do_mtkmemtest(cmd_tbl_t *cmdtp, int flag, int argc,
+			 char *const argv[])
+{
+	ulong start, size, val;
+	ul *pstart, *pend;
+	u32 mask, cpu;
+	size_t words;
+
+	if (argc < 2)
+		return CMD_RET_USAGE;
+
+	mask = mt7621_mp_available();
+	if (mt7621_mp_prepare(mask)) {
+		printf("Failed to allocate stacks for secondary VPEs\n");
+		return CMD_RET_FAILURE;
+	}
+
+	mp_default_range(&start, &size);
+
+	if (!strcmp(argv[1], "test")) {
+		val = 1;
+
+		if (argc >= 4) {
+			start = simple_strtoul(argv[2], NULL, 16);
+			size = simple_strtoul(argv[3], NULL, 16);
+		}
+
+		if (argc >= 5)
+			val = simple_strtoul(argv[4], NULL, 0);
+
+		if (mp_check_range(start, size, &pstart, &pend))
+			return CMD_RET_FAILURE;
+
+		return do_memtest_mp(pstart, pend, mask, val);
+	}
+
+	if (mp_check_range(start, size, &pstart, &pend))
+		return CMD_RET_FAILURE;
+
+	if (!strcmp(argv[1], "bw")) {
+		val = argc >= 3 ? simple_strtoul(argv[2], NULL, 16) : SZ_8M;
+		val &= ~(CONFIG_SYS_DCACHE_LINE_SIZE - 1);
+		words = val / sizeof(ul);
+
+		if (!words || words * 3 * sizeof(ul) * hweight32(mask) >
+		    (ulong)pend - (ulong)pstart) {
+			printf("Array size is too large\n");
+			return CMD_RET_FAILURE;
+		}
+
+		printf("STREAM bandwidth, %lu KB per array:\n", val >> 10);
+
+		/* One VPE, one VPE per core, then all VPEs */
+		do_stream(pstart, words, BIT(0));
+
+		if ((mask & 0x5) == 0x5)
+			do_stream(pstart, words, 0x5);
+
+		if (hweight32(mask) > 1 && mask != 0x5)
+			do_stream(pstart, words, mask);
+
+		return CMD_RET_SUCCESS;
+	}
+
+	if (!strcmp(argv[1], "lat")) {
+		val = argc >= 3 ? simple_strtoul(argv[2], NULL, 16) : SZ_32M;
+
+		if (val > (ulong)pend - (ulong)pstart) {
+			printf("Size is too large\n");
+			return CMD_RET_FAILURE;
+		}
+
+		printf("Load-to-use latency (random access):\n");
+
+		for (size = SZ_16K; size < val; size <<= 2)
+			do_latency(pstart, size);
+
+		do_latency(pstart, val);
+
+		return CMD_RET_SUCCESS;
+	}
+
+	if (!strcmp(argv[1], "info")) {
+		printf("Available VPEs:");
+		for (cpu = 0; cpu < MP_MAX_VPES; cpu++)
+			if (mask & BIT(cpu))
+				printf(" %u", cpu);
+		printf("\nDefault range: 0x%08lx - 0x%08lx\n", start,
+		       start + size);
+		return CMD_RET_SUCCESS;
+	}
+
+	return CMD_RET_USAGE;
+}
+
+U_BOOT_CMD(mtkmemtest, 5, 0, do_mtkmemtest,
+	"MT7621 multi-VPE DRAM test and benchmark",
+	"info\n"
+	"    - show available VPEs and the default test range\n"
+	"mtkmemtest test [<addr> <size> [<loops>]]\n"
+	"    - run memtester patterns through cached KSEG0 on all VPEs\n"
+	"      <loops> = 0 means infinite loop\n"
+	"mtkmemtest bw [<array size>]\n"
+	"    - STREAM copy/scale/add/triad bandwidth (default 8MB arrays)\n"
+	"mtkmemtest lat [<size>]\n"
+	"    - random access latency up to <size> (default 32MB)"
+);
@@ -0,0 +1,199 @@
+// SPDX-License-Identifier:	GPL-2.0+
+/*
+ * Copyright (C) 2020 MediaTek Inc. All Rights Reserved.
+ *
+ * Author: Weijie Gao <weijie.gao@mediatek.com>
+ *
+ * Running code on the secondary VPEs
+ *
+ * All secondary VPEs brought up by cpu_secondary_init() sit in the launch
+ * wait code. They are dispatched through their cpulaunch_t and return to
+ * the wait code when finished.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <parallel.h>
+#include <linux/sizes.h>
+#include <asm/addrspace.h>
+#include <asm/cacheops.h>
+
+#include "launch.h"
+#include "mp.h"
+
+#define MP_STACK_SIZE		SZ_8K
+
+struct mp_call {
+	mt7621_mp_fn fn;
+	void *arg;
+	u32 cpu;
+} __aligned(32);
+
+static struct mp_call mp_calls[MT7621_MAX_VPES];
+static void *mp_stacks[MT7621_MAX_VPES];
+
+static cpulaunch_t *mp_launch_info(u32 cpu)
+{
+	return (cpulaunch_t *)(CKSEG0ADDR(CPULAUNCH) + (cpu << LOG2CPULAUNCH));
+}
+
+/*
+ * VPE0 doesn't share a coherent view of memory with the secondary VPEs.
+ * Those write back and drop their whole L1 D-cache before and after each
+ * call, so they never work on stale lines nor leave dirty lines behind to
+ * be evicted over memory VPE0 has reused.
+ */
+static void mp_flush_dcache_all(void)
+{
+	ulong addr;
+
+	for (addr = KSEG0; addr < KSEG0 + CONFIG_SYS_DCACHE_SIZE;
+	     addr += CONFIG_SYS_DCACHE_LINE_SIZE)
+		mips_cache(INDEX_WRITEBACK_INV_D, (void *)addr);
+
+	__asm__ __volatile__("sync" : : : "memory");
+}
+
+/* Entry of secondary VPEs, jumped to from the launch wait code */
+static void __noreturn mp_vpe_entry(struct mp_call *call)
+{
+	cpulaunch_t *launch;
+	void (*wait_code)(cpulaunch_t *);
+
+	mp_flush_dcache_all();
+
+	launch = mp_launch_info(call->cpu);
+	call->fn(call->arg, call->cpu);
+
+	mp_flush_dcache_all();
+
+	/* Tell VPE0 we're done and go back to the launch wait code */
+	__asm__ __volatile__("sync" : : : "memory");
+	launch->flags = LAUNCH_FREADY;
+	__asm__ __volatile__("sync" : : : "memory");
+
+	wait_code = (void *)CMP_LAUNCH_WAITCODE_IN_RAM;
+	wait_code(launch);
+
+	unreachable();
+}
+
+/*
+ * Code below runs on VPE0 only
+ */
+
+u32 mt7621_mp_available(void)
+{
+	u32 cpu, mask = BIT(0);
+
+	for (cpu = 1; cpu < MT7621_MAX_VPES; cpu++) {
+		if (mp_launch_info(cpu)->flags == LAUNCH_FREADY)
+			mask |= BIT(cpu);
+	}
+
+	return mask;
+}
+
+int mt7621_mp_prepare(u32 mask)
+{
+	u32 cpu;
+
+	for (cpu = 1; cpu < MT7621_MAX_VPES; cpu++) {
+		if (!(mask & BIT(cpu)) || mp_stacks[cpu])
+			continue;
+
+		mp_stacks[cpu] = memalign(ARCH_DMA_MINALIGN, MP_STACK_SIZE);
+		if (!mp_stacks[cpu])
+			return -ENOMEM;
+
+		/* Don't let our old dirty lines land on the stack in use */
+		flush_dcache_range((ulong)mp_stacks[cpu],
+				   (ulong)mp_stacks[cpu] + MP_STACK_SIZE);
+	}
+
+	return 0;
+}
+
+int mt7621_mp_run(u32 mask, mt7621_mp_fn fn, void *arg)
+{
+	cpulaunch_t *launch;
+	u32 cpu;
+	int ret;
+
+	ret = mt7621_mp_prepare(mask);
+	if (ret)
+		return ret;
+
+	for (cpu = 1; cpu < MT7621_MAX_VPES; cpu++) {
+		if (!(mask & BIT(cpu)))
+			continue;
+
+		mp_calls[cpu].fn = fn;
+		mp_calls[cpu].arg = arg;
+		mp_calls[cpu].cpu = cpu;
+		flush_dcache_range((ulong)&mp_calls[cpu],
+				   (ulong)&mp_calls[cpu] + sizeof(mp_calls[cpu]));
+
+		launch = mp_launch_info(cpu);
+		launch->pc = (ulong)mp_vpe_entry;
+		launch->sp = (ulong)mp_stacks[cpu] + MP_STACK_SIZE - 16;
+		launch->gp = 0;
+		launch->a0 = (ulong)&mp_calls[cpu];
+		__asm__ __volatile__("sync" : : : "memory");
+		launch->flags |= LAUNCH_FGO;
+	}
+
+	__asm__ __volatile__("sync" : : : "memory");
+
+	if (mask & BIT(0))
+		fn(arg, 0);
+
+	/* Wait for all secondary VPEs back in the launch wait code */
+	for (cpu = 1; cpu < MT7621_MAX_VPES; cpu++) {
+		if (!(mask & BIT(cpu)))
+			continue;
+
+		launch = mp_launch_info(cpu);
+		while (READ_ONCE(launch->flags) != LAUNCH_FREADY)
+			;
+	}
+
+	return 0;
+}
+
+struct mp_parallel {
+	parallel_fn fn;
+	void *arg;
+	u32 mask;
+};
+
+static void mp_parallel_entry(void *arg, u32 cpu)
+{
+	struct mp_parallel *p = arg;
+
+	/* Workers are numbered in VPE order, VPE0 being worker 0 */
+	p->fn(p->arg, hweight32(p->mask & (BIT(cpu) - 1)), hweight32(p->mask));
+}
+
+uint parallel_workers(void)
+{
+	return hweight32(mt7621_mp_available());
+}
+
+uint run_parallel(parallel_fn fn, void *arg)
+{
+	struct mp_parallel p = {
+		.fn = fn,
+		.arg = arg,
+		.mask = mt7621_mp_available(),
+	};
+
+	flush_dcache_range((ulong)&p, (ulong)&p + sizeof(p));
+
+	if (mt7621_mp_run(p.mask, mp_parallel_entry, &p)) {
+		fn(arg, 0, 1);
+		return 1;
+	}
+
+	return hweight32(p.mask);
+}
@@ -0,0 +1,28 @@
+/* SPDX-License-Identifier:	GPL-2.0+ */
+/*
+ * Running code on the secondary VPEs of MT7621
+ */
+
+#ifndef _MT7621_MP_H_
+#define _MT7621_MP_H_
+
+#include <linux/types.h>
+
+#define MT7621_MAX_VPES		4
+
+typedef void (*mt7621_mp_fn)(void *arg, u32 cpu);
+
+/* Mask of VPEs which are idle in the launch wait code, VPE0 included */
+u32 mt7621_mp_available(void);
+
+/* Allocate the stacks of the secondary VPEs in @mask */
+int mt7621_mp_prepare(u32 mask);
+
+/*
+ * Run @fn on all VPEs in @mask, VPE0 included, and wait for all of them to
+ * finish. Secondary VPEs return to the launch wait code afterwards so that
+ * the OS can still bring them up.
+ */
+int mt7621_mp_run(u32 mask, mt7621_mp_fn fn, void *arg);
+
+#endif /* _MT7621_MP_H_ */
@@ -16,6 +16,8 @@ void _machine_restart(void)
 	void __iomem *base;
 	u32 mask;
 
+	serial_flush();
+
 	base = (void __iomem *) CKSEG1ADDR(MT7621_SYSCTL_BASE);
 
 	mask = REG_MASK(MCM_RST) |
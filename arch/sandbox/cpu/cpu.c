@@ -8,6 +8,7 @@
 #include <errno.h>
 #include <linux/libfdt.h>
 #include <os.h>
+#include <parallel.h>
 #include <asm/io.h>
 #include <asm/setjmp.h>
 #include <asm/state.h>
@@ -115,6 +116,21 @@ void invalidate_dcache_range(unsigned long start, unsigned long stop)
 {
 }
 
+/* Host threads standing in for secondary CPUs */
+#define SANDBOX_PARALLEL_WORKERS	4
+
+uint parallel_workers(void)
+{
+	return SANDBOX_PARALLEL_WORKERS;
+}
+
+uint run_parallel(parallel_fn fn, void *arg)
+{
+	os_run_parallel(fn, arg, SANDBOX_PARALLEL_WORKERS);
+
+	return SANDBOX_PARALLEL_WORKERS;
+}
+
 int sandbox_read_fdt_from_file(void)
 {
 	struct sandbox_state *state = state_get_current();
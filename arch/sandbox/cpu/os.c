@@ -7,6 +7,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
+#include <pthread.h>
 #include <setjmp.h>
 #include <stdio.h>
 #include <stdint.h>
@@ -651,3 +652,46 @@ void os_longjmp(ulong *jmp, int ret)
 {
 	longjmp((struct __jmp_buf_tag *)jmp, ret);
 }
+
+struct os_thread {
+	pthread_t thread;
+	void (*fn)(void *arg, unsigned int worker, unsigned int nworkers);
+	void *arg;
+	unsigned int worker, nworkers;
+};
+
+static void *os_thread_entry(void *data)
+{
+	struct os_thread *t = data;
+
+	t->fn(t->arg, t->worker, t->nworkers);
+
+	return NULL;
+}
+
+void os_run_parallel(void (*fn)(void *arg, unsigned int worker,
+				unsigned int nworkers),
+		     void *arg, unsigned int nworkers)
+{
+	struct os_thread threads[nworkers];
+	bool started[nworkers];
+	unsigned int i;
+
+	for (i = 1; i < nworkers; i++) {
+		threads[i].fn = fn;
+		threads[i].arg = arg;
+		threads[i].worker = i;
+		threads[i].nworkers = nworkers;
+		started[i] = !pthread_create(&threads[i].thread, NULL,
+					     os_thread_entry, &threads[i]);
+	}
+
+	fn(arg, 0, nworkers);
+
+	for (i = 1; i < nworkers; i++) {
+		if (started[i])
+			pthread_join(threads[i].thread, NULL);
+		else
+			fn(arg, i, nworkers);
+	}
+}
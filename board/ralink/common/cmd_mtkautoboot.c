@@ -6,7 +6,11 @@
  */
 
 #include <common.h>
+#include <environment.h>
+#include <scratch.h>
+#include <usb.h>
 #include <asm-generic/gpio.h>
+#include <u-boot/crc.h>
 
 struct mtk_bootmenu_entry {
 	const char *desc;
@@ -67,6 +71,61 @@ static inline void mtkledblink(void)
 }
 #endif
 
+#ifdef CONFIG_MTK_USB_RECOVERY
+extern int write_firmware_failsafe(size_t data_addr, uint32_t data_size);
+extern char usb_started;
+
+#define USB_RECOVERY_SCRATCH	"usb recovery"
+
+/* Flash the firmware file from a USB stick, unless it was already done */
+static void mtkusbrecovery(void)
+{
+	bool started = usb_started;
+	phys_size_t max;
+	const char *name;
+	void *buf;
+	loff_t size;
+	u32 crc;
+	int ret;
+
+	buf = scratch_alloc_max(USB_RECOVERY_SCRATCH, &max);
+	if (!buf)
+		return;
+
+	name = env_get("usb_recovery.file");
+	if (!name)
+		name = CONFIG_MTK_USB_RECOVERY_FILE;
+
+	ret = usb_stor_load_file(name, (ulong)buf, max, &size);
+
+	/* Leave USB running if someone else started it */
+	if (!started)
+		usb_stop();
+
+	if (ret)
+		goto out;
+
+	scratch_shrink(USB_RECOVERY_SCRATCH, size);
+
+	crc = crc32(0, buf, size);
+	if (crc == env_get_hex("usb_recovery.crc", 0)) {
+		printf("Firmware from USB has already been flashed\n");
+		goto out;
+	}
+
+	printf("Flashing firmware from USB\n");
+
+	if (write_firmware_failsafe((size_t)buf, size))
+		goto out;
+
+	env_set_hex("usb_recovery.crc", crc);
+	env_save();
+
+out:
+	scratch_free(USB_RECOVERY_SCRATCH);
+}
+#endif
+
 static int do_mtkautoboot(cmd_tbl_t *cmdtp, int flag, int argc,
 	char *const argv[])
 {
@@ -78,6 +137,7 @@ static int do_mtkautoboot(cmd_tbl_t *cmdtp, int flag, int argc,
 	u32 delay = CONFIG_MTKAUTOBOOT_DELAY;
 
 #ifdef CONFIG_FAILSAFE_ON_BUTTON
+	bootstage_start(BOOTSTAGE_ID_ACCUM_WAIT, "wait");
 #ifdef MT7621_BUTTON_WPS
 	for (i = 0; i < 5; i++) {
 #else
@@ -88,6 +148,7 @@ static int do_mtkautoboot(cmd_tbl_t *cmdtp, int flag, int argc,
 
 		mtkledblink();
 	}
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_WAIT);
 
 #ifdef MT7621_BUTTON_WPS
 	if (i == 5) {
@@ -99,12 +160,14 @@ static int do_mtkautoboot(cmd_tbl_t *cmdtp, int flag, int argc,
 	}
 
 #ifdef MT7621_BUTTON_WPS
+	bootstage_start(BOOTSTAGE_ID_ACCUM_WAIT, "wait");
 	for (i = 0; i < 5; i++) {
 		if (gpio_get_value(MT7621_BUTTON_WPS) != 0)
 			break;
 
 		mtkledblink();
 	}
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_WAIT);
 	if (i == 5) {
 		printf("Enter TFTP download mode by pressing WPS button\n");
 #else
@@ -116,6 +179,10 @@ static int do_mtkautoboot(cmd_tbl_t *cmdtp, int flag, int argc,
 	}
 #endif // CONFIG_FAILSAFE_ON_BUTTON
 
+#ifdef CONFIG_MTK_USB_RECOVERY
+	mtkusbrecovery();
+#endif
+
 	for (i = 0; i < ARRAY_SIZE(bootmenu_entries); i++) {
 		snprintf(key, sizeof(key), "bootmenu_%d", i);
 		snprintf(val, sizeof(val), "%s=%s",
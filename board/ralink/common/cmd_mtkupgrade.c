@@ -11,14 +11,24 @@
 #include <cli.h>
 #include <div64.h>
 #include <environment.h>
+#include <hash.h>
+#include <scratch.h>
 #include <xyzModem.h>
+#include <serial_stream.h>
+#include <usb.h>
 #include <asm/reboot.h>
+#include <asm/unaligned.h>
 #include <linux/mtd/mtd.h>
 #include <linux/sizes.h>
 #include <jffs2/jffs2.h>
+#include <net/tftp.h>
 
 #include "spl_helper.h"
 #include "flash_helper.h"
+#include "flash_diff.h"
+#include "dual_image.h"
+
+DECLARE_GLOBAL_DATA_PTR;
 
 #define BUF_SIZE 1024
 
@@ -34,6 +44,18 @@ enum file_type {
 	TYPE_FW
 };
 
+enum data_crc_status {
+	DATA_CRC_UNKNOWN,
+	DATA_CRC_OK,
+	DATA_CRC_BAD
+};
+
+/* Legacy image data CRC of the loaded data, if checked while loading */
+static enum data_crc_status loaded_data_crc;
+
+/* Size of the scratch region the data is loaded to, 0 if there is none */
+static phys_size_t data_load_max;
+
 static void cli_highlight_input(const char *prompt)
 {
 	printf(COLOR_INPUT "%s" COLOR_NORMAL " ", prompt);
@@ -97,11 +119,52 @@ static int env_update(const char *varname, const char *defval,
 }
 
 #ifdef CONFIG_CMD_TFTPBOOT
+#ifdef CONFIG_NET_RX_HASH
+/* Called once the legacy image header has been stored */
+static void tftp_image_hash_start(struct hash_stream *hs)
+{
+	const image_header_t *hdr = hs->priv;
+
+	if (!image_check_magic(hdr) || !image_check_hcrc(hdr)) {
+		/* Not a legacy image, nothing to check */
+		hs->broken = true;
+		return;
+	}
+
+	hs->len = image_get_data_size(hdr);
+}
+
+static void tftp_image_hash_check(struct hash_stream *hs)
+{
+	const image_header_t *hdr = hs->priv;
+	u8 dcrc[4];
+
+	if (hash_stream_finish(hs, dcrc, sizeof(dcrc)))
+		return;
+
+	if (!hs->len || hs->hashed != hs->len)
+		return;
+
+	if (get_unaligned_be32(dcrc) == image_get_dcrc(hdr)) {
+		loaded_data_crc = DATA_CRC_OK;
+		printf("Image data CRC verified while loading\n");
+	} else {
+		loaded_data_crc = DATA_CRC_BAD;
+		printf(COLOR_ERROR "*** Image data CRC mismatch! ***"
+		       COLOR_NORMAL "\n");
+	}
+}
+#endif
+
 static int load_tftp(size_t addr, uint32_t *data_size, const char *env_name)
 {
 	char file_name[CONFIG_SYS_CBSIZE + 1];
 	const char *save_tftp_info;
 	uint32_t size;
+#ifdef CONFIG_NET_RX_HASH
+	struct hash_stream hs;
+	int hashing;
+#endif
 
 	if (env_update("ipaddr", __stringify(CONFIG_IPADDR),
 		       "Input U-Boot's IP address:", NULL, 0))
@@ -125,7 +188,29 @@ static int load_tftp(size_t addr, uint32_t *data_size, const char *env_name)
 	copy_filename(net_boot_file_name, file_name,
 		      sizeof(net_boot_file_name));
 
+#ifdef CONFIG_NET_RX_HASH
+	/* Check the data CRC of a legacy image while it is being received */
+	hashing = !hash_stream_start(&hs, "crc32", sizeof(image_header_t));
+	if (hashing) {
+		hs.start = tftp_image_hash_start;
+		hs.priv = (void *)addr;
+		tftp_set_rx_hash(&hs);
+	}
+#endif
+
 	size = net_loop(TFTPGET);
+
+#ifdef CONFIG_NET_RX_HASH
+	if (hashing) {
+		tftp_set_rx_hash(NULL);
+
+		if ((int) size >= 0)
+			tftp_image_hash_check(&hs);
+		else
+			hash_stream_abort(&hs);
+	}
+#endif
+
 	if ((int) size < 0) {
 		printf("\n" COLOR_ERROR "*** TFTP client failure: %d ***"
 		       COLOR_NORMAL "\n", size);
@@ -146,6 +231,18 @@ static int load_tftp(size_t addr, uint32_t *data_size, const char *env_name)
 }
 #endif
 
+/* Room for the data loaded at @addr */
+static size_t load_max_size(size_t addr)
+{
+	ulong top = gd->start_addr_sp - SZ_1M;
+
+	if (data_load_max)
+		return data_load_max;
+
+	/* Everything up to the stack, leaving room for it to grow */
+	return top > addr ? top - addr : 0;
+}
+
 static int getcymodem(void)
 {
 	if (tstc())
@@ -197,6 +294,66 @@ static int load_ymodem(size_t addr, uint32_t *data_size, const char *env_name)
 	return load_xymodem(xyzModem_ymodem, addr, data_size);
 }
 
+#ifdef CONFIG_SERIAL_STREAM
+static int load_serial_stream(size_t addr, uint32_t *data_size,
+			      const char *env_name)
+{
+	size_t size = 0;
+	int ret;
+
+	printf(COLOR_PROMPT "*** Starting serial stream transmitting ***"
+	       COLOR_NORMAL "\n\n");
+	printf("Run tools/serial_stream.py on the host, or press Ctrl-C to "
+	       "abort\n");
+
+	ret = serial_stream_receive((void *) addr, load_max_size(addr), &size,
+				    0);
+	if (ret) {
+		printf("\n" COLOR_ERROR "*** Serial stream error: %d ***"
+		       COLOR_NORMAL "\n", ret);
+		printf("*** Operation Aborted! ***\n");
+		return CMD_RET_FAILURE;
+	}
+
+	printf("Loaded %zu bytes\n", size);
+
+	if (data_size)
+		*data_size = size;
+
+	return CMD_RET_SUCCESS;
+}
+#endif
+
+#ifdef CONFIG_USB_STORAGE_LOAD
+static int load_usb(size_t addr, uint32_t *data_size, const char *env_name)
+{
+	char file_name[CONFIG_SYS_CBSIZE + 1];
+	loff_t size;
+	int ret;
+
+	if (env_update(env_name, "", "Input file name:",
+		       file_name, sizeof(file_name)))
+		return CMD_RET_FAILURE;
+
+	printf("\n");
+
+	ret = usb_stor_load_file(file_name, addr, load_max_size(addr), &size);
+	usb_stop();
+
+	if (ret) {
+		printf("\n" COLOR_ERROR "*** USB storage error: %d ***"
+		       COLOR_NORMAL "\n", ret);
+		printf("*** Operation Aborted! ***\n");
+		return CMD_RET_FAILURE;
+	}
+
+	if (data_size)
+		*data_size = size;
+
+	return CMD_RET_SUCCESS;
+}
+#endif
+
 static int load_kermit(size_t addr, uint32_t *data_size, const char *env_name)
 {
 	char *argv[] = { "loadb", NULL, NULL };
@@ -273,6 +430,18 @@ struct load_method {
 		.name = "Ymodem",
 		.load_func = load_ymodem
 	},
+#ifdef CONFIG_SERIAL_STREAM
+	{
+		.name = "Serial stream (fast)",
+		.load_func = load_serial_stream
+	},
+#endif
+#ifdef CONFIG_USB_STORAGE_LOAD
+	{
+		.name = "USB storage",
+		.load_func = load_usb
+	},
+#endif
 	{
 		.name = "Kermit",
 		.load_func = load_kermit
@@ -314,6 +483,8 @@ static int load_data(size_t addr, uint32_t *data_size, const char *env_name)
 		return CMD_RET_FAILURE;
 	}
 
+	loaded_data_crc = DATA_CRC_UNKNOWN;
+
 	if (load_methods[i].load_func(addr, data_size, env_name))
 		return CMD_RET_FAILURE;
 
@@ -677,7 +848,12 @@ do_write_bl_single:
 static int _write_firmware(void *flash, size_t data_addr, uint32_t data_size,
 			   int no_prompt)
 {
+#ifdef CONFIG_MTK_UPGRADE_DIFF_WRITE
+	struct flash_diff_stats st;
+	ulong start;
+#else
 	uint32_t erase_size;
+#endif
 	uint64_t part_off, part_size, tmp;
 	int ret;
 
@@ -711,6 +887,27 @@ static int _write_firmware(void *flash, size_t data_addr, uint32_t data_size,
 
 	printf("\n");
 
+#ifdef CONFIG_MTK_UPGRADE_DIFF_WRITE
+	memset(&st, 0, sizeof(st));
+	start = get_timer(0);
+
+	printf("Updating from 0x%x to 0x%llx, size 0x%x ... ", data_addr,
+	       part_off, data_size);
+
+	ret = flash_diff_write(flash, part_off, (void *)data_addr, data_size,
+			       &st);
+
+	if (ret) {
+		printf("Fail\n");
+		printf(COLOR_ERROR "*** Flash update [%llx-%llx] failed! ***"
+		       COLOR_NORMAL "\n", part_off, part_off + data_size - 1);
+		return CMD_RET_FAILURE;
+	}
+
+	printf("OK (%lu ms)\n", get_timer(start));
+
+	flash_diff_print_stats(&st);
+#else
 	erase_size = ALIGN(data_size, mtk_board_get_flash_erase_size(flash));
 
 	printf("Erasing from 0x%llx to 0x%llx, size 0x%x ... ", part_off,
@@ -741,10 +938,15 @@ static int _write_firmware(void *flash, size_t data_addr, uint32_t data_size,
 	}
 
 	printf("OK\n");
+#endif
 
 	printf("\n" COLOR_PROMPT "*** Firmware upgrade completed! ***"
 	       COLOR_NORMAL "\n");
 
+#ifdef CONFIG_MTK_DUAL_IMAGE_MANIFEST
+	dual_image_update_manifest(flash, (void *)data_addr, data_size);
+#endif
+
 #ifdef CONFIG_MTK_DUAL_IMAGE_SUPPORT
 	if (!get_mtd_part_info(CONFIG_MTK_DUAL_IMAGE_PARTNAME_BACKUP,
 			      &part_off, &part_size)) {
@@ -923,18 +1125,32 @@ static int do_mtkupgrade(cmd_tbl_t *cmdtp, int flag, int argc,
 	else if (ft == TYPE_FW)
 		run = confirm_yes("Run firmware after upgrading? (Y/n):");
 
-	data_load_addr = CONFIG_SYS_LOAD_ADDR;
+	/* All free memory until the size of the data is known */
+	data_load_addr = (size_t) scratch_alloc_max("upgrade", &data_load_max);
+	if (!data_load_addr)
+		return CMD_RET_FAILURE;
 
 	/* Load data */
 	if (load_data(data_load_addr, &data_size, env_name) != CMD_RET_SUCCESS)
-		return CMD_RET_FAILURE;
+		goto fail;
+
+	scratch_shrink("upgrade", data_size);
 
 	printf("\n" COLOR_PROMPT "*** Loaded %d (0x%x) bytes at 0x%08x ***"
 	       COLOR_NORMAL "\n\n", data_size, data_size, data_load_addr);
 
+	if (loaded_data_crc == DATA_CRC_BAD) {
+		printf(COLOR_ERROR "*** Operation Aborted! ***"
+		       COLOR_NORMAL "\n");
+		goto fail;
+	}
+
 	/* Write data */
 	if (write_data(ft, data_load_addr, data_size) != CMD_RET_SUCCESS)
-		return CMD_RET_FAILURE;
+		goto fail;
+
+	scratch_free("upgrade");
+	data_load_max = 0;
 
 	if (run) {
 		puts("\n");
@@ -948,6 +1164,12 @@ static int do_mtkupgrade(cmd_tbl_t *cmdtp, int flag, int argc,
 	}
 
 	return CMD_RET_SUCCESS;
+
+fail:
+	scratch_free("upgrade");
+	data_load_max = 0;
+
+	return CMD_RET_FAILURE;
 }
 
 U_BOOT_CMD(mtkupgrade, 2, 0, do_mtkupgrade,
@@ -963,8 +1185,8 @@ static int run_image(size_t data_addr, uint32_t data_size)
 {
 	char *uimage_ptr;
 	char *argv[2], str[64];
-	const char *ep;
-	int ret;
+	const char *ep, *vp = NULL;
+	int ret, verified = 0;
 	struct image_header hdr;
 
 	/* Check for SPL bootloader first */
@@ -979,6 +1201,9 @@ static int run_image(size_t data_addr, uint32_t data_size)
 		memcpy(uimage_ptr, &hdr, sizeof(hdr));
 	} else {
 		uimage_ptr = (void *) data_addr;
+
+		/* Data CRC has been checked while loading */
+		verified = loaded_data_crc == DATA_CRC_OK;
 	}
 
 	ep = env_get("autostart");
@@ -986,6 +1211,15 @@ static int run_image(size_t data_addr, uint32_t data_size)
 		ep = strdup(ep);
 
 	env_set("autostart", "yes");
+
+	if (verified) {
+		vp = env_get("verify");
+		if (vp)
+			vp = strdup(vp);
+
+		env_set("verify", "no");
+	}
+
 	sprintf(str, "0x%p", uimage_ptr);
 	argv[0] = "bootm";
 	argv[1] = str;
@@ -997,6 +1231,11 @@ static int run_image(size_t data_addr, uint32_t data_size)
 	} else
 		env_set("autostart", "");
 
+	if (verified) {
+		env_set("verify", vp);
+		free((void *) vp);
+	}
+
 	return ret;
 }
 
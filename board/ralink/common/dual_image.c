@@ -8,16 +8,26 @@
 #include <common.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include <environment.h>
 #include <image.h>
 #include <div64.h>
+#include <malloc.h>
+#include <scratch.h>
+#include <u-boot/crc.h>
+#include <linux/kernel.h>
 #include <linux/sizes.h>
 #include <linux/mtd/mtd.h>
 #include <jffs2/jffs2.h>
 
 #include "flash_helper.h"
+#include "flash_diff.h"
 
 #define SQUASHFS_MAGIC		0x73717368
 
+#define COPY_WINDOW_SIZE	SZ_1M
+
+#define VERIFY_SCRATCH		"image verify"
+
 struct squashfs_super_block {
 	__le32 s_magic;
 	__le32 pad0[9];
@@ -42,6 +52,13 @@ static int verify_legacy_image(void *flash, uint64_t offset, uint64_t maxsize,
 		return 1;
 	}
 
+	/* Grow the header buffer to hold the whole image */
+	load_addr = scratch_alloc(VERIFY_SCRATCH, size);
+	if (!load_addr)
+		return -ENOMEM;
+
+	hdr = load_addr;
+
 	ret = mtk_board_flash_read(flash, offset, size, load_addr);
 	if (ret) {
 		if (ret == -EBADMSG) {
@@ -77,6 +94,11 @@ static int verify_fit_image(void *flash, uint64_t offset, uint64_t maxsize,
 		return 1;
 	}
 
+	/* Grow the header buffer to hold the whole image */
+	load_addr = scratch_alloc(VERIFY_SCRATCH, size);
+	if (!load_addr)
+		return -ENOMEM;
+
 	ret = mtk_board_flash_read(flash, offset, size, load_addr);
 	if (ret) {
 		if (ret == -EBADMSG) {
@@ -110,36 +132,47 @@ static int verify_image(void *flash, uint64_t offset, uint64_t maxsize,
 	void *load_addr;
 	int ret;
 
-#if defined(CONFIG_LOADADDR)
-	load_addr = (void *)CONFIG_LOADADDR;
-#elif defined(CONFIG_SYS_LOAD_ADDR)
-	load_addr = (void *)CONFIG_SYS_LOAD_ADDR;
-#endif
+	/*
+	 * Only the header is needed to find out the image size. The buffer
+	 * is grown to the real image size once it has been validated.
+	 */
+	load_addr = scratch_alloc(VERIFY_SCRATCH, sizeof(image_header_t));
+	if (!load_addr)
+		return -ENOMEM;
 
 	ret = mtk_board_flash_read(flash, offset, sizeof(image_header_t),
 				   load_addr);
 	if (ret) {
 		if (ret == -EBADMSG) {
 			printf("Image data has uncorrectable ECC error\n");
-			return 1;
+			ret = 1;
+		} else {
+			printf("Fatal: failed to read image data\n");
+			ret = -EIO;
 		}
-		printf("Fatal: failed to read image data\n");
-		return -EIO;
+		goto out;
 	}
 
 	switch (genimg_get_format(load_addr)) {
 	case IMAGE_FORMAT_LEGACY:
-		return verify_legacy_image(flash, offset, maxsize, load_addr,
-					   image_size);
+		ret = verify_legacy_image(flash, offset, maxsize, load_addr,
+					  image_size);
+		break;
 #if defined(CONFIG_FIT)
 	case IMAGE_FORMAT_FIT:
-		return verify_fit_image(flash, offset, maxsize, load_addr,
-					image_size);
+		ret = verify_fit_image(flash, offset, maxsize, load_addr,
+				       image_size);
+		break;
 #endif
 	default:
 		printf("Invalid image format\n");
-		return 1;
+		ret = 1;
 	}
+
+out:
+	scratch_free(VERIFY_SCRATCH);
+
+	return ret;
 }
 
 static int verify_squashfs(void *flash, uint64_t offset, uint64_t end,
@@ -222,26 +255,36 @@ static int verify_rootfs(void *flash, uint64_t offset, uint64_t maxsize,
 	return 1;
 }
 
+/*
+ * Sync the destination with the source block by block. Blocks already
+ * holding the same data are skipped, and only the pages with data are
+ * programmed for the others. Source data is read in windows of several
+ * blocks to cut down the per-request overhead.
+ */
 static int copy_firmware(void *flash, uint64_t src_offset, uint64_t dst_offset,
 			 uint64_t size, bool deadc0de)
 {
-	size_t sizeleft = size, chunksz, erasesize;
+	size_t sizeleft = size, chunksz, erasesize, winsz, pos;
+	struct flash_diff_stats st;
 	uint64_t addr = dst_offset;
 	uint8_t *buff, *verify;
+	u32 skipped;
 	int ret;
 
-#if defined(CONFIG_LOADADDR)
-	buff = (uint8_t *)CONFIG_LOADADDR;
-#elif defined(CONFIG_SYS_LOAD_ADDR)
-	buff = (uint8_t *)CONFIG_SYS_LOAD_ADDR;
-#endif
-
 	erasesize = mtk_board_get_flash_erase_size(flash);
-	verify = buff + erasesize;
+	winsz = max_t(size_t, COPY_WINDOW_SIZE / erasesize, 1) * erasesize;
+
+	buff = scratch_alloc("image copy", 2 * winsz);
+	if (!buff)
+		return -ENOMEM;
+
+	verify = buff + winsz;
+
+	memset(&st, 0, sizeof(st));
 
 	while (sizeleft) {
-		if (sizeleft > erasesize)
-			chunksz = erasesize;
+		if (sizeleft > winsz)
+			chunksz = winsz;
 		else
 			chunksz = sizeleft;
 
@@ -251,60 +294,551 @@ static int copy_firmware(void *flash, uint64_t src_offset, uint64_t dst_offset,
 				printf("Source image data has uncorrectable ECC error\n");
 			else
 				printf("Fatal: failed to read src image data\n");
-			return -EIO;
+			ret = -EIO;
+			goto out;
 		}
 
-		ret = mtk_board_flash_erase(flash, addr, erasesize);
-		if (ret) {
-			printf("Fatal: failed to erase dst image area\n");
-			return -EIO;
+		for (pos = 0; pos < chunksz; pos += erasesize) {
+			skipped = st.skipped;
+
+			ret = flash_diff_write_block(flash, addr + pos,
+				buff + pos, min(erasesize, chunksz - pos),
+				verify, &st);
+			if (ret) {
+				printf("Fatal: failed to write dst image data\n");
+				ret = -EIO;
+				goto out;
+			}
+
+			/* Unchanged blocks have just been compared */
+			if (st.skipped != skipped)
+				continue;
+
+			ret = mtk_board_flash_read(flash, addr + pos,
+				min(erasesize, chunksz - pos), verify);
+			if (ret) {
+				if (ret == -EBADMSG)
+					printf("Dest image data has uncorrectable ECC error\n");
+				else
+					printf("Fatal: failed to read dst image data\n");
+				ret = -EIO;
+				goto out;
+			}
+
+			if (memcmp(buff + pos, verify,
+				   min(erasesize, chunksz - pos))) {
+				printf("Image data verification failed\n");
+				ret = 1;
+				goto out;
+			}
 		}
 
-		ret = mtk_board_flash_write(flash, addr, chunksz, buff);
+		src_offset += chunksz;
+		addr += chunksz;
+		sizeleft -= chunksz;
+	}
+
+	if (deadc0de) {
+		addr = (addr + erasesize - 1) & ~(erasesize - 1);
+
+		ret = flash_diff_write_block(flash, addr, "\xde\xad\xc0\xde", 4,
+					     verify, &st);
 		if (ret) {
-			printf("Fatal: failed to write dst image data\n");
-			return -EIO;
+			printf("Fatal: failed to write jffs2 end-of-filesystem marker\n");
+			ret = -EIO;
+			goto out;
 		}
+	}
+
+	printf("%u block(s) copied, %u block(s) unchanged\n",
+	       st.blocks - st.skipped, st.skipped);
+	ret = 0;
+
+out:
+	scratch_free("image copy");
+
+	return ret;
+}
+
+#ifdef CONFIG_MTK_DUAL_IMAGE_MANIFEST
+#define MANIFEST_ENV_MAIN	"dual_image.manifest.main"
+#define MANIFEST_ENV_BACKUP	"dual_image.manifest.backup"
+#define MANIFEST_ENV_BOOTS	"dual_image.boots"
+
+/*
+ * Image manifest of a slot. It's stored in the environment as
+ * "<gen>,<image size>,<data size>,<block size>,<digests>,<seal>", all in
+ * hex. <digests> are the CRC32 of each erase block of the data covered
+ * (8 digits each), and <seal> is the CRC32 of the string before it.
+ *
+ * The data covered is exactly what copy_firmware() copies to the other
+ * slot. The generation is bumped whenever the main image changes, and the
+ * backup image carries the generation of the main image it mirrors.
+ */
+struct image_manifest {
+	u32 gen;
+	u32 image_size;
+	u32 data_size;
+	u32 block_size;
+	u32 num_blocks;
+	u32 *digests;
+};
+
+/* Kept until the end of dual_image_check() */
+static void *manifest_buffer(size_t block_size)
+{
+	return scratch_alloc("image manifest", block_size);
+}
+
+/* Drop the digests but keep the generation for the next manifest */
+static void manifest_invalidate(struct image_manifest *mf)
+{
+	free(mf->digests);
+	mf->digests = NULL;
+}
+
+static int manifest_init(struct image_manifest *mf, size_t image_size,
+			 size_t data_size, size_t block_size)
+{
+	manifest_invalidate(mf);
+
+	mf->image_size = image_size;
+	mf->data_size = data_size;
+	mf->block_size = block_size;
+	mf->num_blocks = DIV_ROUND_UP(data_size, block_size);
+
+	mf->digests = calloc(mf->num_blocks, sizeof(*mf->digests));
+	if (!mf->digests)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static int manifest_copy(struct image_manifest *dst,
+			 const struct image_manifest *src)
+{
+	if (manifest_init(dst, src->image_size, src->data_size,
+			  src->block_size))
+		return -ENOMEM;
+
+	memcpy(dst->digests, src->digests,
+	       src->num_blocks * sizeof(*src->digests));
+	dst->gen = src->gen;
+
+	return 0;
+}
+
+static bool manifest_equal(const struct image_manifest *a,
+			   const struct image_manifest *b)
+{
+	if (!a->digests || !b->digests)
+		return false;
+
+	if (a->image_size != b->image_size || a->data_size != b->data_size ||
+	    a->block_size != b->block_size)
+		return false;
+
+	return !memcmp(a->digests, b->digests,
+		       a->num_blocks * sizeof(*a->digests));
+}
+
+static int manifest_load(const char *name, size_t block_size,
+			 struct image_manifest *mf)
+{
+	u32 gen, image_size, data_size, blksz, i;
+	const char *str, *seal, *p;
+	char digest[9];
+	char *end;
+
+	memset(mf, 0, sizeof(*mf));
+
+	str = env_get(name);
+	if (!str)
+		return -ENOENT;
+
+	seal = strrchr(str, ',');
+	if (!seal || simple_strtoul(seal + 1, NULL, 16) !=
+	    crc32(0, (const u8 *)str, seal - str))
+		goto bad_manifest;
+
+	gen = simple_strtoul(str, &end, 16);
+	if (*end != ',')
+		goto bad_manifest;
+
+	image_size = simple_strtoul(end + 1, &end, 16);
+	if (*end != ',')
+		goto bad_manifest;
+
+	data_size = simple_strtoul(end + 1, &end, 16);
+	if (*end != ',')
+		goto bad_manifest;
+
+	blksz = simple_strtoul(end + 1, &end, 16);
+	if (*end != ',')
+		goto bad_manifest;
+
+	p = end + 1;
+
+	if (blksz != block_size || !image_size || image_size > data_size ||
+	    seal - p != DIV_ROUND_UP(data_size, blksz) * 8)
+		goto bad_manifest;
+
+	if (manifest_init(mf, image_size, data_size, blksz))
+		return -ENOMEM;
+
+	mf->gen = gen;
+
+	digest[8] = 0;
+
+	for (i = 0; i < mf->num_blocks; i++) {
+		memcpy(digest, p + i * 8, 8);
+		mf->digests[i] = simple_strtoul(digest, NULL, 16);
+	}
+
+	return 0;
+
+bad_manifest:
+	printf("Ignoring invalid manifest '%s'\n", name);
+	return -EINVAL;
+}
+
+static int manifest_store(const char *name, const struct image_manifest *mf)
+{
+	char *str, *p;
+	u32 i;
+	int ret;
+
+	if (!mf->digests)
+		return env_set(name, NULL);
+
+	str = malloc(4 * 9 + mf->num_blocks * 8 + 10);
+	if (!str)
+		return -ENOMEM;
+
+	p = str + sprintf(str, "%x,%x,%x,%x,", mf->gen, mf->image_size,
+			  mf->data_size, mf->block_size);
+
+	for (i = 0; i < mf->num_blocks; i++)
+		p += sprintf(p, "%08x", mf->digests[i]);
+
+	sprintf(p, ",%08x", crc32(0, (const u8 *)str, p - str));
+
+	ret = env_set(name, str);
+
+	free(str);
 
-		ret = mtk_board_flash_read(flash, addr, chunksz, verify);
+	return ret;
+}
+
+static int manifest_block_digest(void *flash, uint64_t offset,
+				 const struct image_manifest *mf, u32 idx,
+				 u32 *digest)
+{
+	size_t len = min(mf->block_size, mf->data_size - idx * mf->block_size);
+	void *buf = manifest_buffer(mf->block_size);
+	int ret;
+
+	if (!buf)
+		return -ENOMEM;
+
+	ret = mtk_board_flash_read(flash, offset + idx * mf->block_size, len,
+				   buf);
+	if (ret)
+		return ret;
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_HASH, "hash");
+	*digest = crc32(0, buf, len);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_HASH);
+
+	return 0;
+}
+
+static int manifest_build(void *flash, uint64_t offset,
+			  struct image_manifest *mf, size_t image_size,
+			  size_t data_size)
+{
+	u32 i;
+	int ret;
+
+	ret = manifest_init(mf, image_size, data_size,
+			    mtk_board_get_flash_erase_size(flash));
+	if (ret)
+		return ret;
+
+	for (i = 0; i < mf->num_blocks; i++) {
+		ret = manifest_block_digest(flash, offset, mf, i,
+					    &mf->digests[i]);
 		if (ret) {
-			if (ret == -EBADMSG)
-				printf("Dest image data has uncorrectable ECC error\n");
-			else
-				printf("Fatal: failed to read dst image data\n");
-			return -EIO;
+			manifest_invalidate(mf);
+			return ret;
 		}
+	}
 
-		if (memcmp(buff, verify, chunksz)) {
-			printf("Image data verification failed\n");
-			return 1;
+	return 0;
+}
+
+static u32 manifest_mix(u32 x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352d;
+	x ^= x >> 15;
+	x *= 0x846ca68b;
+	x ^= x >> 16;
+
+	return x;
+}
+
+enum manifest_status {
+	MANIFEST_MATCH,
+	MANIFEST_CHANGED,
+	MANIFEST_DAMAGED,
+};
+
+/*
+ * Check the first and the last block, which change on every upgrade and
+ * are the last to be written by an interrupted one, and then a few
+ * randomly chosen blocks in between, or all of them for a deep check.
+ * A mismatch in between with both ends intact means the data is damaged.
+ */
+static enum manifest_status manifest_check(void *flash, uint64_t offset,
+					   const struct image_manifest *mf,
+					   bool deep)
+{
+	u32 i, idx, digest, n = 2, seed = (u32)get_ticks();
+	int ret;
+
+	/* Boot timing jitter is enough to pick different blocks every boot */
+
+	if (mf->num_blocks > 2)
+		n += deep ? mf->num_blocks - 2 :
+			    CONFIG_MTK_DUAL_IMAGE_SCRUB_BLOCKS;
+
+	for (i = 0; i < n; i++) {
+		if (i == 0) {
+			idx = 0;
+		} else if (i == 1) {
+			idx = mf->num_blocks - 1;
+		} else if (deep) {
+			idx = i - 1;
+		} else {
+			seed += 0x9e3779b9;
+			idx = 1 + manifest_mix(seed) % (mf->num_blocks - 2);
 		}
 
-		src_offset += chunksz;
-		addr += chunksz;
-		sizeleft -= chunksz;
+		ret = manifest_block_digest(flash, offset, mf, idx, &digest);
+		if (ret == -EBADMSG && i >= 2)
+			return MANIFEST_DAMAGED;
+
+		if (ret)
+			return MANIFEST_CHANGED;
+
+		if (digest != mf->digests[idx]) {
+			if (i < 2)
+				return MANIFEST_CHANGED;
+
+			printf("Block %u does not match the manifest\n", idx);
+			return MANIFEST_DAMAGED;
+		}
+	}
+
+	return MANIFEST_MATCH;
+}
+
+static bool manifest_deep_check_due(bool *env_changed)
+{
+#if CONFIG_MTK_DUAL_IMAGE_DEEP_CHECK_INTERVAL > 0
+	ulong boots = env_get_ulong(MANIFEST_ENV_BOOTS, 10, 0) + 1;
+
+	if (boots >= CONFIG_MTK_DUAL_IMAGE_DEEP_CHECK_INTERVAL)
+		boots = 0;
+
+	env_set_ulong(MANIFEST_ENV_BOOTS, boots);
+	*env_changed = true;
+
+	return !boots;
+#else
+	return false;
+#endif
+}
+
+static size_t manifest_data_size(size_t image_size, size_t padding_bytes,
+				 size_t rootfs_size)
+{
+#ifdef CONFIG_MTK_DUAL_IMAGE_RESTORE_KERNEL_ONLY
+	return image_size;
+#else
+	return image_size + padding_bytes + rootfs_size;
+#endif
+}
+
+/*
+ * Verify one slot. The slot is accepted without reading the whole image if
+ * it matches its manifest. Otherwise a full verification is done, and the
+ * manifest is rebuilt (@updated is set) if it's missing or outdated.
+ */
+static int verify_slot(void *flash, uint64_t offset, uint64_t partsize,
+		       struct image_manifest *mf, bool deep, bool *updated,
+		       size_t *image_size, size_t *padding_bytes,
+		       size_t *rootfs_size)
+{
+	int ret;
+
+	*updated = false;
+
+	if (mf->digests && mf->data_size <= partsize) {
+		switch (manifest_check(flash, offset, mf, deep)) {
+		case MANIFEST_MATCH:
+			*image_size = mf->image_size;
+
+			if (deep)
+				break;
+
+			printf("Image matches its manifest\n");
+			return verify_rootfs(flash, offset + mf->image_size,
+					     partsize - mf->image_size,
+					     padding_bytes, rootfs_size);
+
+		case MANIFEST_CHANGED:
+			printf("Image does not match its manifest\n");
+			manifest_invalidate(mf);
+			break;
+
+		case MANIFEST_DAMAGED:
+			printf("Image is damaged\n");
+			manifest_invalidate(mf);
+			return 1;
+		}
 	}
 
-	if (!deadc0de)
+	ret = verify_image(flash, offset, partsize, image_size);
+	if (ret)
+		return ret;
+
+	ret = verify_rootfs(flash, offset + *image_size,
+			    partsize - *image_size, padding_bytes,
+			    rootfs_size);
+	if (ret)
+		return ret;
+
+	if (mf->digests)
 		return 0;
 
-	addr = (addr + erasesize - 1) & ~(erasesize - 1);
+	printf("Generating image manifest ...\n");
 
-	ret = mtk_board_flash_erase(flash, addr, erasesize);
-	if (ret) {
-		printf("Fatal: failed to erase dst image area\n");
-		return -EIO;
+	ret = manifest_build(flash, offset, mf, *image_size,
+		manifest_data_size(*image_size, *padding_bytes, *rootfs_size));
+	if (!ret)
+		*updated = true;
+
+	return 0;
+}
+
+/*
+ * A slot accepted by its manifest has only been sampled. Before it
+ * overwrites the other slot, verify it in full, and make sure it isn't
+ * older than the image it replaces.
+ */
+static int restore_source_check(void *flash, uint64_t offset,
+				uint64_t partsize, size_t image_size,
+				const struct image_manifest *src,
+				const struct image_manifest *dst,
+				const char *name)
+{
+	size_t size;
+
+	if (src->gen < dst->gen) {
+		printf("Fatal: %s image is older than the one it would replace\n",
+		       name);
+		return 5;
 	}
 
-	ret = mtk_board_flash_write(flash, addr, 4, "\xde\xad\xc0\xde");
-	if (ret) {
-		printf("Fatal: failed to write jffs2 end-of-filesystem marker\n");
-		return -EIO;
+	printf("Verifying %s image before restoring from it ...\n", name);
+	if (verify_image(flash, offset, partsize, &size) ||
+	    size != image_size) {
+		printf("Fatal: %s image failed verification\n", name);
+		return 5;
 	}
 
 	return 0;
 }
 
+int dual_image_update_manifest(void *flash, const void *data, size_t size)
+{
+	size_t erasesize = mtk_board_get_flash_erase_size(flash);
+	struct image_manifest mf, mf_backup;
+	size_t image_size, padding = 0;
+	u64 rootfs_size = 0;
+#ifndef CONFIG_MTK_DUAL_IMAGE_RESTORE_KERNEL_ONLY
+	const struct squashfs_super_block *sb;
+#endif
+	u32 i;
+	int ret;
+
+	switch (genimg_get_format(data)) {
+	case IMAGE_FORMAT_LEGACY:
+		image_size = image_get_image_size(data);
+		break;
+#if defined(CONFIG_FIT)
+	case IMAGE_FORMAT_FIT:
+		image_size = fit_get_size(data);
+		break;
+#endif
+	default:
+		image_size = 0;
+	}
+
+	if (!image_size || image_size >= size)
+		goto no_manifest;
+
+#ifndef CONFIG_MTK_DUAL_IMAGE_RESTORE_KERNEL_ONLY
+	sb = data + image_size;
+	if (le32_to_cpu(sb->s_magic) != SQUASHFS_MAGIC) {
+		padding = ALIGN(image_size, erasesize) - image_size;
+		sb = data + image_size + padding;
+	}
+
+	if (image_size + padding + sizeof(*sb) > size ||
+	    le32_to_cpu(sb->s_magic) != SQUASHFS_MAGIC)
+		goto no_manifest;
+
+	rootfs_size = le64_to_cpu(sb->bytes_used);
+	if (image_size + padding + rootfs_size > size)
+		goto no_manifest;
+#endif
+
+	manifest_load(MANIFEST_ENV_MAIN, erasesize, &mf);
+	manifest_load(MANIFEST_ENV_BACKUP, erasesize, &mf_backup);
+
+	ret = manifest_init(&mf, image_size,
+			    manifest_data_size(image_size, padding,
+					       rootfs_size), erasesize);
+	if (ret)
+		goto out;
+
+	for (i = 0; i < mf.num_blocks; i++)
+		mf.digests[i] = crc32(0, data + i * erasesize,
+				      min(erasesize,
+					  mf.data_size - i * erasesize));
+
+	mf.gen = max(mf.gen, mf_backup.gen) + 1;
+
+	manifest_store(MANIFEST_ENV_MAIN, &mf);
+	env_set(MANIFEST_ENV_BACKUP, NULL);
+	ret = env_save();
+
+out:
+	manifest_invalidate(&mf);
+	manifest_invalidate(&mf_backup);
+
+	return ret;
+
+no_manifest:
+	env_set(MANIFEST_ENV_MAIN, NULL);
+	env_set(MANIFEST_ENV_BACKUP, NULL);
+	return env_save();
+}
+#endif /* CONFIG_MTK_DUAL_IMAGE_MANIFEST */
+
 int dual_image_check(void)
 {
 	uint64_t image1_off, image2_off, image1_partsize, image2_partsize;
@@ -313,10 +847,16 @@ int dual_image_check(void)
 	bool image1_ok, image2_ok;
 	uint64_t image_total_size;
 	bool deadc0de = false;
+#ifdef CONFIG_MTK_DUAL_IMAGE_MANIFEST
+	struct image_manifest mf1, mf2;
+	bool mf1_updated, mf2_updated, env_changed = false, deep;
+	size_t erasesize;
+#endif
 	void *flash;
 	int ret;
 
 	printf("\nStarting dual image checking ...\n");
+	bootstage_mark_name(BOOTSTAGE_ID_DUAL_IMAGE_CHECK, "dual_image_check");
 
 	flash = mtk_board_get_flash_dev();
 	if (!flash) {
@@ -341,6 +881,64 @@ int dual_image_check(void)
 		return -1;
 	}
 
+#ifdef CONFIG_MTK_DUAL_IMAGE_MANIFEST
+	erasesize = mtk_board_get_flash_erase_size(flash);
+	manifest_load(MANIFEST_ENV_MAIN, erasesize, &mf1);
+	manifest_load(MANIFEST_ENV_BACKUP, erasesize, &mf2);
+
+	deep = manifest_deep_check_due(&env_changed);
+	if (deep)
+		printf("Performing deep image checking\n");
+
+	printf("Verifying main image at 0x%llx...\n", image1_off);
+	ret = verify_slot(flash, image1_off, image1_partsize, &mf1, deep,
+			  &mf1_updated, &image1_size, &image1_padding_bytes,
+			  &rootfs1_size);
+	if (ret < 0) {
+		printf("Dual image checking is bypassed\n");
+		ret = 0;
+		goto out;
+	}
+
+	image1_ok = ret == 0;
+
+	printf("Verifying backup image at 0x%llx...\n", image2_off);
+	ret = verify_slot(flash, image2_off, image2_partsize, &mf2, deep,
+			  &mf2_updated, &image2_size, &image2_padding_bytes,
+			  &rootfs2_size);
+	if (ret < 0) {
+		printf("Dual image checking is bypassed\n");
+		ret = 0;
+		goto out;
+	}
+
+	image2_ok = ret == 0;
+
+	if (image1_ok && mf1_updated) {
+		/* Main image has been changed since the last check */
+		if (manifest_equal(&mf1, &mf2))
+			mf1.gen = mf2.gen;
+		else
+			mf1.gen = max(mf1.gen, mf2.gen) + 1;
+
+		manifest_store(MANIFEST_ENV_MAIN, &mf1);
+		env_changed = true;
+	}
+
+	if (image2_ok && mf2_updated) {
+		/* Backup image of unknown origin is treated as outdated */
+		mf2.gen = manifest_equal(&mf1, &mf2) ? mf1.gen : 0;
+
+		manifest_store(MANIFEST_ENV_BACKUP, &mf2);
+		env_changed = true;
+	}
+
+	if (image1_ok && image2_ok && mf1.digests && mf2.digests &&
+	    mf1.gen != mf2.gen) {
+		printf("Backup image is outdated\n");
+		image2_ok = false;
+	}
+#else
 	printf("Verifying main image at 0x%llx...\n", image1_off);
 	ret = verify_image(flash, image1_off, image1_partsize, &image1_size);
 	if (ret < 0) {
@@ -370,15 +968,18 @@ int dual_image_check(void)
 	}
 
 	image2_ok = ret == 0;
+#endif
 
 	if (!image1_ok && !image2_ok) {
 		printf("Fatal: both images are broken.\n");
-		return 3;
+		ret = 3;
+		goto out;
 	}
 
 	if (image1_ok && image2_ok) {
 		printf("Passed\n");
-		return 0;
+		ret = 0;
+		goto out;
 	}
 
 	if (!image2_ok) {
@@ -391,12 +992,28 @@ int dual_image_check(void)
 
 		if (image_total_size > image2_partsize) {
 			printf("Fatal: backup image partition can't hold main image\n");
-			return 4;
+			ret = 4;
+			goto out;
 		}
 
+#ifdef CONFIG_MTK_DUAL_IMAGE_MANIFEST
+		ret = restore_source_check(flash, image1_off, image1_partsize,
+					   image1_size, &mf1, &mf2, "main");
+		if (ret)
+			goto out;
+#endif
+
 		printf("Restoring backup image ...\n");
 		ret = copy_firmware(flash, image1_off, image2_off,
 			image_total_size, deadc0de);
+
+#ifdef CONFIG_MTK_DUAL_IMAGE_MANIFEST
+		if (!ret && mf1.digests && !manifest_copy(&mf2, &mf1))
+			manifest_store(MANIFEST_ENV_BACKUP, &mf2);
+		else
+			env_set(MANIFEST_ENV_BACKUP, NULL);
+		env_changed = true;
+#endif
 	} else {
 		image_total_size = image2_size;
 
@@ -407,16 +1024,45 @@ int dual_image_check(void)
 
 		if (image_total_size > image1_partsize) {
 			printf("Fatal: main image partition can't hold backup image\n");
-			return 4;
+			ret = 4;
+			goto out;
 		}
 
+#ifdef CONFIG_MTK_DUAL_IMAGE_MANIFEST
+		ret = restore_source_check(flash, image2_off, image2_partsize,
+					   image2_size, &mf2, &mf1, "backup");
+		if (ret)
+			goto out;
+#endif
+
 		printf("Restoring main image ...\n");
 		ret = copy_firmware(flash, image2_off, image1_off,
 			image_total_size, deadc0de);
+
+#ifdef CONFIG_MTK_DUAL_IMAGE_MANIFEST
+		if (!ret && mf2.digests && !manifest_copy(&mf1, &mf2))
+			manifest_store(MANIFEST_ENV_MAIN, &mf1);
+		else
+			env_set(MANIFEST_ENV_MAIN, NULL);
+		env_changed = true;
+#endif
 	}
 
 	if (!ret)
 		printf("Done\n");
 
+out:
+#ifdef CONFIG_MTK_DUAL_IMAGE_MANIFEST
+	if (env_changed)
+		env_save();
+
+	manifest_invalidate(&mf1);
+	manifest_invalidate(&mf2);
+	scratch_free("image manifest");
+#endif
+
+	bootstage_mark_name(BOOTSTAGE_ID_DUAL_IMAGE_CHECK_DONE,
+			    "dual_image_check_done");
+
 	return ret;
 }
@@ -11,5 +11,6 @@
 #include <linux/types.h>
 
 int dual_image_check(void);
+int dual_image_update_manifest(void *flash, const void *data, size_t size);
 
 #endif /* _BOARD_RALINK_DUAL_IMAGE_H_ */
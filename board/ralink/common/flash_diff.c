@@ -0,0 +1,189 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (C) 2020 MediaTek Inc. All Rights Reserved.
+ *
+ * Author: Weijie Gao <weijie.gao@mediatek.com>
+ *
+ * Differential flash writing: only erase/program what actually changes
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <obj_pool.h>
+#include <linux/errno.h>
+#include <linux/kernel.h>
+#include <linux/math64.h>
+
+#include "flash_helper.h"
+#include "flash_diff.h"
+
+static bool is_erased(const void *buf, size_t len)
+{
+	const u8 *p = buf;
+	const ulong *w;
+
+	while (len && ((uintptr_t)p & (sizeof(ulong) - 1))) {
+		if (*p++ != 0xff)
+			return false;
+		len--;
+	}
+
+	for (w = (const ulong *)p; len >= sizeof(ulong); len -= sizeof(ulong))
+		if (*w++ != ~0UL)
+			return false;
+
+	for (p = (const u8 *)w; len; len--)
+		if (*p++ != 0xff)
+			return false;
+
+	return true;
+}
+
+static int flash_diff_program(void *flash, uint64_t offset, const u8 *data,
+			      size_t len, struct flash_diff_stats *st)
+{
+	size_t pagesize = mtk_board_get_flash_page_size(flash);
+	size_t pos, chunk, run_start = 0, run_len = 0;
+	int ret;
+
+	for (pos = 0; pos < len; pos += chunk) {
+		chunk = min(pagesize, len - pos);
+		st->pages++;
+
+		if (!is_erased(data + pos, chunk)) {
+			/* Merge adjacent non-empty pages into one request */
+			if (!run_len)
+				run_start = pos;
+			run_len += chunk;
+			st->pages_written++;
+			continue;
+		}
+
+		st->pages_skipped++;
+
+		if (run_len) {
+			ret = mtk_board_flash_write(flash, offset + run_start,
+						    run_len, data + run_start);
+			if (ret)
+				return ret;
+			run_len = 0;
+		}
+	}
+
+	if (run_len)
+		return mtk_board_flash_write(flash, offset + run_start,
+					     run_len, data + run_start);
+
+	return 0;
+}
+
+/*
+ * Make the erase block at @offset hold @data followed by 0xff padding.
+ * @offset must be erase block aligned and @len must not exceed the erase
+ * size. @cmpbuf must be able to hold one erase block.
+ */
+int flash_diff_write_block(void *flash, uint64_t offset, const void *data,
+			   size_t len, void *cmpbuf,
+			   struct flash_diff_stats *st)
+{
+	size_t erasesize = mtk_board_get_flash_erase_size(flash);
+	u32 npages = DIV_ROUND_UP(len, mtk_board_get_flash_page_size(flash));
+	ulong start;
+	int ret;
+
+	st->blocks++;
+
+	start = get_timer(0);
+	ret = mtk_board_flash_read(flash, offset, erasesize, cmpbuf);
+	st->read_time += get_timer(start);
+
+	/* A block which can not be read back is always rewritten */
+	if (!ret && !memcmp(cmpbuf, data, len) &&
+	    is_erased(cmpbuf + len, erasesize - len)) {
+		st->skipped++;
+		st->pages += npages;
+		return 0;
+	}
+
+	start = get_timer(0);
+	ret = mtk_board_flash_erase(flash, offset, erasesize);
+	st->erase_time += get_timer(start);
+	if (ret)
+		return ret;
+
+	if (is_erased(data, len)) {
+		st->erase_only++;
+		st->pages += npages;
+		st->pages_skipped += npages;
+		return 0;
+	}
+
+	st->written++;
+
+	start = get_timer(0);
+	ret = flash_diff_program(flash, offset, data, len, st);
+	st->write_time += get_timer(start);
+
+	return ret;
+}
+
+int flash_diff_write(void *flash, uint64_t offset, const void *data,
+		     size_t len, struct flash_diff_stats *st)
+{
+	size_t erasesize = mtk_board_get_flash_erase_size(flash);
+	const u8 *p = data;
+	size_t chunksz;
+	void *cmpbuf;
+	int ret = 0;
+
+	cmpbuf = obj_pool_alloc(OBJ_POOL_GET(block), erasesize);
+	if (!cmpbuf)
+		return -ENOMEM;
+
+	while (len) {
+		chunksz = min(len, erasesize);
+
+		ret = flash_diff_write_block(flash, offset, p, chunksz, cmpbuf,
+					     st);
+		if (ret)
+			break;
+
+		serial_poll_tx();
+
+		offset += erasesize;
+		p += chunksz;
+		len -= chunksz;
+	}
+
+	obj_pool_free(OBJ_POOL_GET(block), cmpbuf);
+
+	return ret;
+}
+
+void flash_diff_print_stats(const struct flash_diff_stats *st)
+{
+	u32 erased = st->erase_only + st->written;
+	u64 saved;
+
+	printf("Blocks: %u total, %u unchanged, %u erased only, %u rewritten\n",
+	       st->blocks, st->skipped, st->erase_only, st->written);
+	printf("Pages: %u programmed, %u skipped (%u blank, %u unchanged)\n",
+	       st->pages_written, st->pages - st->pages_written,
+	       st->pages_skipped,
+	       st->pages - st->pages_written - st->pages_skipped);
+
+	/*
+	 * A full rewrite erases every block and programs every page. Use
+	 * the measured average cost of both to estimate what was avoided.
+	 */
+	if (!erased || !st->pages_written)
+		return;
+
+	saved = div_u64((u64)st->erase_time * st->skipped, erased) +
+		div_u64((u64)st->write_time *
+			(st->pages - st->pages_written), st->pages_written);
+
+	if (saved > st->read_time)
+		printf("Estimated time saved: %llu ms\n",
+		       saved - st->read_time);
+}
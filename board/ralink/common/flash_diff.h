@@ -0,0 +1,33 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (C) 2020 MediaTek Inc. All Rights Reserved.
+ *
+ * Author: Weijie Gao <weijie.gao@mediatek.com>
+ */
+
+#ifndef _BOARD_RALINK_FLASH_DIFF_H_
+#define _BOARD_RALINK_FLASH_DIFF_H_
+
+#include <linux/types.h>
+
+struct flash_diff_stats {
+	u32 blocks;		/* erase blocks processed */
+	u32 skipped;		/* blocks already holding the new data */
+	u32 erase_only;		/* blocks whose new data is all 0xff */
+	u32 written;		/* blocks erased and programmed */
+	u32 pages;		/* pages covered by the new data */
+	u32 pages_written;	/* pages programmed */
+	u32 pages_skipped;	/* all-0xff pages not programmed */
+	ulong read_time;	/* time (ms) spent on reading back */
+	ulong erase_time;	/* time (ms) spent on erasing */
+	ulong write_time;	/* time (ms) spent on programming */
+};
+
+int flash_diff_write_block(void *flash, uint64_t offset, const void *data,
+			   size_t len, void *cmpbuf,
+			   struct flash_diff_stats *st);
+int flash_diff_write(void *flash, uint64_t offset, const void *data,
+		     size_t len, struct flash_diff_stats *st);
+void flash_diff_print_stats(const struct flash_diff_stats *st);
+
+#endif /* _BOARD_RALINK_FLASH_DIFF_H_ */
@@ -14,6 +14,7 @@ int get_mtd_part_info(const char *partname, uint64_t *off, uint64_t *size);
 
 void *mtk_board_get_flash_dev(void);
 size_t mtk_board_get_flash_erase_size(void *flashdev);
+size_t mtk_board_get_flash_page_size(void *flashdev);
 int mtk_board_flash_erase(void *flashdev, uint64_t offset, uint64_t len);
 int mtk_board_flash_read(void *flashdev, uint64_t offset, size_t len,
 			 void *buf);
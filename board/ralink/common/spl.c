@@ -11,6 +11,7 @@
 #include <lzma/LzmaDec.h>
 #include <lzma/LzmaTools.h>
 #include <xyzModem.h>
+#include <serial_stream.h>
 #include <linux/sizes.h>
 #include <asm/addrspace.h>
 
@@ -36,6 +37,9 @@ DECLARE_GLOBAL_DATA_PTR;
 
 #define BUF_SIZE 1024
 
+/* How long to listen for the serial stream host before trying Ymodem */
+#define UART_STREAM_WAIT_MS	3000
+
 static ulong free_dram_bottom(void)
 {
 #if defined (CONFIG_MACH_MT7621)
@@ -45,12 +49,30 @@ static ulong free_dram_bottom(void)
 #endif
 }
 
+/*
+ * End of the emergency receive buffer. It must not reach the SPL image, nor
+ * the areas SPL hands over to U-Boot just below it.
+ */
+static ulong free_dram_top(void)
+{
+	ulong top = CONFIG_SPL_TEXT_BASE;
+
+#ifdef CONFIG_BOOTSTAGE_STASH
+	top = min_t(ulong, top, CKSEG0ADDR(CONFIG_BOOTSTAGE_STASH_ADDR));
+#endif
+#ifdef CONFIG_NAND_MT7621_BBT_HANDOFF
+	top = min_t(ulong, top,
+		    CKSEG0ADDR(CONFIG_NAND_MT7621_BBT_HANDOFF_ADDR));
+#endif
+
+	return top;
+}
+
 static int spl_try_load_image(struct spl_image_info *spl_image,
 			      void *image_addr)
 {
 	int ret;
 	struct image_header *uhdr, hdr;
-	SizeT lzma_len;
 
 	if ((size_t) image_addr % sizeof (void *)) {
 		memcpy(&hdr, (const void *) image_addr, sizeof (hdr));
@@ -82,15 +104,17 @@ static int spl_try_load_image(struct spl_image_info *spl_image,
 	}
 #ifdef CONFIG_SPL_LZMA
 	else if (uhdr->ih_comp == IH_COMP_LZMA) {
+		SizeT lzma_len = CONFIG_SYS_BOOTM_LEN;
+
 		/*
 		* Uncompress real U-Boot to its defined location in SDRAM
 		*/
-		lzma_len = CONFIG_SYS_BOOTM_LEN;
-
+		bootstage_start(BOOTSTAGE_ID_ACCUM_DECOMP, "decompress");
 		ret = lzmaBuffToBuffDecompress((u8 *) spl_image->load_addr,
 			&lzma_len,
 			(u8 *) (image_addr + sizeof(struct image_header)),
 			spl_image->size);
+		bootstage_accum(BOOTSTAGE_ID_ACCUM_DECOMP);
 
 		if (ret) {
 			printf("Error: LZMA uncompression error: %d\n", ret);
@@ -100,6 +124,27 @@ static int spl_try_load_image(struct spl_image_info *spl_image,
 		spl_image->size = lzma_len;
 	}
 #endif /* CONFIG_SPL_LZMA */
+#ifdef CONFIG_SPL_LZ4
+	else if (uhdr->ih_comp == IH_COMP_LZ4) {
+		size_t lz4_len = CONFIG_SYS_BOOTM_LEN;
+
+		/*
+		* Uncompress real U-Boot to its defined location in SDRAM
+		*/
+		bootstage_start(BOOTSTAGE_ID_ACCUM_DECOMP, "decompress");
+		ret = ulz4fn((void *) (image_addr + sizeof(struct image_header)),
+			     spl_image->size, (void *) spl_image->load_addr,
+			     &lz4_len);
+		bootstage_accum(BOOTSTAGE_ID_ACCUM_DECOMP);
+
+		if (ret) {
+			printf("Error: LZ4 uncompression error: %d\n", ret);
+			return ret;
+		}
+
+		spl_image->size = lz4_len;
+	}
+#endif /* CONFIG_SPL_LZ4 */
 	else {
 		debug("Warning: Unsupported compression method found in image "
 		      "header at offset 0x%p\n", image_addr);
@@ -161,9 +206,14 @@ static int spl_nmbm_init(void)
 		return -ENODEV;
 	}
 
+	bootstage_mark_name(BOOTSTAGE_ID_SPL_NMBM_INIT, "spl_nmbm_init");
+
 	ret = nmbm_attach_mtd(lower, NMBM_F_CREATE, CONFIG_NMBM_MAX_RATIO,
 		CONFIG_NMBM_MAX_BLOCKS, &upper);
 
+	bootstage_mark_name(BOOTSTAGE_ID_SPL_NMBM_INIT_DONE,
+			    "spl_nmbm_init_done");
+
 	return ret;
 }
 
@@ -208,8 +258,13 @@ static int spl_mtk_read_nand_image(struct spl_image_info *spl_image,
 
 	dst_addr = (void *) free_dram_bottom();
 
-	if (nand_spl_load_image(nand_addr,
-	    sizeof(hdr) + image_get_data_size(&hdr), dst_addr))
+	bootstage_start(BOOTSTAGE_ID_ACCUM_FLASH, "flash_io");
+	ret = nand_spl_load_image(nand_addr,
+				  sizeof(hdr) + image_get_data_size(&hdr),
+				  dst_addr);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_FLASH);
+
+	if (ret)
 		return -EINVAL;
 
 	*data_addr = (ulong) dst_addr;
@@ -278,12 +333,45 @@ static int getcymodem(void)
 	return -1;
 }
 
+static int spl_mtk_ymodem_receive(char *buf, int maxsize, int *size)
+{
+	int err, ret;
+	connection_info_t info;
+
+	*size = 0;
+
+	info.mode = xyzModem_ymodem;
+	ret = xyzModem_stream_open(&info, &err);
+	if (ret) {
+		printf("spl: ymodem err - %s\n", xyzModem_error(err));
+		return ret;
+	}
+
+	while (*size + BUF_SIZE <= maxsize &&
+	       (ret = xyzModem_stream_read(buf + *size, BUF_SIZE, &err)) > 0)
+		*size += ret;
+
+	if (*size + BUF_SIZE > maxsize) {
+		printf("spl: image is too large\n");
+		ret = -ENOSPC;
+	} else {
+		ret = 0;
+	}
+
+	xyzModem_stream_close(&err);
+	xyzModem_stream_terminate(ret != 0, &getcymodem);
+
+	return ret;
+}
+
 static int spl_mtk_ymodem_load_image(struct spl_image_info *spl_image,
 				     struct spl_boot_device *bootdev)
 {
-	int err, ret, size = 0;
+	int ret, maxsize, size = 0;
 	char *buf, *stage2_buf;
-	connection_info_t info;
+#ifdef CONFIG_SPL_SERIAL_STREAM
+	size_t len;
+#endif
 
 	printf("\n");
 	printf("Failed to load U-Boot image!\n");
@@ -292,22 +380,37 @@ static int spl_mtk_ymodem_load_image(struct spl_image_info *spl_image,
 	       "console.\n");
 	printf("The U-Boot image will be booted up directly, and not be "
 	       "written to flash.\n");
+#ifdef CONFIG_SPL_SERIAL_STREAM
+	printf("Accepted modes are Ymodem-1K and serial stream "
+	       "(tools/serial_stream.py).\n");
+#else
 	printf("Accepted mode is Ymoden-1K.\n");
+#endif
 
 	buf = (char *) free_dram_bottom();
+	maxsize = free_dram_top() - free_dram_bottom();
+
+#ifdef CONFIG_SPL_SERIAL_STREAM
+	/* Listen for both protocols in turn until a file comes in */
+	while (1) {
+		ret = serial_stream_receive(buf, maxsize, &len,
+					    UART_STREAM_WAIT_MS);
+		if (!ret) {
+			size = len;
+			break;
+		}
 
-	info.mode = xyzModem_ymodem;
-	ret = xyzModem_stream_open(&info, &err);
-	if (ret) {
-		printf("spl: ymodem err - %s\n", xyzModem_error(err));
-		return ret;
-	}
-
-	while ((ret = xyzModem_stream_read(buf + size, BUF_SIZE, &err)) > 0)
-		size += ret;
+		if (ret != -ETIMEDOUT)
+			printf("spl: serial stream err - %d\n", ret);
 
-	xyzModem_stream_close(&err);
-	xyzModem_stream_terminate(false, &getcymodem);
+		if (!spl_mtk_ymodem_receive(buf, maxsize, &size))
+			break;
+	}
+#else
+	ret = spl_mtk_ymodem_receive(buf, maxsize, &size);
+	if (ret)
+		return ret;
+#endif
 
 	printf("Loaded %d bytes\n", size);
 
@@ -6,6 +6,9 @@
  */
 
 #include <common.h>
+#include <image.h>
+#include <scratch.h>
+#include <ubi_uboot.h>
 #include <asm/types.h>
 #include <linux/mtd/mtd.h>
 #include <linux/sizes.h>
@@ -13,12 +16,100 @@
 
 #include "../common/dual_image.h"
 
+#ifdef CONFIG_MTK_BOARDBOOT_UBI
+#define UBI_KERNEL_SCRATCH	"ubi kernel"
+
+/* Bytes written to the volume, 0 if it can't be opened */
+static size_t ubi_volume_used(const char *name)
+{
+	struct ubi_volume_desc *desc;
+	struct ubi_volume_info vi;
+
+	desc = ubi_open_volume_nm(0, name, UBI_READONLY);
+	if (IS_ERR(desc))
+		return 0;
+
+	ubi_get_volume_info(desc, &vi);
+	ubi_close_volume(desc);
+
+	return vi.used_bytes;
+}
+
+static int ubi_boot_kernel(void)
+{
+	char part[] = CONFIG_MTK_BOARDBOOT_UBI_PART;
+	char vol[] = CONFIG_MTK_BOARDBOOT_UBI_VOLUME;
+	size_t size, used;
+	char cmd[32];
+	void *buf;
+	int ret;
+
+	bootstage_mark_name(BOOTSTAGE_ID_UBI_ATTACH, "ubi_attach");
+	ret = ubi_part(part, NULL);
+	bootstage_mark_name(BOOTSTAGE_ID_UBI_ATTACH_DONE, "ubi_attach_done");
+	if (ret)
+		return ret;
+
+	/* Read the header first, and then only what the image takes */
+	buf = scratch_alloc(UBI_KERNEL_SCRATCH, sizeof(image_header_t));
+	if (!buf)
+		return CMD_RET_FAILURE;
+
+	ret = CMD_RET_FAILURE;
+
+	if (ubi_volume_read(vol, buf, sizeof(image_header_t)))
+		goto out;
+
+	switch (genimg_get_format(buf)) {
+	case IMAGE_FORMAT_LEGACY:
+		size = image_get_image_size(buf);
+		break;
+#if defined(CONFIG_FIT)
+	case IMAGE_FORMAT_FIT:
+		size = fit_get_size(buf);
+		break;
+#endif
+	default:
+		printf("No valid image in UBI volume '%s'\n", vol);
+		goto out;
+	}
+
+	/* The size comes from the volume, don't take it on trust */
+	used = ubi_volume_used(vol);
+	if (size > used || size > CONFIG_SYS_BOOTM_LEN) {
+		printf("Image in UBI volume '%s' is too large (%zu bytes)\n",
+		       vol, size);
+		goto out;
+	}
+
+	buf = scratch_alloc(UBI_KERNEL_SCRATCH, size);
+	if (!buf) {
+		printf("No memory to load %zu bytes from UBI volume '%s'\n",
+		       size, vol);
+		goto out;
+	}
+
+	if (ubi_volume_read(vol, buf, size))
+		goto out;
+
+	sprintf(cmd, "bootm 0x%p", buf);
+	ret = run_command(cmd, 0);
+
+out:
+	scratch_free(UBI_KERNEL_SCRATCH);
+
+	return ret;
+}
+#endif
+
 static int do_mtkboardboot(cmd_tbl_t *cmdtp, int flag, int argc,
 	char *const argv[])
 {
 	char cmd[128];
 	const char *ep;
 
+	bootstage_mark_name(BOOTSTAGE_ID_BOARDBOOT, "mtkboardboot");
+
 #ifdef CONFIG_MTK_DUAL_IMAGE_SUPPORT
 	dual_image_check();
 #endif
@@ -29,6 +120,10 @@ static int do_mtkboardboot(cmd_tbl_t *cmdtp, int flag, int argc,
 
 	env_set("autostart", "yes");
 
+#ifdef CONFIG_MTK_BOARDBOOT_UBI
+	ubi_boot_kernel();
+#endif
+
 #ifndef CONFIG_ENABLE_NAND_NMBM
 	run_command("nboot firmware", 0);
 
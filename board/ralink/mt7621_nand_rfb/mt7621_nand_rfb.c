@@ -132,9 +132,13 @@ int board_nmbm_init(void)
 		return 0;
 	}
 
+	bootstage_mark_name(BOOTSTAGE_ID_NMBM_INIT, "nmbm_init");
+
 	ret = nmbm_attach_mtd(lower, NMBM_F_CREATE, CONFIG_NMBM_MAX_RATIO,
 		CONFIG_NMBM_MAX_BLOCKS, &upper);
 
+	bootstage_mark_name(BOOTSTAGE_ID_NMBM_INIT_DONE, "nmbm_init_done");
+
 	printf("\n");
 
 	if (ret)
@@ -206,6 +210,13 @@ size_t mtk_board_get_flash_erase_size(void *flashdev)
 	return mtd->erasesize;
 }
 
+size_t mtk_board_get_flash_page_size(void *flashdev)
+{
+	struct mtd_info *mtd = (struct mtd_info *)flashdev;
+
+	return mtd->writesize;
+}
+
 int mtk_board_flash_erase(void *flashdev, uint64_t offset, uint64_t len)
 {
 	struct mtd_info *mtd = (struct mtd_info *)flashdev;
@@ -217,7 +228,9 @@ int mtk_board_flash_erase(void *flashdev, uint64_t offset, uint64_t len)
 	instr.addr = offset;
 	instr.len = len;
 
+	bootstage_start(BOOTSTAGE_ID_ACCUM_FLASH, "flash_io");
 	ret = mtd_erase(mtd, &instr);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_FLASH);
 	if (ret)
 		return ret;
 
@@ -234,7 +247,9 @@ int mtk_board_flash_read(void *flashdev, uint64_t offset, size_t len,
 	size_t retlen;
 	int ret;
 
+	bootstage_start(BOOTSTAGE_ID_ACCUM_FLASH, "flash_io");
 	ret = mtd_read(mtd, offset, len, &retlen, buf);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_FLASH);
 	if (ret && ret != -EUCLEAN)
 		return ret;
 
@@ -249,7 +264,12 @@ int mtk_board_flash_write(void *flashdev, uint64_t offset, size_t len,
 {
 	struct mtd_info *mtd = (struct mtd_info *)flashdev;
 	size_t retlen;
+	int ret;
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_FLASH, "flash_io");
+	ret = mtd_write(mtd, offset, len, &retlen, buf);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_FLASH);
 
-	return mtd_write(mtd, offset, len, &retlen, buf);
+	return ret;
 }
 #endif
@@ -56,9 +56,12 @@ static int mtkboardboot(void)
 	struct spi_flash *sf;
 	uint32_t fw_off = CONFIG_DEFAULT_NOR_KERNEL_OFFSET;
 	uint32_t load_addr, size;
+	ulong img;
 	u8 pnum;
 	int ret;
 
+	bootstage_mark_name(BOOTSTAGE_ID_BOARDBOOT, "mtkboardboot");
+
 #ifdef CONFIG_MTK_DUAL_IMAGE_SUPPORT
 	dual_image_check();
 #endif
@@ -93,13 +96,26 @@ static int mtkboardboot(void)
 		}
 
 		if (size + fw_off <= SZ_4M) {
-			sprintf(cmd, "bootm 0x%08x",
-				CONFIG_SPI_ADDR + fw_off);
+			/*
+			 * Boot through the cached alias of the window so
+			 * that verification and decompression read flash
+			 * in bursts. Drop lines which may be stale after
+			 * an upgrade.
+			 */
+			img = CKSEG0ADDR(CONFIG_SPI_ADDR + fw_off);
+			invalidate_dcache_range(img, img + size);
+
+			sprintf(cmd, "bootm 0x%08lx", img);
 
 			return run_command(cmd, 0);
 		}
 	}
 
+	/*
+	 * Larger images are read through spi_flash_read(), which copies the
+	 * part inside the window from its cached alias as well.
+	 */
+
 	sf = get_sf_dev();
 	if (!sf)
 		return CMD_RET_FAILURE;
@@ -134,7 +150,9 @@ static int mtkboardboot(void)
 
 	printf("Reading from flash 0x%x to mem 0x%08x, size 0x%x ... \n",
 		fw_off, load_addr, size);
+	bootstage_start(BOOTSTAGE_ID_ACCUM_FLASH, "flash_io");
 	ret = spi_flash_read(sf, fw_off, size, (void *) load_addr);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_FLASH);
 	if (ret)
 		return CMD_RET_FAILURE;
 
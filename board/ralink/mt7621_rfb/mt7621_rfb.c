@@ -203,26 +203,48 @@ size_t mtk_board_get_flash_erase_size(void *flashdev)
 	return flash->erase_size;
 }
 
+size_t mtk_board_get_flash_page_size(void *flashdev)
+{
+	struct spi_flash *flash = (struct spi_flash *)flashdev;
+
+	return flash->page_size;
+}
+
 int mtk_board_flash_erase(void *flashdev, uint64_t offset, uint64_t len)
 {
 	struct spi_flash *flash = (struct spi_flash *)flashdev;
+	int ret;
 
-	return spi_flash_erase(flash, offset, len);
+	bootstage_start(BOOTSTAGE_ID_ACCUM_FLASH, "flash_io");
+	ret = spi_flash_erase(flash, offset, len);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_FLASH);
+
+	return ret;
 }
 
 int mtk_board_flash_read(void *flashdev, uint64_t offset, size_t len,
 			 void *buf)
 {
 	struct spi_flash *flash = (struct spi_flash *)flashdev;
+	int ret;
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_FLASH, "flash_io");
+	ret = spi_flash_read(flash, offset, len, buf);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_FLASH);
 
-	return spi_flash_read(flash, offset, len, buf);
+	return ret;
 }
 
 int mtk_board_flash_write(void *flashdev, uint64_t offset, size_t len,
 			  const void *buf)
 {
 	struct spi_flash *flash = (struct spi_flash *)flashdev;
+	int ret;
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_FLASH, "flash_io");
+	ret = spi_flash_write(flash, offset, len, buf);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_FLASH);
 
-	return spi_flash_write(flash, offset, len, buf);
+	return ret;
 }
 #endif
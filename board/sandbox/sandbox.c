@@ -7,9 +7,12 @@
 #include <cros_ec.h>
 #include <dm.h>
 #include <led.h>
+#include <nand.h>
 #include <os.h>
 #include <asm/test.h>
 #include <asm/u-boot-sandbox.h>
+#include <nmbm/nmbm.h>
+#include <nmbm/nmbm-mtd.h>
 
 /*
  * Pointer to initial global data area
@@ -72,3 +75,29 @@ int board_late_init(void)
 	return 0;
 }
 #endif
+
+#ifdef CONFIG_NMBM_MTD
+/* Put NMBM on top of the sandbox NAND, the same way as MT7621 boards do */
+int board_nmbm_init(void)
+{
+	struct mtd_info *lower, *upper;
+	int ret;
+
+	lower = get_nand_dev_by_index(0);
+	if (!lower)
+		return 0;
+
+	bootstage_mark_name(BOOTSTAGE_ID_NMBM_INIT, "nmbm_init");
+
+	ret = nmbm_attach_mtd(lower, NMBM_F_CREATE, 1, 256, &upper);
+
+	bootstage_mark_name(BOOTSTAGE_ID_NMBM_INIT_DONE, "nmbm_init_done");
+
+	if (ret)
+		return 0;
+
+	add_mtd_device(upper);
+
+	return 0;
+}
+#endif
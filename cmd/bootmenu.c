@@ -235,7 +235,9 @@ static char *bootmenu_choice_entry(void *data)
 	while (1) {
 		if (menu->delay >= 0) {
 			/* Autoboot was not stopped */
+			bootstage_start(BOOTSTAGE_ID_ACCUM_WAIT, "wait");
 			bootmenu_autoboot_loop(menu, &key, &esc, &choice);
+			bootstage_accum(BOOTSTAGE_ID_ACCUM_WAIT);
 		} else {
 			/* Some key was pressed, so autoboot was stopped */
 			bootmenu_loop(menu, &key, &esc, &choice);
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Hash algorithm throughput benchmark
+ */
+
+#include <common.h>
+#include <command.h>
+#include <hash.h>
+#include <mapmem.h>
+#include <linux/math64.h>
+
+#define HASHBENCH_DEFAULT_SIZE	(4 << 20)
+
+static const char * const hashbench_algos[] = {
+	"crc32", "md5", "sha1", "sha256",
+};
+
+/* Return the throughput in KiB/s, or 0 if the run was too short to time */
+static ulong hashbench_run(struct hash_algo *algo, const void *buf,
+			   ulong size, ulong *msp)
+{
+	u8 output[HASH_MAX_DIGEST_SIZE];
+	ulong start, ms;
+
+	start = get_timer(0);
+	algo->hash_func_ws(buf, size, output, algo->chunk_size);
+	ms = get_timer(start);
+
+	*msp = ms;
+	if (!ms)
+		return 0;
+
+	return (ulong)div_u64((u64)size * 1000, ms * 1024);
+}
+
+static void hashbench_print(const char *label, ulong kbps, ulong ms)
+{
+	if (!kbps) {
+		printf("  %-9s   < 1 ms\n", label);
+		return;
+	}
+
+	printf("  %-9s %5lu.%02lu MiB/s  (%lu ms)\n", label, kbps / 1024,
+	       (kbps % 1024) * 100 / 1024, ms);
+}
+
+static int hashbench_one(const char *name, const u8 *buf, ulong size)
+{
+	struct hash_algo *algo;
+	ulong kbps, ms;
+
+	if (hash_lookup_algo(name, &algo))
+		return -EPROTONOSUPPORT;
+
+	printf("%s:\n", algo->name);
+
+	/* Warm up the caches so the first algorithm is not penalised */
+	hashbench_run(algo, buf, size, &ms);
+
+	kbps = hashbench_run(algo, buf, size, &ms);
+	hashbench_print("aligned", kbps, ms);
+
+	kbps = hashbench_run(algo, buf + 1, size, &ms);
+	hashbench_print("unaligned", kbps, ms);
+
+	return 0;
+}
+
+static int do_hashbench(cmd_tbl_t *cmdtp, int flag, int argc,
+			char * const argv[])
+{
+	const char *name = "all";
+	ulong addr = load_addr;
+	ulong size = HASHBENCH_DEFAULT_SIZE;
+	const u8 *buf;
+	int i, ret = 0;
+
+	if (argc > 4 || argc == 3)
+		return CMD_RET_USAGE;
+
+	if (argc > 1)
+		name = argv[1];
+
+	if (argc > 3) {
+		addr = simple_strtoul(argv[2], NULL, 16);
+		size = simple_strtoul(argv[3], NULL, 16);
+	}
+
+	if (!size)
+		return CMD_RET_USAGE;
+
+	/* The unaligned pass reads one byte past the buffer */
+	buf = map_sysmem(addr, size + 1);
+
+	printf("Hashing 0x%lx bytes at 0x%08lx\n", size, addr);
+
+	if (strcmp(name, "all")) {
+		ret = hashbench_one(name, buf, size);
+		if (ret)
+			printf("Unknown hash algorithm '%s'\n", name);
+	} else {
+		for (i = 0; i < ARRAY_SIZE(hashbench_algos); i++)
+			hashbench_one(hashbench_algos[i], buf, size);
+	}
+
+	unmap_sysmem(buf);
+
+	return ret ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	hashbench, 4, 0, do_hashbench,
+	"measure hash algorithm throughput",
+	"[algorithm|all] [address size]\n"
+	"    - hash 'size' bytes at 'address' (default: 4 MiB at $loadaddr)\n"
+	"      once word-aligned and once starting one byte later, and print\n"
+	"      the throughput of each pass"
+);
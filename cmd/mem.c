@@ -18,10 +18,14 @@
 #include <console.h>
 #include <hash.h>
 #include <inttypes.h>
+#include <malloc.h>
 #include <mapmem.h>
+#include <obj_pool.h>
+#include <scratch.h>
 #include <watchdog.h>
 #include <asm/io.h>
 #include <linux/compiler.h>
+#include <linux/math64.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -1177,10 +1181,44 @@ __weak void board_show_dram(phys_size_t size)
 	print_size(size, "\n");
 }
 
+static void show_heap(void)
+{
+	struct malloc_heap_info hi;
+
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return;
+
+	malloc_heap_info(&hi);
+
+	puts("Heap:  ");
+	print_size(hi.size, ", ");
+	print_size(hi.used, " used, ");
+	print_size(hi.free, " free, ");
+	print_size(hi.peak, " peak\n");
+
+	/* Share of the free space not in the largest chunk */
+	printf("       %d free chunks, largest ", hi.free_chunks);
+	print_size(hi.largest_free, ", ");
+	printf("fragmentation %lu%%\n", hi.free ?
+	       (ulong)(100 - div_u64((u64)hi.largest_free * 100, hi.free)) :
+	       0UL);
+}
+
 static int do_mem_info(cmd_tbl_t *cmdtp, int flag, int argc,
 		       char * const argv[])
 {
 	board_show_dram(gd->ram_size);
+	show_heap();
+
+	if (IS_ENABLED(CONFIG_OBJ_POOL)) {
+		puts("\n");
+		obj_pool_print_stats();
+	}
+
+	if (IS_ENABLED(CONFIG_SCRATCH)) {
+		puts("\n");
+		scratch_print();
+	}
 
 	return 0;
 }
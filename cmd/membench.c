@@ -0,0 +1,210 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * memcpy(), memmove() and memset() throughput benchmark
+ */
+
+#include <common.h>
+#include <command.h>
+#include <console.h>
+#include <mapmem.h>
+#include <linux/math64.h>
+#include <linux/sizes.h>
+
+#define MEMBENCH_DEFAULT_SIZE	SZ_1M
+#define MEMBENCH_MIN_SIZE	64
+
+/* Bytes to process for each measurement, so small sizes are timed too */
+#define MEMBENCH_BYTES		SZ_4M
+
+/* Room between and after the buffers for the offsets below */
+#define MEMBENCH_GAP		64
+
+enum membench_op {
+	MEMBENCH_COPY,
+	MEMBENCH_MOVE,
+	MEMBENCH_SET,
+};
+
+static const struct {
+	const char *label;
+	enum membench_op op;
+	unsigned int dst_off;
+	unsigned int src_off;
+} membench_cols[] = {
+	{ "copy", MEMBENCH_COPY, 0, 0 },
+	{ "copy+s1", MEMBENCH_COPY, 0, 1 },
+	{ "copy+d3", MEMBENCH_COPY, 3, 1 },
+	/* Overlapping with the destination above the source */
+	{ "move", MEMBENCH_MOVE, 8, 0 },
+	{ "set", MEMBENCH_SET, 0, 0 },
+	{ "set+d1", MEMBENCH_SET, 1, 0 },
+};
+
+static void membench_op(enum membench_op op, u8 *dst, u8 *src, ulong len)
+{
+	switch (op) {
+	case MEMBENCH_COPY:
+		memcpy(dst, src, len);
+		break;
+	case MEMBENCH_MOVE:
+		memmove(dst, src, len);
+		break;
+	case MEMBENCH_SET:
+		memset(dst, 0x5a, len);
+		break;
+	}
+}
+
+static u8 membench_pattern(ulong i)
+{
+	return i * 13 + (i >> 8);
+}
+
+/*
+ * Run one operation on fresh data, and check every byte of the destination
+ * buffer, including the ones around the destination, against what it
+ * should hold. This checks the arch versions on the board itself.
+ */
+static bool membench_verify(int col, u8 *dst, u8 *src, ulong len)
+{
+	enum membench_op op = membench_cols[col].op;
+	ulong doff = membench_cols[col].dst_off;
+	ulong soff = membench_cols[col].src_off;
+	ulong i;
+	u8 expect;
+
+	if (op == MEMBENCH_MOVE)
+		src = dst;
+
+	/* With src == dst the pattern is what both buffers end up with */
+	for (i = 0; i < len + MEMBENCH_GAP; i++) {
+		dst[i] = ~membench_pattern(i);
+		src[i] = membench_pattern(i);
+	}
+
+	membench_op(op, dst + doff, src + soff, len);
+
+	for (i = 0; i < len + MEMBENCH_GAP; i++) {
+		if (i < doff || i >= doff + len)
+			expect = op == MEMBENCH_MOVE ? membench_pattern(i) :
+						       ~membench_pattern(i);
+		else if (op == MEMBENCH_SET)
+			expect = 0x5a;
+		else
+			expect = membench_pattern(i - doff + soff);
+
+		if (dst[i] != expect)
+			return false;
+	}
+
+	return true;
+}
+
+/* Return the throughput in KiB/s, or 0 if the run was too short to time */
+static ulong membench_run(int col, u8 *dst, u8 *src, ulong len)
+{
+	enum membench_op op = membench_cols[col].op;
+	ulong reps = max(MEMBENCH_BYTES / len, 1UL);
+	ulong i, start, us;
+
+	if (op == MEMBENCH_MOVE)
+		src = dst;
+
+	dst += membench_cols[col].dst_off;
+	src += membench_cols[col].src_off;
+
+	/* Warm up the caches, so the first pass is not penalised */
+	membench_op(op, dst, src, len);
+
+	start = timer_get_us();
+	for (i = 0; i < reps; i++)
+		membench_op(op, dst, src, len);
+	us = timer_get_us() - start;
+
+	if (!us)
+		return 0;
+
+	return (ulong)div_u64((u64)len * reps * 1000000, (u64)us * 1024);
+}
+
+static int do_membench(cmd_tbl_t *cmdtp, int flag, int argc,
+		       char * const argv[])
+{
+	ulong addr = load_addr;
+	ulong size = MEMBENCH_DEFAULT_SIZE;
+	ulong len, kbps;
+	bool failed = false;
+	u8 *buf, *src;
+	int i;
+
+	if (argc != 1 && argc != 3)
+		return CMD_RET_USAGE;
+
+	if (argc > 2) {
+		addr = simple_strtoul(argv[1], NULL, 16);
+		size = simple_strtoul(argv[2], NULL, 16);
+	}
+
+	if (size < MEMBENCH_MIN_SIZE)
+		return CMD_RET_USAGE;
+
+	/* Destination, then source, each followed by a gap */
+	buf = map_sysmem(addr, 2 * (size + MEMBENCH_GAP));
+	src = buf + size + MEMBENCH_GAP;
+
+	printf("Benchmarking up to 0x%lx bytes at 0x%08lx ", size, addr);
+	printf("(%s memcpy, %s memset)\n",
+	       CONFIG_IS_ENABLED(USE_ARCH_MEMCPY) ? "arch" : "generic",
+	       CONFIG_IS_ENABLED(USE_ARCH_MEMSET) ? "arch" : "generic");
+
+	printf("%8s", "bytes");
+	for (i = 0; i < ARRAY_SIZE(membench_cols); i++)
+		printf(" %8s", membench_cols[i].label);
+	puts("  (MiB/s)\n");
+
+	for (len = MEMBENCH_MIN_SIZE; len <= size; len *= 4) {
+		printf("%8lu", len);
+
+		for (i = 0; i < ARRAY_SIZE(membench_cols); i++) {
+			if (!membench_verify(i, buf, src, len)) {
+				printf(" %8s", "FAIL");
+				failed = true;
+				continue;
+			}
+
+			kbps = membench_run(i, buf, src, len);
+			if (kbps)
+				printf(" %8lu", kbps / 1024);
+			else
+				printf(" %8s", "-");
+		}
+
+		puts("\n");
+
+		if (ctrlc())
+			break;
+	}
+
+	unmap_sysmem(buf);
+
+	if (failed) {
+		printf("Wrong results, see the FAIL entries\n");
+		return CMD_RET_FAILURE;
+	}
+
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	membench, 3, 0, do_membench,
+	"measure memcpy/memmove/memset throughput",
+	"[address size]\n"
+	"    - copy, move and fill 64 bytes to 'size' bytes (default: 1 MiB)\n"
+	"      at 'address' (default: $loadaddr), which needs room for two\n"
+	"      buffers of 'size' bytes plus 128 bytes, and print MiB/s\n"
+	"      Each result is checked first, FAIL means it was wrong\n"
+	"      copy+s1: source 1 byte past a word boundary\n"
+	"      copy+d3: destination 3 and source 1 byte past it\n"
+	"      move:    overlapping, destination 8 bytes above the source\n"
+	"      set+d1:  destination 1 byte past a word boundary"
+);
@@ -899,8 +899,10 @@ static int nand_load_image(cmd_tbl_t *cmdtp, struct mtd_info *mtd,
 	}
 	bootstage_mark(BOOTSTAGE_ID_NAND_TYPE);
 
+	bootstage_start(BOOTSTAGE_ID_ACCUM_FLASH, "flash_io");
 	r = nand_read_skip_bad(mtd, offset, &cnt, NULL, mtd->size,
 			       (u_char *)addr);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_FLASH);
 	if (r) {
 		puts("** Read error\n");
 		bootstage_error(BOOTSTAGE_ID_NAND_READ);
@@ -188,7 +188,9 @@ static int do_nmbm_mtd_boot(cmd_tbl_t *cmdtp, struct mtd_info *mtd,
 	printf("Loading %s image at offset 0x%llx to memory 0x%08lx, size 0x%x ...\n",
 	       image_name, off, loadaddr, size);
 
+	bootstage_start(BOOTSTAGE_ID_ACCUM_FLASH, "flash_io");
 	ret = mtd_read(mtd, off, size, &retlen, (void *)loadaddr);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_FLASH);
 	if (ret || retlen != size) {
 		printf("Error: Failed to load image at offset 0x%08llx\n",
 		       off + retlen);
@@ -665,6 +665,26 @@ static int do_usb(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 		usb_stop();
 		return 0;
 	}
+#ifdef CONFIG_USB_STORAGE_LOAD
+	if (strncmp(argv[1], "load", 4) == 0) {
+		ulong addr;
+		loff_t max = LLONG_MAX, size;
+
+		if (argc < 4)
+			return CMD_RET_USAGE;
+
+		addr = simple_strtoul(argv[2], NULL, 16);
+		if (argc > 4)
+			max = simple_strtoull(argv[4], NULL, 16);
+
+		if (usb_stor_load_file(argv[3], addr, max, &size))
+			return CMD_RET_FAILURE;
+
+		env_set_hex("filesize", size);
+
+		return 0;
+	}
+#endif
 	if (!usb_started) {
 		printf("USB is stopped. Please issue 'usb start' first.\n");
 		return 1;
@@ -751,6 +771,10 @@ U_BOOT_CMD(
 	"usb write addr blk# cnt - write `cnt' blocks starting at block `blk#'\n"
 	"    from memory address `addr'"
 #endif /* CONFIG_USB_STORAGE */
+#ifdef CONFIG_USB_STORAGE_LOAD
+	"\nusb load addr file [maxsize] - load `file' from the first USB\n"
+	"    storage device having it to memory address `addr'"
+#endif
 );
 
 
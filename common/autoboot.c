@@ -259,8 +259,11 @@ static int abortboot(int bootdelay)
 {
 	int abort = 0;
 
-	if (bootdelay >= 0)
+	if (bootdelay >= 0) {
+		bootstage_start(BOOTSTAGE_ID_ACCUM_WAIT, "wait");
 		abort = __abortboot(bootdelay);
+		bootstage_accum(BOOTSTAGE_ID_ACCUM_WAIT);
+	}
 
 #ifdef CONFIG_SILENT_CONSOLE
 	if (abort)
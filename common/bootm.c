@@ -13,6 +13,7 @@
 #include <lmb.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <mblock.h>
 #include <asm/io.h>
 #include <linux/lzo.h>
 #include <lzma/LzmaTypes.h>
@@ -23,6 +24,7 @@
 #endif
 #else
 #include "mkimage.h"
+#include <bootstage.h>
 #endif
 
 #include <command.h>
@@ -74,6 +76,10 @@ static inline void boot_start_lmb(bootm_headers_t *images) { }
 static int bootm_start(cmd_tbl_t *cmdtp, int flag, int argc,
 		       char * const argv[])
 {
+#if IMAGE_ENABLE_FIT && IMAGE_ENABLE_FUSED_VERIFY
+	/* Release hash contexts left behind by an earlier failed bootm */
+	fit_fused_verify_abort(&images.os_verify);
+#endif
 	memset((void *)&images, 0, sizeof(images));
 	images.verify = env_get_yesno("verify");
 
@@ -355,32 +361,44 @@ static int handle_decomp_error(int comp_type, size_t uncomp_size,
 	return BOOTM_ERR_RESET;
 }
 
-int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
-		       void *load_buf, void *image_buf, ulong image_len,
-		       uint unc_len, ulong *load_end)
+/**
+ * decomp_image() - decompress an image, optionally reporting its input
+ *
+ * After this, *image_len is set to the number of uncompressed bytes loaded.
+ * If @input is not NULL it is called with the compressed data as it is
+ * consumed. Only gzip, LZMA and LZ4 support this; callers must not pass
+ * @input for other compression types.
+ *
+ * The error codes of the decompressors overlap with the BOOTM_ERR_... codes
+ * (e.g. BZ_MEM_ERROR is BOOTM_ERR_UNIMPLEMENTED), so they are returned in
+ * @errp instead.
+ *
+ * @errp:	returns the error code of the decompressor, 0 if none
+ * @return 0 if OK, BOOTM_ERR_UNIMPLEMENTED for an unknown compression type,
+ * -EIO on decompression error
+ */
+static int decomp_image(int comp, void *load_buf, void *image_buf,
+			ulong *image_len, uint unc_len,
+			decomp_input_fn input, void *priv, int *errp)
 {
 	int ret = 0;
 
-	*load_end = load;
-	print_decomp_msg(comp, type, load == image_start);
+	*errp = 0;
 
-	/*
-	 * Load the image to the right place, decompressing if needed. After
-	 * this, image_len will be set to the number of uncompressed bytes
-	 * loaded, ret will be non-zero on error.
-	 */
+	bootstage_start(BOOTSTAGE_ID_ACCUM_DECOMP, "decompress");
 	switch (comp) {
 	case IH_COMP_NONE:
-		if (load == image_start)
+		if (load_buf == image_buf)
 			break;
-		if (image_len <= unc_len)
-			memmove_wd(load_buf, image_buf, image_len, CHUNKSZ);
+		if (*image_len <= unc_len)
+			memmove_wd(load_buf, image_buf, *image_len, CHUNKSZ);
 		else
 			ret = 1;
 		break;
 #ifdef CONFIG_GZIP
 	case IH_COMP_GZIP: {
-		ret = gunzip(load_buf, unc_len, image_buf, &image_len);
+		ret = gunzip_cb(load_buf, unc_len, image_buf, image_len,
+				input, priv);
 		break;
 	}
 #endif /* CONFIG_GZIP */
@@ -394,9 +412,9 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 		 * at most 2300 KB of memory.
 		 */
 		ret = BZ2_bzBuffToBuffDecompress(load_buf, &size,
-			image_buf, image_len,
+			image_buf, *image_len,
 			CONFIG_SYS_MALLOC_LEN < (4096 * 1024), 0);
-		image_len = size;
+		*image_len = size;
 		break;
 	}
 #endif /* CONFIG_BZIP2 */
@@ -404,9 +422,10 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 	case IH_COMP_LZMA: {
 		SizeT lzma_len = unc_len;
 
-		ret = lzmaBuffToBuffDecompress(load_buf, &lzma_len,
-					       image_buf, image_len);
-		image_len = lzma_len;
+		ret = lzmaBuffToBuffDecompressCb(load_buf, &lzma_len,
+						 image_buf, *image_len,
+						 input, priv);
+		*image_len = lzma_len;
 		break;
 	}
 #endif /* CONFIG_LZMA */
@@ -414,8 +433,8 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 	case IH_COMP_LZO: {
 		size_t size = unc_len;
 
-		ret = lzop_decompress(image_buf, image_len, load_buf, &size);
-		image_len = size;
+		ret = lzop_decompress(image_buf, *image_len, load_buf, &size);
+		*image_len = size;
 		break;
 	}
 #endif /* CONFIG_LZO */
@@ -423,18 +442,53 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 	case IH_COMP_LZ4: {
 		size_t size = unc_len;
 
-		ret = ulz4fn(image_buf, image_len, load_buf, &size);
-		image_len = size;
+		ret = ulz4fn_cb(image_buf, *image_len, load_buf, &size,
+				input, priv);
+		*image_len = size;
 		break;
 	}
 #endif /* CONFIG_LZ4 */
+#ifdef CONFIG_MBLOCK
+	case IH_COMP_MBLOCK: {
+		size_t size = unc_len;
+
+		ret = mblock_decompress(load_buf, &size, image_buf, *image_len);
+		*image_len = size;
+		break;
+	}
+#endif /* CONFIG_MBLOCK */
 	default:
 		printf("Unimplemented compression type %d\n", comp);
+		bootstage_accum(BOOTSTAGE_ID_ACCUM_DECOMP);
 		return BOOTM_ERR_UNIMPLEMENTED;
 	}
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_DECOMP);
 
+	*errp = ret;
+
+	return ret ? -EIO : 0;
+}
+
+int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
+		       void *load_buf, void *image_buf, ulong image_len,
+		       uint unc_len, ulong *load_end)
+{
+	int ret, err;
+
+	*load_end = load;
+	print_decomp_msg(comp, type, load == image_start);
+
+	/*
+	 * Load the image to the right place, decompressing if needed. After
+	 * this, image_len will be set to the number of uncompressed bytes
+	 * loaded, ret will be non-zero on error.
+	 */
+	ret = decomp_image(comp, load_buf, image_buf, &image_len, unc_len,
+			   NULL, NULL, &err);
+	if (ret == BOOTM_ERR_UNIMPLEMENTED)
+		return ret;
 	if (ret)
-		return handle_decomp_error(comp, image_len, unc_len, ret);
+		return handle_decomp_error(comp, image_len, unc_len, err);
 	*load_end = load + image_len;
 
 	puts("OK\n");
@@ -443,6 +497,46 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 }
 
 #ifndef USE_HOSTCC
+#if IMAGE_ENABLE_FIT && IMAGE_ENABLE_FUSED_VERIFY
+/*
+ * Decompress a FIT kernel whose hashes were deferred by fit_image_load(),
+ * hashing the compressed data as the decompressor consumes it. A hash
+ * mismatch is reported in preference to a decompression error, since the
+ * latter is most likely caused by the former.
+ */
+static int bootm_load_os_verify(bootm_headers_t *images, void *load_buf,
+				void *image_buf, ulong *load_end)
+{
+	image_info_t *os = &images->os;
+	ulong image_len = os->image_len;
+	int ret, err;
+
+	*load_end = os->load;
+	print_decomp_msg(os->comp, os->type, false);
+
+	ret = decomp_image(os->comp, load_buf, image_buf, &image_len,
+			   CONFIG_SYS_BOOTM_LEN, fit_fused_verify_input,
+			   &images->os_verify, &err);
+	puts(ret ? "error!\n" : "OK\n");
+
+	puts("   Verifying Hash Integrity ... ");
+	if (fit_fused_verify_finish(&images->os_verify, image_buf,
+				    os->image_len)) {
+		puts("Bad Data Hash\n");
+		bootstage_error(BOOTSTAGE_ID_FIT_KERNEL_START +
+				BOOTSTAGE_SUB_HASH);
+		return 1;
+	}
+
+	if (ret)
+		return handle_decomp_error(os->comp, image_len,
+					   CONFIG_SYS_BOOTM_LEN, err);
+	*load_end = os->load + image_len;
+
+	return 0;
+}
+#endif
+
 static int bootm_load_os(bootm_headers_t *images, int boot_progress)
 {
 	image_info_t os = images->os;
@@ -460,6 +554,12 @@ static int bootm_load_os(bootm_headers_t *images, int boot_progress)
 
 	load_buf = map_sysmem(load, 0);
 	image_buf = map_sysmem(os.image_start, image_len);
+#if IMAGE_ENABLE_FIT && IMAGE_ENABLE_FUSED_VERIFY
+	if (images->os_verify.count)
+		err = bootm_load_os_verify(images, load_buf, image_buf,
+					   &load_end);
+	else
+#endif
 	err = bootm_decomp_image(os.comp, load, os.image_start, os.type,
 				 load_buf, image_buf, image_len,
 				 CONFIG_SYS_BOOTM_LEN, &load_end);
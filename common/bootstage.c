@@ -10,6 +10,7 @@
  */
 
 #include <common.h>
+#include <div64.h>
 #include <linux/libfdt.h>
 #include <malloc.h>
 #include <linux/compiler.h>
@@ -239,6 +240,52 @@ static int h_compare_record(const void *r1, const void *r2)
 	return rec1->time_us > rec2->time_us ? 1 : -1;
 }
 
+static void print_time_percent(ulong time_us, ulong total_us,
+			       const char *name)
+{
+	u64 permille = (u64)time_us * 1000;
+
+	do_div(permille, total_us);
+	print_grouped_ull(time_us, BOOTSTAGE_DIGITS);
+	printf("%4u.%u%%  %s\n", (uint)permille / 10, (uint)permille % 10,
+	       name);
+}
+
+/**
+ * Print how the time up to the last mark was spent
+ *
+ * Accumulated records (flash I/O, hashing, decompression, ...) are shown as
+ * a share of the total boot time; whatever is not covered by any of them is
+ * reported as "other".
+ *
+ * @param data		Bootstage data
+ * @param total_us	Time of the last mark record
+ */
+static void print_time_breakdown(struct bootstage_data *data, ulong total_us)
+{
+	struct bootstage_record *rec;
+	ulong accounted = 0;
+	char buf[20];
+	int i;
+
+	if (!total_us)
+		return;
+
+	puts("\nTime breakdown:\n");
+	for (i = 0, rec = data->record; i < data->rec_count; i++, rec++) {
+		if (!rec->start_us)
+			continue;
+
+		print_time_percent(rec->time_us, total_us,
+				   get_record_name(buf, sizeof(buf), rec));
+		accounted += rec->time_us;
+	}
+
+	if (accounted < total_us)
+		print_time_percent(total_us - accounted, total_us, "other");
+	print_time_percent(total_us, total_us, "total");
+}
+
 #ifdef CONFIG_OF_LIBFDT
 /**
  * Add all bootstage timings to a device tree.
@@ -332,8 +379,10 @@ void bootstage_report(void)
 	puts("\nAccumulated time:\n");
 	for (i = 0, rec = data->record; i < data->rec_count; i++, rec++) {
 		if (rec->start_us)
-			prev = print_time_record(rec, -1);
+			print_time_record(rec, -1);
 	}
+
+	print_time_breakdown(data, prev);
 }
 
 /**
@@ -468,7 +517,7 @@ int bootstage_unstash(const void *base, int size)
 
 	/* Read the name strings */
 	ptr += rec_size;
-	for (rec = data->record + data->next_id, i = 0; i < hdr->count;
+	for (rec = data->record + data->rec_count, i = 0; i < hdr->count;
 	     i++, rec++) {
 		rec->name = ptr;
 
@@ -498,10 +547,9 @@ int bootstage_init(bool first)
 		return -ENOMEM;
 	data = gd->bootstage;
 	memset(data, '\0', size);
-	if (first) {
-		data->next_id = BOOTSTAGE_ID_USER;
+	data->next_id = BOOTSTAGE_ID_USER;
+	if (first)
 		bootstage_add_record(BOOTSTAGE_ID_AWAKE, "reset", 0, 0);
-	}
 
 	return 0;
 }
@@ -2344,6 +2344,48 @@ struct mallinfo mALLINFo()
 
 
 
+/*
+  malloc_heap_info:
+
+    Reports the use of the heap, and how fragmented its free space is.
+    Unlike mallinfo, the free lists are only walked, not checked, so it is
+    cheap enough to be used without DEBUG. The part of the heap not yet
+    obtained via sbrk counts as free, and as part of the top chunk.
+*/
+
+void malloc_heap_info(struct malloc_heap_info *info)
+{
+  int i;
+  mbinptr b;
+  mchunkptr p;
+  INTERNAL_SIZE_T size;
+  INTERNAL_SIZE_T avail = chunksize(top);
+  INTERNAL_SIZE_T largest = avail + (mem_malloc_end - mem_malloc_brk);
+  int navail = 1;
+
+  for (i = 1; i < NAV; ++i)
+  {
+    b = bin_at(i);
+    for (p = last(b); p != b; p = p->bk)
+    {
+      size = chunksize(p);
+      avail += size;
+      if (size > largest)
+	largest = size;
+      navail++;
+    }
+  }
+
+  info->size = mem_malloc_end - mem_malloc_start;
+  info->used = sbrked_mem - avail;
+  info->peak = max_sbrked_mem;
+  info->free = info->size - info->used;
+  info->largest_free = largest;
+  info->free_chunks = navail;
+}
+
+
+
 
 /*
   mallopt:
@@ -85,6 +85,34 @@ static int hash_finish_sha256(struct hash_algo *algo, void *ctx, void
 }
 #endif
 
+#if defined(CONFIG_MD5)
+static int hash_init_md5(struct hash_algo *algo, void **ctxp)
+{
+	struct MD5Context *ctx = malloc(sizeof(struct MD5Context));
+	MD5Init(ctx);
+	*ctxp = ctx;
+	return 0;
+}
+
+static int hash_update_md5(struct hash_algo *algo, void *ctx, const void *buf,
+			   unsigned int size, int is_last)
+{
+	MD5Update((struct MD5Context *)ctx, buf, size);
+	return 0;
+}
+
+static int hash_finish_md5(struct hash_algo *algo, void *ctx, void *dest_buf,
+			   int size)
+{
+	if (size < algo->digest_size)
+		return -1;
+
+	MD5Final(dest_buf, (struct MD5Context *)ctx);
+	free(ctx);
+	return 0;
+}
+#endif
+
 static int hash_init_crc32(struct hash_algo *algo, void **ctxp)
 {
 	uint32_t *ctx = malloc(sizeof(uint32_t));
@@ -106,7 +134,9 @@ static int hash_finish_crc32(struct hash_algo *algo, void *ctx, void *dest_buf,
 	if (size < algo->digest_size)
 		return -1;
 
-	*((uint32_t *)dest_buf) = *((uint32_t *)ctx);
+	/* Same byte order as crc32_wd_buf() */
+	*((uint32_t *)ctx) = cpu_to_be32(*((uint32_t *)ctx));
+	memcpy(dest_buf, ctx, sizeof(uint32_t));
 	free(ctx);
 	return 0;
 }
@@ -158,6 +188,17 @@ static struct hash_algo hash_algo[] = {
 		.hash_finish	= hash_finish_sha256,
 #endif
 	},
+#endif
+#ifdef CONFIG_MD5
+	{
+		.name		= "md5",
+		.digest_size	= 16,
+		.chunk_size	= CHUNKSZ_MD5,
+		.hash_func_ws	= md5_wd,
+		.hash_init	= hash_init_md5,
+		.hash_update	= hash_update_md5,
+		.hash_finish	= hash_finish_md5,
+	},
 #endif
 	{
 		.name		= "crc32",
@@ -254,6 +295,117 @@ int hash_block(const char *algo_name, const void *data, unsigned int len,
 	return 0;
 }
 
+int hash_stream_start(struct hash_stream *hs, const char *algo_name,
+		      ulong skip)
+{
+	struct hash_algo *algo;
+	int ret;
+
+	ret = hash_progressive_lookup_algo(algo_name, &algo);
+	if (ret)
+		return ret;
+
+	memset(hs, 0, sizeof(*hs));
+	hs->algo = algo;
+	hs->skip = skip;
+
+	if (algo->hash_init(algo, &hs->ctx) || !hs->ctx) {
+		hs->ctx = NULL;
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+void hash_stream_abort(struct hash_stream *hs)
+{
+	u8 output[HASH_MAX_DIGEST_SIZE];
+
+	/* hash_finish() is the only way to release the context */
+	if (hs->ctx)
+		hs->algo->hash_finish(hs->algo, hs->ctx, output,
+				      sizeof(output));
+
+	hs->ctx = NULL;
+}
+
+void hash_stream_reset(struct hash_stream *hs)
+{
+	hash_stream_abort(hs);
+
+	hs->pos = 0;
+	hs->hashed = 0;
+	hs->broken = false;
+	hs->started = false;
+
+	if (hs->algo->hash_init(hs->algo, &hs->ctx))
+		hs->ctx = NULL;
+}
+
+void hash_stream_update(struct hash_stream *hs, ulong offset,
+			const void *buf, ulong size)
+{
+	ulong end = offset + size;
+	ulong from, to;
+
+	if (!hs->ctx || hs->broken || end <= hs->pos)
+		return;
+
+	if (offset > hs->pos) {
+		debug("%s: gap at 0x%lx, expected 0x%lx\n", __func__, offset,
+		      hs->pos);
+		hs->broken = true;
+		return;
+	}
+
+	if (!hs->started && end > hs->skip) {
+		hs->started = true;
+		if (hs->start)
+			hs->start(hs);
+		if (hs->broken)
+			return;
+	}
+
+	from = max(hs->pos, hs->skip);
+	to = end;
+	if (hs->len && to > hs->skip + hs->len)
+		to = hs->skip + hs->len;
+
+	hs->pos = end;
+
+	if (to <= from)
+		return;
+
+	if (hs->algo->hash_update(hs->algo, hs->ctx,
+				  (const u8 *)buf + (from - offset), to - from,
+				  0)) {
+		/* The context has been freed on error */
+		hs->ctx = NULL;
+		hs->broken = true;
+		return;
+	}
+
+	hs->hashed += to - from;
+}
+
+int hash_stream_finish(struct hash_stream *hs, void *output, int size)
+{
+	int ret;
+
+	if (!hs->ctx)
+		return -EIO;
+
+	if (hs->broken) {
+		hash_stream_abort(hs);
+		return -EIO;
+	}
+
+	ret = hs->algo->hash_finish(hs->algo, hs->ctx, output, size);
+	hs->ctx = NULL;
+
+	return ret;
+}
+
 #if defined(CONFIG_CMD_HASH) || defined(CONFIG_CMD_SHA1SUM) || defined(CONFIG_CMD_CRC32)
 /**
  * store_result: Store the resulting sum to an address or variable
@@ -1162,6 +1162,7 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 	uint8_t *fit_value;
 	int fit_value_len;
 	int ignore;
+	int ret;
 
 	*err_msgp = NULL;
 
@@ -1185,7 +1186,10 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 		return -1;
 	}
 
-	if (calculate_hash(data, size, algo, value, &value_len)) {
+	bootstage_start(BOOTSTAGE_ID_ACCUM_HASH, "hash");
+	ret = calculate_hash(data, size, algo, value, &value_len);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_HASH);
+	if (ret) {
 		*err_msgp = "Unsupported hash algorithm";
 		return -1;
 	}
@@ -1347,6 +1351,160 @@ int fit_all_image_verify(const void *fit)
 	return 1;
 }
 
+#if IMAGE_ENABLE_FUSED_VERIFY
+/**
+ * fit_image_defer_verify - set up hashing of an image during decompression
+ * @fit: pointer to the FIT format image header
+ * @image_noffset: component image node offset
+ * @fv: pointer to the verification state to set up
+ *
+ * fit_image_defer_verify() checks whether all hashes of a compressed image
+ * can be calculated from the data passed to fit_fused_verify_input() by
+ * the decompressor. If so, it starts a stream hash for each of them and
+ * saves the expected digests, as the FIT may be overwritten later on.
+ *
+ * returns:
+ *     0, if verification is deferred
+ *     -ENOTSUPP, if the image must be verified as usual
+ */
+int fit_image_defer_verify(const void *fit, int image_noffset,
+			   struct fit_fused_verify *fv)
+{
+	int noffset;
+	uint8_t comp;
+	uint8_t *value;
+	char *algo;
+	int ignore;
+	int len;
+
+	fit_fused_verify_abort(fv);
+
+	if (fit_image_get_comp(fit, image_noffset, &comp))
+		return -ENOTSUPP;
+
+	switch (comp) {
+#ifdef CONFIG_GZIP
+	case IH_COMP_GZIP:
+#endif
+#ifdef CONFIG_LZMA
+	case IH_COMP_LZMA:
+#endif
+#ifdef CONFIG_LZ4
+	case IH_COMP_LZ4:
+#endif
+		break;
+	default:
+		return -ENOTSUPP;
+	}
+
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+
+		if (strncmp(name, FIT_HASH_NODENAME,
+			    strlen(FIT_HASH_NODENAME)))
+			continue;
+
+		if (IMAGE_ENABLE_IGNORE) {
+			fit_image_hash_get_ignore(fit, noffset, &ignore);
+			if (ignore)
+				continue;
+		}
+
+		if (fv->count == FIT_FUSED_MAX_HASHES ||
+		    fit_image_hash_get_algo(fit, noffset, &algo) ||
+		    fit_image_hash_get_value(fit, noffset, &value, &len) ||
+		    len > HASH_MAX_DIGEST_SIZE ||
+		    hash_stream_start(&fv->hs[fv->count], algo, 0))
+			goto fallback;
+
+		memcpy(fv->value[fv->count], value, len);
+		fv->value_len[fv->count] = len;
+		fv->count++;
+	}
+
+	if (noffset == -FDT_ERR_TRUNCATED || noffset == -FDT_ERR_BADSTRUCTURE ||
+	    !fv->count)
+		goto fallback;
+
+	return 0;
+
+fallback:
+	fit_fused_verify_abort(fv);
+	return -ENOTSUPP;
+}
+
+/* Called by the decompressor with each piece of input it consumes */
+void fit_fused_verify_input(void *priv, const void *buf, size_t len)
+{
+	struct fit_fused_verify *fv = priv;
+	int i;
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_HASH, "hash");
+	for (i = 0; i < fv->count; i++)
+		hash_stream_update(&fv->hs[i], fv->pos, buf, len);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_HASH);
+	fv->pos += len;
+}
+
+/**
+ * fit_fused_verify_finish - check the hashes of a decompressed image
+ * @fv: verification state set up by fit_image_defer_verify()
+ * @data: start of the compressed image data
+ * @size: size of the compressed image data
+ *
+ * Data which the decompressor did not consume (e.g. a trailer, or all of
+ * it after a decompression error) is hashed from @data before the digests
+ * are compared. The state is released in all cases.
+ *
+ * returns:
+ *     0, if all hashes are valid
+ *     -EACCES, otherwise
+ */
+int fit_fused_verify_finish(struct fit_fused_verify *fv, const void *data,
+			    size_t size)
+{
+	uint8_t value[HASH_MAX_DIGEST_SIZE];
+	struct hash_stream *hs;
+	int ret = 0;
+	int i;
+
+	for (i = 0; i < fv->count; i++) {
+		hs = &fv->hs[i];
+
+		bootstage_start(BOOTSTAGE_ID_ACCUM_HASH, "hash");
+		hash_stream_update(hs, 0, data, size);
+		bootstage_accum(BOOTSTAGE_ID_ACCUM_HASH);
+		printf("%s", hs->algo->name);
+
+		if (hs->pos != size ||
+		    hash_stream_finish(hs, value, sizeof(value)) ||
+		    hs->algo->digest_size != fv->value_len[i] ||
+		    memcmp(value, fv->value[i], fv->value_len[i])) {
+			puts("- ");
+			ret = -EACCES;
+		} else {
+			puts("+ ");
+		}
+	}
+
+	fit_fused_verify_abort(fv);
+	if (!ret)
+		puts("OK\n");
+
+	return ret;
+}
+
+void fit_fused_verify_abort(struct fit_fused_verify *fv)
+{
+	int i;
+
+	for (i = 0; i < fv->count; i++)
+		hash_stream_abort(&fv->hs[i]);
+	fv->count = 0;
+	fv->pos = 0;
+}
+#endif
+
 /**
  * fit_image_check_os - check whether image node is of a given os type
  * @fit: pointer to the FIT format image header
@@ -1704,12 +1862,19 @@ int fit_conf_get_prop_node(const void *fit, int noffset,
 	return fit_conf_get_prop_node_index(fit, noffset, prop_name, 0);
 }
 
-static int fit_image_select(const void *fit, int rd_noffset, int verify)
+static int fit_image_select(const void *fit, int rd_noffset, int verify,
+			    struct fit_fused_verify *fv)
 {
 	fit_image_print(fit, rd_noffset, "   ");
 
 	if (verify) {
 		puts("   Verifying Hash Integrity ... ");
+#if IMAGE_ENABLE_FUSED_VERIFY
+		if (fv && !fit_image_defer_verify(fit, rd_noffset, fv)) {
+			puts("deferred to decompression\n");
+			return 0;
+		}
+#endif
 		if (!fit_image_verify(fit, rd_noffset)) {
 			puts("Bad Data Hash\n");
 			return -EACCES;
@@ -1799,6 +1964,7 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 	uint8_t os_arch;
 #endif
 	const char *prop_name;
+	struct fit_fused_verify *fv = NULL;
 	int ret;
 
 	fit = map_sysmem(addr, 0);
@@ -1870,7 +2036,12 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 
 	printf("   Trying '%s' %s subimage\n", fit_uname, prop_name);
 
-	ret = fit_image_select(fit, noffset, images->verify);
+#if IMAGE_ENABLE_FUSED_VERIFY
+	/* Only a kernel loaded by bootm_load_os() is decompressed in place */
+	if (image_type == IH_TYPE_KERNEL && load_op == FIT_LOAD_IGNORED)
+		fv = &images->os_verify;
+#endif
+	ret = fit_image_select(fit, noffset, images->verify, fv);
 	if (ret) {
 		bootstage_error(bootstage_id + BOOTSTAGE_SUB_HASH);
 		return ret;
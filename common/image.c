@@ -47,6 +47,7 @@ static const image_header_t *image_get_ramdisk(ulong rd_addr, uint8_t arch,
 #include <u-boot/md5.h>
 #include <time.h>
 #include <image.h>
+#include <bootstage.h>
 
 #ifndef __maybe_unused
 # define __maybe_unused		/* unimplemented */
@@ -176,6 +177,7 @@ static const table_entry_t uimage_comp[] = {
 	{	IH_COMP_LZMA,	"lzma",		"lzma compressed",	},
 	{	IH_COMP_LZO,	"lzo",		"lzo compressed",	},
 	{	IH_COMP_LZ4,	"lz4",		"lz4 compressed",	},
+	{	IH_COMP_MBLOCK,	"mblock",	"multi-block compressed", },
 	{	-1,		"",		"",			},
 };
 
@@ -214,7 +216,11 @@ int image_check_dcrc(const image_header_t *hdr)
 {
 	ulong data = image_get_data(hdr);
 	ulong len = image_get_data_size(hdr);
-	ulong dcrc = crc32_wd(0, (unsigned char *)data, len, CHUNKSZ_CRC32);
+	ulong dcrc;
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_HASH, "hash");
+	dcrc = crc32_wd(0, (unsigned char *)data, len, CHUNKSZ_CRC32);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_HASH);
 
 	return (dcrc == image_get_dcrc(hdr));
 }
@@ -0,0 +1,327 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Streaming file transfer over the serial console, see
+ * include/serial_stream.h for the protocol.
+ */
+
+#include <common.h>
+#include <serial.h>
+#include <serial_stream.h>
+#include <watchdog.h>
+#include <asm/unaligned.h>
+#include <u-boot/crc.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define SS_HDR_SIZE		8
+#define SS_CHAR_TIMEOUT		100	/* ms, within a frame */
+#define SS_SWITCH_TIMEOUT	1500	/* ms, for the SYNC at the new rate */
+#define SS_IDLE_TIMEOUT		3000	/* ms, once the transfer has started */
+#define SS_NAK_INTERVAL		100	/* ms, between repeated NAKs */
+
+/* Leave some margin for the error of the host side */
+#define SS_MAX_BAUD_ERR		20	/* 1/1000 */
+
+#define CTRL_C			0x03
+
+static const int serial_stream_bauds[] = {
+	3000000, 2000000, 1500000, 1000000, 921600, 460800, 230400, 115200
+};
+
+struct serial_stream {
+	u8 *buf;
+	size_t max;
+	size_t size;
+	size_t pos;
+	bool started;
+	ulong nak_time;
+
+	/* Last frame received */
+	u8 type;
+	u32 arg;
+	u32 len;
+	bool in_place;
+};
+
+/* Payload of frames not stored straight into the file buffer */
+static u8 serial_stream_scratch[SERIAL_STREAM_MAX_DATA];
+
+__weak int serial_baud_error(int baud)
+{
+	return 0;
+}
+
+static int ss_getc(ulong timeout)
+{
+	ulong start;
+
+	if (!tstc()) {
+		start = get_timer(0);
+
+		while (!tstc()) {
+			if (get_timer(start) >= timeout)
+				return -ETIMEDOUT;
+
+			WATCHDOG_RESET();
+		}
+	}
+
+	return getc();
+}
+
+/*
+ * Look for the next frame within @timeout ms, and read it. The payload of a
+ * DATA frame which is next in the file goes straight to its place.
+ */
+static int ss_recv_frame(struct serial_stream *ss, ulong timeout,
+			 bool cancel)
+{
+	u8 hdr[SS_HDR_SIZE], crcb[4];
+	ulong start = get_timer(0), elapsed;
+	int i, c, prev = -1;
+	u8 *dst;
+	u32 crc;
+
+	for (;;) {
+		elapsed = get_timer(start);
+		if (elapsed >= timeout)
+			return -ETIMEDOUT;
+
+		c = ss_getc(timeout - elapsed);
+		if (c < 0)
+			return c;
+
+		if (prev == SERIAL_STREAM_SYNC0 && c == SERIAL_STREAM_SYNC1)
+			break;
+
+		if (cancel && c == CTRL_C)
+			return -ECANCELED;
+
+		prev = c;
+	}
+
+	for (i = 0; i < SS_HDR_SIZE; i++) {
+		c = ss_getc(SS_CHAR_TIMEOUT);
+		if (c < 0)
+			return -EBADMSG;
+		hdr[i] = c;
+	}
+
+	ss->type = hdr[0];
+	ss->arg = get_unaligned_be32(hdr + 2);
+	ss->len = get_unaligned_be16(hdr + 6);
+
+	if (ss->len > SERIAL_STREAM_MAX_DATA)
+		return -EBADMSG;
+
+	ss->in_place = ss->type == SERIAL_STREAM_DATA && ss->started &&
+		       ss->arg == ss->pos && ss->len <= ss->size - ss->pos;
+	dst = ss->in_place ? ss->buf + ss->pos : serial_stream_scratch;
+
+	for (i = 0; i < ss->len; i++) {
+		c = ss_getc(SS_CHAR_TIMEOUT);
+		if (c < 0)
+			return -EBADMSG;
+		dst[i] = c;
+	}
+
+	for (i = 0; i < sizeof(crcb); i++) {
+		c = ss_getc(SS_CHAR_TIMEOUT);
+		if (c < 0)
+			return -EBADMSG;
+		crcb[i] = c;
+	}
+
+	crc = crc32(0, hdr, SS_HDR_SIZE);
+	crc = crc32(crc, dst, ss->len);
+	if (crc != get_unaligned_be32(crcb))
+		return -EBADMSG;
+
+	return 0;
+}
+
+static void ss_reply(u8 type, u32 arg)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	char line[1 + 24 + 2];
+	u8 frame[12];
+	int i;
+
+	frame[0] = type;
+	frame[1] = 0;
+	put_unaligned_be32(arg, frame + 2);
+	put_unaligned_be16(0, frame + 6);
+	put_unaligned_be32(crc32(0, frame, SS_HDR_SIZE), frame + 8);
+
+	line[0] = SERIAL_STREAM_REPLY;
+	for (i = 0; i < sizeof(frame); i++) {
+		line[1 + 2 * i] = hex[frame[i] >> 4];
+		line[2 + 2 * i] = hex[frame[i] & 0xf];
+	}
+	line[25] = '\n';
+	line[26] = 0;
+
+	puts(line);
+}
+
+/* Ask for the data from the current position again, but not too often */
+static void ss_nak(struct serial_stream *ss, bool force)
+{
+	if (!ss->started)
+		return;
+
+	if (!force && get_timer(ss->nak_time) < SS_NAK_INTERVAL)
+		return;
+
+	ss_reply(SERIAL_STREAM_NAK, ss->pos);
+	ss->nak_time = get_timer(0);
+}
+
+/* Same as the loadb command, let the reply go out before switching */
+static void ss_set_baud(int baud)
+{
+	/* Send out the reply at the old rate first */
+	serial_flush();
+	udelay(50000);
+	gd->baudrate = baud;
+	serial_setbrg();
+	udelay(50000);
+}
+
+/* Highest rate up to @limit the UART gets close enough to */
+static int ss_pick_baud(u32 limit, int console_baud)
+{
+	int i, baud;
+
+	for (i = 0; i < ARRAY_SIZE(serial_stream_bauds); i++) {
+		baud = serial_stream_bauds[i];
+
+		if (baud <= console_baud)
+			break;
+
+		if (baud > limit || baud > CONFIG_SERIAL_STREAM_MAX_BAUD)
+			continue;
+
+		if (serial_baud_error(baud) <= SS_MAX_BAUD_ERR)
+			return baud;
+	}
+
+	return console_baud;
+}
+
+static int ss_end(struct serial_stream *ss)
+{
+	if (ss->arg != ss->size || ss->pos != ss->size) {
+		ss_nak(ss, true);
+		return -EAGAIN;
+	}
+
+	if (ss->len != sizeof(u32) ||
+	    get_unaligned_be32(serial_stream_scratch) !=
+	    crc32(0, ss->buf, ss->size)) {
+		/* All frames were fine, but the file is not: start over */
+		ss->pos = 0;
+		ss_nak(ss, true);
+		return -EAGAIN;
+	}
+
+	ss_reply(SERIAL_STREAM_ACK, ss->size);
+
+	return 0;
+}
+
+int serial_stream_receive(void *buf, size_t max, size_t *size, ulong wait_ms)
+{
+	struct serial_stream ss;
+	int console_baud = gd->baudrate;
+	ulong start = get_timer(0), timeout, elapsed;
+	bool switching = false;
+	int ret, baud;
+
+	memset(&ss, 0, sizeof(ss));
+	ss.buf = buf;
+	ss.max = max;
+
+	for (;;) {
+		if (switching) {
+			timeout = SS_SWITCH_TIMEOUT;
+		} else if (ss.started || !wait_ms) {
+			timeout = SS_IDLE_TIMEOUT;
+		} else {
+			elapsed = get_timer(start);
+			if (elapsed >= wait_ms) {
+				ret = -ETIMEDOUT;
+				break;
+			}
+			timeout = wait_ms - elapsed;
+		}
+
+		ret = ss_recv_frame(&ss, timeout, !ss.started && !switching);
+		if (ret == -ETIMEDOUT) {
+			if (switching) {
+				/* The host did not make it, back to square one */
+				ss_set_baud(console_baud);
+				switching = false;
+				continue;
+			}
+
+			if (ss.started)
+				break;
+
+			continue;
+		} else if (ret == -ECANCELED) {
+			break;
+		} else if (ret) {
+			ss_nak(&ss, false);
+			continue;
+		}
+
+		switch (ss.type) {
+		case SERIAL_STREAM_HELLO:
+			ss.started = false;
+			baud = ss_pick_baud(ss.arg, console_baud);
+			ss_reply(SERIAL_STREAM_ACK, baud);
+			if (baud != gd->baudrate) {
+				ss_set_baud(baud);
+				switching = true;
+			}
+			break;
+		case SERIAL_STREAM_SYNC:
+			switching = false;
+			ss_reply(SERIAL_STREAM_ACK, gd->baudrate);
+			break;
+		case SERIAL_STREAM_START:
+			if (ss.arg > ss.max) {
+				ss_reply(SERIAL_STREAM_ERR, ss.max);
+				ret = -ENOSPC;
+				goto out;
+			}
+			ss.size = ss.arg;
+			ss.pos = 0;
+			ss.started = true;
+			ss_reply(SERIAL_STREAM_ACK, 0);
+			break;
+		case SERIAL_STREAM_DATA:
+			if (ss.in_place)
+				ss.pos += ss.len;
+			else if (ss.arg > ss.pos)
+				ss_nak(&ss, false);
+			break;
+		case SERIAL_STREAM_END:
+			if (ss.started && !ss_end(&ss)) {
+				*size = ss.size;
+				goto out;
+			}
+			break;
+		case SERIAL_STREAM_ABORT:
+			ret = -ECANCELED;
+			goto out;
+		}
+	}
+
+out:
+	if (gd->baudrate != console_baud)
+		ss_set_baud(console_baud);
+
+	return ret;
+}
@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Loading a file from whichever USB storage device carries it
+ *
+ * All USB storage devices are searched, partition by partition, for a file
+ * on any filesystem the fs layer supports. The file is read straight to its
+ * destination, so the filesystem hands contiguous runs of clusters/blocks
+ * to the USB storage driver, which issues them as large bulk transfers.
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <fs.h>
+#include <part.h>
+#include <usb.h>
+#include <linux/math64.h>
+
+extern char usb_started;
+
+/* Look for @name on one partition, 0 for the whole device */
+static int usb_load_part(struct blk_desc *desc, int part, const char *name,
+			 ulong addr, loff_t max, loff_t *size)
+{
+	loff_t len, actread;
+	ulong time;
+
+	if (fs_set_blk_dev_with_part(desc, part))
+		return -ENOENT;
+
+	if (fs_size(name, &len))
+		return -ENOENT;
+
+	if (len > max) {
+		printf("%s on usb %d:%d is too large (%lld bytes, %lld max)\n",
+		       name, desc->devnum, part, len, max);
+		return -EFBIG;
+	}
+
+	printf("Loading %s from usb %d:%d\n", name, desc->devnum, part);
+
+	/* The filesystem is closed after each operation */
+	if (fs_set_blk_dev_with_part(desc, part))
+		return -EIO;
+
+	time = get_timer(0);
+	if (fs_read(name, addr, 0, len, &actread) || actread != len) {
+		printf("Failed to read %s\n", name);
+		return -EIO;
+	}
+	time = get_timer(time);
+
+	printf("%lld bytes read in %lu ms", len, time);
+	if (time > 0) {
+		puts(" (");
+		print_size(div_u64(len, time) * 1000, "/s");
+		puts(")");
+	}
+	puts("\n");
+
+	*size = len;
+
+	return 0;
+}
+
+int usb_stor_load_file(const char *name, ulong addr, loff_t max, loff_t *size)
+{
+	struct blk_desc *desc;
+	disk_partition_t info;
+	bool parted;
+	int devnum, part, ret;
+
+	if (!usb_started) {
+		if (usb_init() < 0)
+			return -ENODEV;
+
+		if (usb_stor_scan(1))
+			return -ENODEV;
+	}
+
+	for (devnum = 0; (desc = blk_get_dev("usb", devnum)); devnum++) {
+		if (desc->type == DEV_TYPE_UNKNOWN)
+			continue;
+
+		parted = false;
+
+		for (part = 1; part <= MAX_SEARCH_PARTITIONS; part++) {
+			if (part_get_info(desc, part, &info))
+				continue;
+
+			parted = true;
+
+			ret = usb_load_part(desc, part, name, addr, max, size);
+			if (ret != -ENOENT)
+				return ret;
+		}
+
+		/* A filesystem on the whole device */
+		if (!parted) {
+			ret = usb_load_part(desc, 0, name, addr, max, size);
+			if (ret != -ENOENT)
+				return ret;
+		}
+	}
+
+	printf("%s not found on any USB storage device\n", name);
+
+	return -ENOENT;
+}
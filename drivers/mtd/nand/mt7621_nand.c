@@ -687,6 +687,37 @@ static int nfc_check_empty_page(struct mtd_info *mtd, struct nand_chip *chip,
 	return 1;
 }
 
+static u32 nfc_bbt_get(mt7621_nfc_sel_t *nfc_sel, u32 block)
+{
+	u32 shift = (block % NFC_BBT_BLOCKS_PER_WORD) * NFC_BBT_BITS;
+
+	if (!nfc_sel->bbt || block >= nfc_sel->bbt_blocks)
+		return NFC_BBT_UNKNOWN;
+
+	return (nfc_sel->bbt[block / NFC_BBT_BLOCKS_PER_WORD] >> shift) &
+	       NFC_BBT_MASK;
+}
+
+static void nfc_bbt_set(mt7621_nfc_sel_t *nfc_sel, u32 block, u32 state)
+{
+	u32 shift = (block % NFC_BBT_BLOCKS_PER_WORD) * NFC_BBT_BITS;
+	u32 *word;
+
+	if (!nfc_sel->bbt || block >= nfc_sel->bbt_blocks)
+		return;
+
+	word = &nfc_sel->bbt[block / NFC_BBT_BLOCKS_PER_WORD];
+	*word = (*word & ~(NFC_BBT_MASK << shift)) | (state << shift);
+}
+
+/* Any program or erase may change the bad block mark of the block */
+static void nfc_bbt_forget_page(struct nand_chip *chip, int page)
+{
+	nfc_bbt_set(nand_to_mt7621_chip(chip),
+		    page >> (chip->phys_erase_shift - chip->page_shift),
+		    NFC_BBT_UNKNOWN);
+}
+
 static int nfc_write_page_hwecc(struct mtd_info *mtd, struct nand_chip *chip,
 	const u8 *buf, int oob_on, int page)
 {
@@ -707,6 +738,8 @@ static int nfc_write_page_hwecc(struct mtd_info *mtd, struct nand_chip *chip,
 		return nfc_write_page_raw(mtd, chip, NULL, oob_on, page);
 	}
 
+	nfc_bbt_forget_page(chip, page);
+
 	nfi_clrsetbits16(nfc, NFI_CNFG_REG16, READ_MODE,
 			 AUTO_FMT_EN | HW_ECC_EN);
 
@@ -736,6 +769,8 @@ static int nfc_write_page_raw(struct mtd_info *mtd, struct nand_chip *chip,
 	mt7621_nfc_sel_t *nfc_sel = nand_to_mt7621_chip(chip);
 	int i, ret;
 
+	nfc_bbt_forget_page(chip, page);
+
 	memset(nfc_sel->page_cache, 0xff, mtd->writesize + mtd->oobsize);
 
 	for (i = 0; i < chip->ecc.steps; i++)
@@ -768,6 +803,9 @@ static int nfc_write_oob_std(struct mtd_info *mtd, struct nand_chip *chip,
 	mt7621_nfc_sel_t *nfc_sel = nand_to_mt7621_chip(chip);
 	int ret;
 
+	/* This may write a bad block marker */
+	nfc_bbt_forget_page(chip, page);
+
 	memset(nfc_sel->page_cache, 0xff, mtd->writesize + mtd->oobsize);
 
 	chip->cmdfunc(mtd, NAND_CMD_SEQIN, 0x00, page);
@@ -787,6 +825,9 @@ static int nfc_write_oob_raw(struct mtd_info *mtd, struct nand_chip *chip,
 {
 	int ret;
 
+	/* This may write a bad block marker */
+	nfc_bbt_forget_page(chip, page);
+
 	chip->cmdfunc(mtd, NAND_CMD_SEQIN, 0x00, page);
 
 	ret = nfc_write_page_raw(mtd, chip, NULL, 1, page);
@@ -799,7 +840,7 @@ static int nfc_write_oob_raw(struct mtd_info *mtd, struct nand_chip *chip,
 	return ret & NAND_STATUS_FAIL ? -EIO : 0;
 }
 
-static int nfc_block_bad(struct mtd_info *mtd, loff_t ofs)
+static int nfc_read_bad_mark(struct mtd_info *mtd, loff_t ofs)
 {
 	struct nand_chip *chip = mtd_to_nand(mtd);
 	int page, res = 0, i = 0;
@@ -825,10 +866,30 @@ static int nfc_block_bad(struct mtd_info *mtd, loff_t ofs)
 	return res;
 }
 
+static int nfc_block_bad(struct mtd_info *mtd, loff_t ofs)
+{
+	struct nand_chip *chip = mtd_to_nand(mtd);
+	mt7621_nfc_sel_t *nfc_sel = nand_to_mt7621_chip(chip);
+	u32 block = ofs >> chip->phys_erase_shift;
+	u32 state;
+	int res;
+
+	state = nfc_bbt_get(nfc_sel, block);
+	if (state != NFC_BBT_UNKNOWN)
+		return state == NFC_BBT_BAD;
+
+	res = nfc_read_bad_mark(mtd, ofs & ~((loff_t)mtd->erasesize - 1));
+
+	nfc_bbt_set(nfc_sel, block, res ? NFC_BBT_BAD : NFC_BBT_GOOD);
+
+	return res;
+}
+
 static int nfc_block_markbad(struct mtd_info *mtd, loff_t ofs)
 {
 	struct nand_chip *chip = mtd_to_nand(mtd);
 	mt7621_nfc_sel_t *nfc_sel = nand_to_mt7621_chip(chip);
+	u32 block = ofs >> chip->phys_erase_shift;
 	loff_t lofs;
 	int page, ret = 0, res, i = 0;
 
@@ -874,9 +935,24 @@ static int nfc_block_markbad(struct mtd_info *mtd, loff_t ofs)
 	/* Restore original OOB data */
 	memcpy(chip->oob_poi, nfc_sel->oob_mb_cache, mtd->oobsize);
 
+	if (!ret)
+		nfc_bbt_set(nfc_sel, block, NFC_BBT_BAD);
+
 	return ret;
 }
 
+static int nfc_erase(struct mtd_info *mtd, int page)
+{
+	struct nand_chip *chip = mtd_to_nand(mtd);
+
+	nfc_bbt_forget_page(chip, page);
+
+	chip->cmdfunc(mtd, NAND_CMD_ERASE1, -1, page);
+	chip->cmdfunc(mtd, NAND_CMD_ERASE2, -1, -1);
+
+	return chip->waitfunc(mtd, chip);
+}
+
 static void nfc_set_nand_ecc_layout(mt7621_nfc_sel_t *nfc_sel)
 {
 	struct nand_chip *chip = &nfc_sel->nand;
@@ -1019,6 +1095,62 @@ static void nfc_set_def_timing(mt7621_nfc_sel_t *nfc_sel, u8 *id)
 	nfc_sel->acccon_val = NFI_DEFAULT_ACCESS_TIMING;
 }
 
+#ifdef CONFIG_NAND_MT7621_BBT_HANDOFF
+#define NFC_BBT_HANDOFF \
+	((mt7621_nfc_bbt_handoff_t *)CONFIG_NAND_MT7621_BBT_HANDOFF_ADDR)
+#else
+#define NFC_BBT_HANDOFF		NULL
+#endif
+
+/*
+ * The table starts out empty and is filled in by nfc_block_bad(). With the
+ * SPL handoff, SPL keeps its table in the (uncached) handoff area and
+ * U-Boot takes over the marks SPL has read already.
+ */
+static void nfc_bbt_init(mt7621_nfc_sel_t *nfc_sel)
+{
+	struct nand_chip *chip = &nfc_sel->nand;
+	mt7621_nfc_bbt_handoff_t *ho = NFC_BBT_HANDOFF;
+	u32 blocks = chip->mtd.size >> chip->phys_erase_shift;
+	size_t size = DIV_ROUND_UP(blocks, NFC_BBT_BLOCKS_PER_WORD) *
+		      sizeof(u32);
+
+	if (!IS_ENABLED(CONFIG_NAND_MT7621_BBT_CACHE))
+		return;
+
+	if (IS_ENABLED(CONFIG_SPL_BUILD)) {
+		if (!ho || nfc_sel->cs ||
+		    sizeof(*ho) + size > NFC_BBT_HANDOFF_SIZE)
+			return;
+
+		ho->magic = 0;
+		ho->erase_shift = chip->phys_erase_shift;
+		ho->blocks = blocks;
+		memset(ho->bbt, 0, size);
+		ho->magic = NFC_BBT_HANDOFF_MAGIC;
+
+		nfc_sel->bbt = ho->bbt;
+		nfc_sel->bbt_blocks = blocks;
+		return;
+	}
+
+	nfc_sel->bbt = calloc(1, size);
+	if (!nfc_sel->bbt)
+		return;
+
+	nfc_sel->bbt_blocks = blocks;
+
+	if (!ho || nfc_sel->cs)
+		return;
+
+	if (ho->magic == NFC_BBT_HANDOFF_MAGIC &&
+	    ho->erase_shift == chip->phys_erase_shift &&
+	    ho->blocks == blocks)
+		memcpy(nfc_sel->bbt, ho->bbt, size);
+
+	ho->magic = 0;
+}
+
 static void nfc_probe(mt7621_nfc_t *nfc, int cs)
 {
 	mt7621_nfc_sel_t *nfc_sel = &nfc->sels[cs];
@@ -1066,6 +1198,8 @@ static void nfc_probe(mt7621_nfc_t *nfc, int cs)
 	if (ret)
 		return;
 
+	chip->erase = nfc_erase;
+
 	nfc_init_chip_config(nfc_sel);
 
 	nfc_set_nand_ecc_layout(nfc_sel);
@@ -1086,6 +1220,8 @@ static void nfc_probe(mt7621_nfc_t *nfc, int cs)
 	if (!nfc_sel->oob_mb_cache)
 		return;
 
+	nfc_bbt_init(nfc_sel);
+
 	/* Read ID to retrive preset ACCON settings */
 	chip->cmdfunc(&chip->mtd, NAND_CMD_READID, 0x00, -1);
 	chip->read_buf(&chip->mtd, id, 8);
@@ -1154,6 +1290,8 @@ int mt7621_nfc_spl_post_init(mt7621_nfc_t *nfc, int cs)
 
 	nfc_set_def_timing(nfc_sel, id);
 
+	nfc_bbt_init(nfc_sel);
+
 	return 0;
 }
 
@@ -798,6 +798,10 @@ typedef struct mt7621_nfc_sel {
 
 	void *page_cache;
 	void *oob_mb_cache;
+
+	/* Cached bad block marks, NFC_BBT_BITS per block */
+	u32 *bbt;
+	u32 bbt_blocks;
 } mt7621_nfc_sel_t;
 
 typedef struct mt7621_nfc {
@@ -822,6 +826,27 @@ typedef struct mt7621_nfc_timing {
 
 #define NFI_STATUS_WAIT_TIMEOUT_US			1000000
 
+/* In-RAM bad block table */
+#define NFC_BBT_BITS					2
+#define NFC_BBT_MASK					0x3
+#define NFC_BBT_BLOCKS_PER_WORD				(32 / NFC_BBT_BITS)
+
+#define NFC_BBT_UNKNOWN					0
+#define NFC_BBT_GOOD					1
+#define NFC_BBT_BAD					2
+
+/* Bad block table passed from SPL to U-Boot */
+#define NFC_BBT_HANDOFF_MAGIC				0x42425443 /* BBTC */
+#define NFC_BBT_HANDOFF_SIZE				0x1000
+
+typedef struct mt7621_nfc_bbt_handoff {
+	u32 magic;
+	u32 erase_shift;
+	u32 blocks;
+	u32 reserved;
+	u32 bbt[];
+} mt7621_nfc_bbt_handoff_t;
+
 /* for SPL */
 void mt7621_nfc_spl_init(mt7621_nfc_t *nfc, int cs);
 int mt7621_nfc_spl_post_init(mt7621_nfc_t *nfc, int cs);
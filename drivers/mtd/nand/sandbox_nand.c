@@ -0,0 +1,472 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Simulate a raw NAND flash chip on sandbox
+ *
+ * The geometry comes from the "sandbox,nand" node of the device tree:
+ *
+ *	nand {
+ *		compatible = "sandbox,nand";
+ *		sandbox,page-size = <2048>;
+ *		sandbox,oob-size = <64>;
+ *		sandbox,block-size = <0x20000>;
+ *		sandbox,chip-size-mib = <32>;
+ *		sandbox,bad-blocks = <10 200>;	(optional)
+ *		sandbox,filepath = "nand.bin";
+ *	};
+ *
+ * The chip only exists if its backing file does, so that sandbox doesn't
+ * carry a NAND (and NMBM on top of it) unless a test asks for one by
+ * creating the file. The contents (pages followed by their OOB) are kept in
+ * memory, and also written through to the backing file, so that they
+ * survive a restart. An empty backing file is a blank chip, and gets the
+ * factory bad blocks marked.
+ *
+ * The "sbnand" command counts the flash operations, and injects bad
+ * blocks, failing blocks and bitflips for testing the upper layers.
+ */
+
+#include <common.h>
+#include <command.h>
+#include <malloc.h>
+#include <nand.h>
+#include <os.h>
+#include <dm/ofnode.h>
+#include <linux/mtd/rawnand.h>
+
+#define SB_NAND_MAX_FLIPS	16
+
+static const u8 sb_nand_id[] = { 0x53, 0x42, 0x4e, 0x44 };
+
+struct sb_nand_flip {
+	int page;
+	int bits;
+};
+
+struct sb_nand_stats {
+	u32 reads;
+	u32 programs;
+	u32 erases;
+	u32 prog_fails;
+	u32 erase_fails;
+	u32 flipped;
+};
+
+struct sb_nand {
+	struct nand_chip chip;
+	struct nand_flash_dev ids[2];
+
+	u8 *mem;
+	u8 *pagebuf;
+	u32 pagesize;		/* page + OOB */
+	u32 pages_per_block;
+	u32 blocks;
+	int fd;
+
+	/* Current command */
+	u8 cmd;
+	u32 column;
+	int page;
+	u8 status;
+
+	u8 *fail_blocks;
+	struct sb_nand_flip flips[SB_NAND_MAX_FLIPS];
+	struct sb_nand_stats stats;
+};
+
+static struct sb_nand *sb_nand;
+
+static u8 *sb_nand_page(struct sb_nand *sn, int page)
+{
+	return sn->mem + (size_t)page * sn->pagesize;
+}
+
+static void sb_nand_sync(struct sb_nand *sn, int page, int count)
+{
+	if (sn->fd < 0)
+		return;
+
+	os_lseek(sn->fd, (off_t)page * sn->pagesize, OS_SEEK_SET);
+	os_write(sn->fd, sb_nand_page(sn, page), (size_t)count * sn->pagesize);
+}
+
+static void sb_nand_load_page(struct sb_nand *sn, int page)
+{
+	int i, bit;
+
+	memcpy(sn->pagebuf, sb_nand_page(sn, page), sn->pagesize);
+	sn->stats.reads++;
+
+	/* Flip one bit in each of the first bytes */
+	for (i = 0; i < SB_NAND_MAX_FLIPS; i++) {
+		if (!sn->flips[i].bits || sn->flips[i].page != page)
+			continue;
+
+		for (bit = 0; bit < sn->flips[i].bits; bit++)
+			sn->pagebuf[bit] ^= 0x01;
+
+		sn->stats.flipped++;
+	}
+}
+
+static void sb_nand_program(struct sb_nand *sn)
+{
+	u8 *dst = sb_nand_page(sn, sn->page);
+	int i;
+
+	if (sn->fail_blocks[sn->page / sn->pages_per_block]) {
+		sn->status |= NAND_STATUS_FAIL;
+		sn->stats.prog_fails++;
+		return;
+	}
+
+	/* Programming can only clear bits */
+	for (i = 0; i < sn->pagesize; i++)
+		dst[i] &= sn->pagebuf[i];
+
+	sn->stats.programs++;
+	sb_nand_sync(sn, sn->page, 1);
+}
+
+static void sb_nand_erase(struct sb_nand *sn)
+{
+	int block = sn->page / sn->pages_per_block;
+	int first = block * sn->pages_per_block;
+	int i;
+
+	if (sn->fail_blocks[block]) {
+		sn->status |= NAND_STATUS_FAIL;
+		sn->stats.erase_fails++;
+		return;
+	}
+
+	memset(sb_nand_page(sn, first), 0xff,
+	       (size_t)sn->pages_per_block * sn->pagesize);
+
+	/* Bitflips caused by read disturb are gone */
+	for (i = 0; i < SB_NAND_MAX_FLIPS; i++) {
+		if (sn->flips[i].page >= first &&
+		    sn->flips[i].page < first + sn->pages_per_block)
+			sn->flips[i].bits = 0;
+	}
+
+	sn->stats.erases++;
+	sb_nand_sync(sn, first, sn->pages_per_block);
+}
+
+static void sb_nand_cmdfunc(struct mtd_info *mtd, unsigned int command,
+			    int column, int page_addr)
+{
+	struct sb_nand *sn = nand_get_controller_data(mtd_to_nand(mtd));
+
+	switch (command) {
+	case NAND_CMD_RESET:
+		sn->status = NAND_STATUS_READY | NAND_STATUS_WP;
+		break;
+	case NAND_CMD_READID:
+		sn->column = column;
+		break;
+	case NAND_CMD_READOOB:
+		column += mtd->writesize;
+		/* fall through */
+	case NAND_CMD_READ0:
+		sb_nand_load_page(sn, page_addr);
+		sn->page = page_addr;
+		/* fall through */
+	case NAND_CMD_RNDOUT:
+	case NAND_CMD_RNDIN:
+		sn->column = column;
+		break;
+	case NAND_CMD_SEQIN:
+		memset(sn->pagebuf, 0xff, sn->pagesize);
+		sn->page = page_addr;
+		sn->column = column;
+		break;
+	case NAND_CMD_PAGEPROG:
+		sn->status = NAND_STATUS_READY | NAND_STATUS_WP;
+		sb_nand_program(sn);
+		break;
+	case NAND_CMD_ERASE1:
+		sn->page = page_addr;
+		break;
+	case NAND_CMD_ERASE2:
+		sn->status = NAND_STATUS_READY | NAND_STATUS_WP;
+		sb_nand_erase(sn);
+		break;
+	case NAND_CMD_STATUS:
+		break;
+	default:
+		/* Not supported, as if the chip ignores it */
+		debug("%s: command %02x ignored\n", __func__, command);
+		return;
+	}
+
+	sn->cmd = command;
+}
+
+static uint8_t sb_nand_read_byte(struct mtd_info *mtd)
+{
+	struct sb_nand *sn = nand_get_controller_data(mtd_to_nand(mtd));
+	u8 val = 0;
+
+	switch (sn->cmd) {
+	case NAND_CMD_READID:
+		if (sn->column < sizeof(sb_nand_id))
+			val = sb_nand_id[sn->column];
+		sn->column++;
+		break;
+	case NAND_CMD_STATUS:
+	case NAND_CMD_PAGEPROG:
+	case NAND_CMD_ERASE2:
+	case NAND_CMD_RESET:
+		val = sn->status;
+		break;
+	default:
+		if (sn->column < sn->pagesize)
+			val = sn->pagebuf[sn->column++];
+		break;
+	}
+
+	return val;
+}
+
+static void sb_nand_read_buf(struct mtd_info *mtd, uint8_t *buf, int len)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = sb_nand_read_byte(mtd);
+}
+
+static void sb_nand_write_buf(struct mtd_info *mtd, const uint8_t *buf,
+			      int len)
+{
+	struct sb_nand *sn = nand_get_controller_data(mtd_to_nand(mtd));
+
+	if (sn->column + len > sn->pagesize)
+		len = sn->pagesize - sn->column;
+
+	memcpy(sn->pagebuf + sn->column, buf, len);
+	sn->column += len;
+}
+
+static void sb_nand_select_chip(struct mtd_info *mtd, int chipnr)
+{
+}
+
+static int sb_nand_dev_ready(struct mtd_info *mtd)
+{
+	return 1;
+}
+
+static int sb_nand_setup(struct sb_nand *sn, ofnode node)
+{
+	u32 page_size, oob_size, block_size, size_mib, chip_pages;
+	const char *filepath;
+	u32 bad[64];
+	bool fresh;
+	size_t size;
+	int i, n;
+
+	filepath = ofnode_read_string(node, "sandbox,filepath");
+	if (!filepath)
+		return -ENODEV;
+
+	sn->fd = os_open(filepath, OS_O_RDWR);
+	if (sn->fd < 0)
+		return -ENODEV;
+
+	page_size = ofnode_read_u32_default(node, "sandbox,page-size", 2048);
+	oob_size = ofnode_read_u32_default(node, "sandbox,oob-size", 64);
+	block_size = ofnode_read_u32_default(node, "sandbox,block-size",
+					     0x20000);
+	size_mib = ofnode_read_u32_default(node, "sandbox,chip-size-mib", 32);
+
+	if (!page_size || block_size % page_size || !size_mib)
+		return -EINVAL;
+
+	sn->pagesize = page_size + oob_size;
+	sn->pages_per_block = block_size / page_size;
+	sn->blocks = ((u64)size_mib << 20) / block_size;
+	chip_pages = sn->blocks * sn->pages_per_block;
+	size = (size_t)chip_pages * sn->pagesize;
+
+	sn->ids[0].name = "Sandbox NAND";
+	memcpy(sn->ids[0].id, sb_nand_id, sizeof(sb_nand_id));
+	sn->ids[0].id_len = sizeof(sb_nand_id);
+	sn->ids[0].pagesize = page_size;
+	sn->ids[0].oobsize = oob_size;
+	sn->ids[0].erasesize = block_size;
+	sn->ids[0].chipsize = size_mib;
+
+	/* Out of the U-Boot heap, as it's usually larger */
+	sn->mem = os_malloc(size);
+	sn->pagebuf = malloc(sn->pagesize);
+	sn->fail_blocks = calloc(sn->blocks, 1);
+	if (!sn->mem || !sn->pagebuf || !sn->fail_blocks)
+		return -ENOMEM;
+
+	fresh = os_read(sn->fd, sn->mem, size) != size;
+	if (fresh)
+		memset(sn->mem, 0xff, size);
+
+	n = ofnode_read_size(node, "sandbox,bad-blocks") / sizeof(u32);
+	if (fresh && n > 0) {
+		if (n > ARRAY_SIZE(bad))
+			n = ARRAY_SIZE(bad);
+
+		ofnode_read_u32_array(node, "sandbox,bad-blocks", bad, n);
+		for (i = 0; i < n; i++) {
+			if (bad[i] >= sn->blocks)
+				continue;
+
+			/* Factory bad block mark in the first page */
+			sb_nand_page(sn, bad[i] * sn->pages_per_block)
+				[page_size] = 0;
+		}
+	}
+
+	if (fresh)
+		sb_nand_sync(sn, 0, chip_pages);
+
+	return 0;
+}
+
+void board_nand_init(void)
+{
+	struct nand_chip *chip;
+	struct mtd_info *mtd;
+	struct sb_nand *sn;
+	ofnode node;
+	int ret;
+
+	node = ofnode_by_compatible(ofnode_null(), "sandbox,nand");
+	if (!ofnode_valid(node) || !ofnode_is_available(node))
+		return;
+
+	sn = calloc(1, sizeof(*sn));
+	if (!sn)
+		return;
+
+	ret = sb_nand_setup(sn, node);
+	if (ret == -ENODEV) {
+		free(sn);
+		return;
+	}
+
+	if (ret) {
+		printf("Failed to set up sandbox NAND\n");
+		return;
+	}
+
+	chip = &sn->chip;
+	mtd = nand_to_mtd(chip);
+	nand_set_controller_data(chip, sn);
+
+	chip->cmdfunc = sb_nand_cmdfunc;
+	chip->read_byte = sb_nand_read_byte;
+	chip->read_buf = sb_nand_read_buf;
+	chip->write_buf = sb_nand_write_buf;
+	chip->select_chip = sb_nand_select_chip;
+	chip->dev_ready = sb_nand_dev_ready;
+	chip->chip_delay = 1;
+	chip->options = NAND_NO_SUBPAGE_WRITE;
+	chip->ecc.mode = NAND_ECC_SOFT;
+
+	if (nand_scan_ident(mtd, 1, sn->ids))
+		return;
+
+	if (nand_scan_tail(mtd))
+		return;
+
+	if (nand_register(0, mtd))
+		return;
+
+	sb_nand = sn;
+}
+
+static int do_sbnand(cmd_tbl_t *cmdtp, int flag, int argc,
+		     char *const argv[])
+{
+	struct sb_nand_stats *st;
+	ulong num;
+	int i;
+
+	if (!sb_nand) {
+		printf("No sandbox NAND\n");
+		return CMD_RET_FAILURE;
+	}
+
+	st = &sb_nand->stats;
+
+	if (argc < 2)
+		return CMD_RET_USAGE;
+
+	if (!strcmp(argv[1], "stats")) {
+		printf("reads=%u programs=%u erases=%u prog_fails=%u "
+		       "erase_fails=%u flipped=%u\n", st->reads, st->programs,
+		       st->erases, st->prog_fails, st->erase_fails,
+		       st->flipped);
+
+		if (argc > 2 && !strcmp(argv[2], "reset"))
+			memset(st, 0, sizeof(*st));
+
+		return CMD_RET_SUCCESS;
+	}
+
+	if (!strcmp(argv[1], "clear")) {
+		memset(sb_nand->fail_blocks, 0, sb_nand->blocks);
+		memset(sb_nand->flips, 0, sizeof(sb_nand->flips));
+		return CMD_RET_SUCCESS;
+	}
+
+	if (argc < 3)
+		return CMD_RET_USAGE;
+
+	num = simple_strtoul(argv[2], NULL, 0);
+
+	if (!strcmp(argv[1], "bad") || !strcmp(argv[1], "fail")) {
+		if (num >= sb_nand->blocks)
+			return CMD_RET_FAILURE;
+
+		if (argv[1][0] == 'f') {
+			sb_nand->fail_blocks[num] = 1;
+			return CMD_RET_SUCCESS;
+		}
+
+		sb_nand_page(sb_nand, num * sb_nand->pages_per_block)
+			[nand_to_mtd(&sb_nand->chip)->writesize] = 0;
+		sb_nand_sync(sb_nand, num * sb_nand->pages_per_block, 1);
+
+		return CMD_RET_SUCCESS;
+	}
+
+	if (!strcmp(argv[1], "bitflip") && argc > 3) {
+		if (num >= sb_nand->blocks * sb_nand->pages_per_block)
+			return CMD_RET_FAILURE;
+
+		for (i = 0; i < SB_NAND_MAX_FLIPS; i++) {
+			if (!sb_nand->flips[i].bits) {
+				sb_nand->flips[i].page = num;
+				sb_nand->flips[i].bits =
+					simple_strtoul(argv[3], NULL, 0);
+				return CMD_RET_SUCCESS;
+			}
+		}
+
+		printf("Too many bitflips\n");
+		return CMD_RET_FAILURE;
+	}
+
+	return CMD_RET_USAGE;
+}
+
+U_BOOT_CMD(
+	sbnand,	4,	0,	do_sbnand,
+	"sandbox NAND fault injection and statistics",
+	"stats [reset] - show (and reset) operation counters\n"
+	"sbnand bad <block> - mark a block bad, as if from the factory\n"
+	"sbnand fail <block> - make erasing and programming a block fail\n"
+	"sbnand bitflip <page> <bits> - flip bits of a page on each read,\n"
+	"    until its block is erased\n"
+	"sbnand clear - drop all failing blocks and bitflips"
+);
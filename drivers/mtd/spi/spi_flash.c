@@ -474,17 +474,26 @@ int spi_flash_cmd_read_ops(struct spi_flash *flash, u32 offset,
 	int ret = -1;
 
 	/* Handle memory-mapped SPI */
-	if (flash->memory_map) {
+	if (flash->memory_map && offset < flash->memory_map_size) {
+		read_len = min_t(size_t, len, flash->memory_map_size - offset);
+
 		ret = spi_claim_bus(spi);
 		if (ret) {
 			debug("SF: unable to claim SPI bus\n");
 			return ret;
 		}
 		spi_xfer(spi, 0, NULL, NULL, SPI_XFER_MMAP);
-		spi_flash_copy_mmap(data, flash->memory_map + offset, len);
+		spi_flash_copy_mmap(data, flash->memory_map + offset,
+				    read_len);
 		spi_xfer(spi, 0, NULL, NULL, SPI_XFER_MMAP_END);
 		spi_release_bus(spi);
-		return 0;
+
+		/* The rest lies beyond a window smaller than the flash */
+		offset += read_len;
+		len -= read_len;
+		data += read_len;
+		if (!len)
+			return 0;
 	}
 
 	cmdsz = SPI_FLASH_CMD_LEN + flash->dummy_byte;
@@ -1119,11 +1128,15 @@ int spi_flash_decode_fdt(struct spi_flash *flash)
 		return 0;
 	}
 
-	if (flash->size > size) {
-		debug("%s: Memory map must cover entire device\n", __func__);
-		return -1;
-	}
+	/* Reads beyond a smaller window go through the command interface */
+	if (flash->size < size)
+		size = flash->size;
+	else if (flash->size > size)
+		debug("%s: Memory map covers only 0x%llx bytes\n", __func__,
+		      (unsigned long long)size);
+
 	flash->memory_map = map_sysmem(addr, size);
+	flash->memory_map_size = size;
 #endif
 
 	return 0;
@@ -1222,6 +1235,10 @@ int spi_flash_scan(struct spi_flash *flash)
 		flash->size <<= 1;
 #endif
 
+	/* A window provided by the controller maps the whole flash */
+	if (flash->memory_map)
+		flash->memory_map_size = flash->size;
+
 #ifdef CONFIG_SPI_FLASH_USE_4K_SECTORS
 	/* Compute erase sector and command */
 	if (info->flags & SECT_4K) {
@@ -287,6 +287,22 @@ void serial_setbrg(void)
 		ops->setbrg(gd->cur_serial_dev, gd->baudrate);
 }
 
+/* Wait until the console has sent everything out */
+void serial_flush(void)
+{
+	struct dm_serial_ops *ops;
+
+	if (!gd->cur_serial_dev)
+		return;
+
+	ops = serial_get_ops(gd->cur_serial_dev);
+	if (!ops->pending)
+		return;
+
+	while (ops->pending(gd->cur_serial_dev, false) > 0)
+		;
+}
+
 void serial_stdio_init(void)
 {
 }
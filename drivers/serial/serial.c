@@ -367,6 +367,16 @@ void serial_setbrg(void)
 	get_current()->setbrg();
 }
 
+/**
+ * serial_flush() - Wait until the selected serial port has sent everything
+ *
+ * The legacy serial drivers do not buffer output, so there is nothing to
+ * wait for.
+ */
+void serial_flush(void)
+{
+}
+
 /**
  * serial_getc() - Read character from currently selected serial port
  *
@@ -11,11 +11,14 @@
 #include <div64.h>
 #include <dm.h>
 #include <errno.h>
+#include <malloc.h>
 #include <serial.h>
 #include <watchdog.h>
 #include <asm/io.h>
 #include <asm/types.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 struct mtk_serial_regs {
 	u32 rbr;
 	u32 ier;
@@ -68,9 +71,17 @@ struct mtk_serial_regs {
 #define BAUD_ALLOW_MAX(baud)	((baud) + (baud) * 3 / 100)
 #define BAUD_ALLOW_MIX(baud)	((baud) - (baud) * 3 / 100)
 
+/* Depth of the TX FIFO, which can be filled at once when THRE is set */
+#define UART_TX_FIFO_SIZE	16
+
 struct mtk_serial_priv {
 	struct mtk_serial_regs __iomem *regs;
 	u32 clock;
+#ifdef CONFIG_MTK_SERIAL_TX_BUFFER
+	char *txbuf;		/* Only allocated after relocation */
+	uint txhead;
+	uint txtail;
+#endif
 };
 
 static void _mtk_serial_setbrg(struct mtk_serial_priv *priv, int baud)
@@ -141,6 +152,43 @@ static void _mtk_serial_setbrg(struct mtk_serial_priv *priv, int baud)
 	}
 }
 
+/* Rate _mtk_serial_setbrg() really gets for a requested rate */
+static u32 _mtk_serial_realbaud(u32 clock, int baud)
+{
+	u32 quot, samplecount;
+
+	if (baud <= 115200) {
+		if (clock != 12000000) {
+			quot = DIV_ROUND_CLOSEST(clock, 16 * baud);
+			return clock / 16 / quot;
+		}
+
+		quot = DIV_ROUND_CLOSEST(clock, 256 * baud);
+		if (quot == 0)
+			quot = 1;
+	} else if (baud <= 576000) {
+		if ((baud == 500000) || (baud == 576000))
+			baud = 460800;
+		quot = DIV_ROUND_UP(clock, 4 * baud);
+		return clock / 4 / quot;
+	} else {
+		quot = DIV_ROUND_UP(clock, 256 * baud);
+	}
+
+	samplecount = DIV_ROUND_CLOSEST(clock, quot * baud);
+	if (!samplecount)
+		return 0;
+
+	return clock / samplecount / quot;
+}
+
+static int _mtk_serial_baud_error(u32 clock, int baud)
+{
+	u32 realbaud = _mtk_serial_realbaud(clock, baud);
+
+	return DIV_ROUND_CLOSEST(abs((int)realbaud - baud) * 1000ULL, baud);
+}
+
 static int _mtk_serial_putc(struct mtk_serial_priv *priv, const char ch)
 {
 	if (!(readl(&priv->regs->lsr) & UART_LSR_THRE))
@@ -162,20 +210,115 @@ static int _mtk_serial_getc(struct mtk_serial_priv *priv)
 	return readl(&priv->regs->rbr);
 }
 
+/* Output is only done once the shift register has run empty too */
 static int _mtk_serial_pending(struct mtk_serial_priv *priv, bool input)
 {
 	if (input)
 		return (readl(&priv->regs->lsr) & UART_LSR_DR) ? 1 : 0;
 	else
-		return (readl(&priv->regs->lsr) & UART_LSR_THRE) ? 0 : 1;
+		return (readl(&priv->regs->lsr) & UART_LSR_TEMT) ? 0 : 1;
+}
+
+static void _mtk_serial_tx_wait_empty(struct mtk_serial_priv *priv)
+{
+	while (!(readl(&priv->regs->lsr) & UART_LSR_TEMT))
+		;
 }
 
 #if defined(CONFIG_DM_SERIAL) && \
     (!defined(CONFIG_SPL_BUILD) || defined(CONFIG_SPL_DM))
+#ifdef CONFIG_MTK_SERIAL_TX_BUFFER
+#define TX_BUF_SIZE	CONFIG_MTK_SERIAL_TX_BUFFER_SIZE
+
+/*
+ * Output is queued in a ring buffer, and moved to the TX FIFO a whole FIFO
+ * at a time whenever the FIFO has run empty. This is done on every console
+ * access and from serial_poll_tx(), so that the CPU does not wait for the
+ * UART to send out each character.
+ */
+static void _mtk_serial_tx_fill(struct mtk_serial_priv *priv)
+{
+	int i;
+
+	if (priv->txhead == priv->txtail ||
+	    !(readl(&priv->regs->lsr) & UART_LSR_THRE))
+		return;
+
+	for (i = 0; i < UART_TX_FIFO_SIZE && priv->txtail != priv->txhead;
+	     i++) {
+		writel(priv->txbuf[priv->txtail % TX_BUF_SIZE],
+		       &priv->regs->thr);
+		priv->txtail++;
+	}
+}
+
+static bool _mtk_serial_tx_queued(struct mtk_serial_priv *priv)
+{
+	return priv->txhead != priv->txtail;
+}
+
+static void _mtk_serial_tx_flush(struct mtk_serial_priv *priv)
+{
+	if (!priv->txbuf)
+		return;
+
+	while (_mtk_serial_tx_queued(priv))
+		_mtk_serial_tx_fill(priv);
+}
+
+static int _mtk_serial_tx_putc(struct mtk_serial_priv *priv, const char ch)
+{
+	if (priv->txhead - priv->txtail == TX_BUF_SIZE) {
+		_mtk_serial_tx_fill(priv);
+		if (priv->txhead - priv->txtail == TX_BUF_SIZE)
+			return -EAGAIN;
+	}
+
+	priv->txbuf[priv->txhead % TX_BUF_SIZE] = ch;
+	priv->txhead++;
+
+	_mtk_serial_tx_fill(priv);
+
+	if (ch == '\n')
+		WATCHDOG_RESET();
+
+	return 0;
+}
+
+static struct mtk_serial_priv *mtk_serial_tx_priv(struct udevice *dev)
+{
+	struct mtk_serial_priv *priv = dev_get_priv(dev);
+
+	return priv->txbuf ? priv : NULL;
+}
+#else
+static inline void _mtk_serial_tx_fill(struct mtk_serial_priv *priv) {}
+static inline bool _mtk_serial_tx_queued(struct mtk_serial_priv *priv)
+{
+	return false;
+}
+
+static inline void _mtk_serial_tx_flush(struct mtk_serial_priv *priv) {}
+static inline int _mtk_serial_tx_putc(struct mtk_serial_priv *priv,
+				      const char ch)
+{
+	return -ENOSYS;
+}
+
+static inline struct mtk_serial_priv *mtk_serial_tx_priv(struct udevice *dev)
+{
+	return NULL;
+}
+#endif /* CONFIG_MTK_SERIAL_TX_BUFFER */
+
 static int mtk_serial_setbrg(struct udevice *dev, int baudrate)
 {
 	struct mtk_serial_priv *priv = dev_get_priv(dev);
 
+	/* Don't garble what is still queued or being shifted out */
+	_mtk_serial_tx_flush(priv);
+	_mtk_serial_tx_wait_empty(priv);
+
 	_mtk_serial_setbrg(priv, baudrate);
 
 	return 0;
@@ -185,6 +328,9 @@ static int mtk_serial_putc(struct udevice *dev, const char ch)
 {
 	struct mtk_serial_priv *priv = dev_get_priv(dev);
 
+	if (mtk_serial_tx_priv(dev))
+		return _mtk_serial_tx_putc(priv, ch);
+
 	return _mtk_serial_putc(priv, ch);
 }
 
@@ -192,6 +338,9 @@ static int mtk_serial_getc(struct udevice *dev)
 {
 	struct mtk_serial_priv *priv = dev_get_priv(dev);
 
+	if (mtk_serial_tx_priv(dev))
+		_mtk_serial_tx_fill(priv);
+
 	return _mtk_serial_getc(priv);
 }
 
@@ -199,6 +348,13 @@ static int mtk_serial_pending(struct udevice *dev, bool input)
 {
 	struct mtk_serial_priv *priv = dev_get_priv(dev);
 
+	if (mtk_serial_tx_priv(dev)) {
+		_mtk_serial_tx_fill(priv);
+
+		if (!input && _mtk_serial_tx_queued(priv))
+			return 1;
+	}
+
 	return _mtk_serial_pending(priv, input);
 }
 
@@ -212,6 +368,12 @@ static int mtk_serial_probe(struct udevice *dev)
 	writel(UART_MCRVAL, &priv->regs->mcr);
 	writel(UART_FCRVAL, &priv->regs->fcr);
 
+#ifdef CONFIG_MTK_SERIAL_TX_BUFFER
+	/* Too large for the heap before relocation */
+	if (gd->flags & GD_FLG_RELOC)
+		priv->txbuf = malloc(TX_BUF_SIZE);
+#endif
+
 	return 0;
 }
 
@@ -272,9 +434,38 @@ U_BOOT_DRIVER(serial_mtk) = {
 	.ops = &mtk_serial_ops,
 	.flags = DM_FLAG_PRE_RELOC,
 };
-#else
 
-DECLARE_GLOBAL_DATA_PTR;
+int serial_baud_error(int baud)
+{
+	struct udevice *dev = gd->cur_serial_dev;
+	struct mtk_serial_priv *priv;
+
+	if (!dev || dev->driver != DM_GET_DRIVER(serial_mtk))
+		return 0;
+
+	priv = dev_get_priv(dev);
+
+	return _mtk_serial_baud_error(priv->clock, baud);
+}
+
+#ifdef CONFIG_MTK_SERIAL_TX_BUFFER
+/*
+ * Move queued output on to the UART. Long running loops which don't touch
+ * the console call this, so that what they printed before goes out.
+ */
+void serial_poll_tx(void)
+{
+	struct udevice *dev = gd->cur_serial_dev;
+
+	if (!dev || dev->driver != DM_GET_DRIVER(serial_mtk) ||
+	    !(dev->flags & DM_FLAG_ACTIVATED))
+		return;
+
+	if (mtk_serial_tx_priv(dev))
+		_mtk_serial_tx_fill(dev_get_priv(dev));
+}
+#endif
+#else
 
 #define DECLARE_HSUART_PRIV(port) \
 	static struct mtk_serial_priv mtk_hsuart##port = { \
@@ -293,6 +484,7 @@ DECLARE_GLOBAL_DATA_PTR;
 	} \
 	static void mtk_serial##port##_setbrg(void) \
 	{ \
+		_mtk_serial_tx_wait_empty(&mtk_hsuart##port); \
 		_mtk_serial_setbrg(&mtk_hsuart##port, gd->baudrate); \
 	} \
 	static int mtk_serial##port##_getc(void) \
@@ -400,6 +592,11 @@ __weak struct serial_device *default_serial_console(void)
 #endif
 }
 
+int serial_baud_error(int baud)
+{
+	return _mtk_serial_baud_error(CONFIG_SYS_NS16550_CLK, baud);
+}
+
 void mtk_serial_initialize(void)
 {
 #if defined(CONFIG_SYS_NS16550_COM1)
@@ -9,7 +9,9 @@
 #include <dm.h>
 #include <errno.h>
 #include <spi.h>
+#include <asm/addrspace.h>
 #include <asm/io.h>
+#include <asm/unaligned.h>
 #include <linux/bitops.h>
 #include <linux/iopoll.h>
 
@@ -45,6 +47,7 @@
 
 #define MT7621_RX_FIFO_LEN			32
 #define MT7621_TX_FIFO_LEN			36
+#define MT7621_OP_ADDR_LEN			4
 
 #define MT7621_SPI_MAX_CS_NUM			2
 
@@ -53,6 +56,23 @@
 struct mt7621_spi_priv {
 	void __iomem *base;
 	u32 bus_freq;
+
+	/* Opcode, address and dummy bytes held back for the next transfer */
+	u8 cmd_buf[MT7621_TX_FIFO_LEN];
+	u32 cmd_len;
+};
+
+/*
+ * A flash style operation: a command phase (opcode, address and dummy
+ * bytes) followed by a data phase in one direction. The command phase
+ * and the first FIFO worth of data share one controller transaction.
+ */
+struct mt7621_spi_op {
+	const u8 *cmd;
+	size_t cmd_len;
+	const u8 *dout;
+	u8 *din;
+	size_t data_len;
 };
 
 static u32 mt7621_spi_get_clk_div(u32 hclk_freq, u32 freq)
@@ -100,76 +120,156 @@ static void mt7621_spi_set_cs(struct mt7621_spi_priv *priv, int cs, int enable)
 	}
 }
 
-static int mt7621_spi_read(struct mt7621_spi_priv *priv, u8 *buf, size_t len)
+/* Load up to MT7621_TX_FIFO_LEN bytes into the OP_ADDR and DIDO registers */
+static void mt7621_spi_fill_tx(struct mt7621_spi_priv *priv, const u8 *buf,
+			       size_t len)
 {
-	size_t rx_len;
-	int i, ret;
-	u32 val = 0;
+	size_t opcode_len, dido_len;
+	int i;
+	u32 val;
 
-	while (len) {
-		rx_len = min_t(size_t, len, MT7621_RX_FIFO_LEN);
+	opcode_len = min_t(size_t, len, MT7621_OP_ADDR_LEN);
+	dido_len = len - opcode_len;
 
-		writel((rx_len * 8) << MISO_BIT_CNT_SHIFT,
-			priv->base + SPI_MOREBUF_REG);
-		writel(SPI_MASTER_START, priv->base + SPI_TRANS_REG);
+	/* The opcode register is shifted out MSB first */
+	val = 0;
+	for (i = 0; i < opcode_len; i++) {
+		val <<= 8;
+		val |= *buf++;
+	}
 
-		ret = mt7621_spi_busy_wait(priv);
-		if (ret)
-			return ret;
+	writel(val, priv->base + SPI_OP_ADDR_REG);
 
-		for (i = 0; i < rx_len; i++) {
-			if ((i % 4) == 0)
-				val = readl(priv->base + SPI_DIDO_REG(i / 4));
+	for (i = 0; i + 4 <= dido_len; i += 4) {
+		writel(get_unaligned_le32(buf), priv->base + SPI_DIDO_REG(i / 4));
+		buf += 4;
+	}
+
+	if (i < dido_len) {
+		val = 0;
+		for (; i < dido_len; i++)
+			val |= (*buf++) << ((i % 4) * 8);
+		writel(val, priv->base + SPI_DIDO_REG(i / 4));
+	}
+}
+
+/* Drain received bytes from the DIDO registers, one word at a time */
+static void mt7621_spi_drain_rx(struct mt7621_spi_priv *priv, u8 *buf,
+				size_t len)
+{
+	int i;
+	u32 val;
+
+	if (!((uintptr_t)buf & 3)) {
+		for (i = 0; i + 4 <= len; i += 4) {
+			*(u32 *)buf = cpu_to_le32(readl(priv->base +
+							SPI_DIDO_REG(i / 4)));
+			buf += 4;
+		}
+	} else {
+		for (i = 0; i + 4 <= len; i += 4) {
+			put_unaligned_le32(readl(priv->base +
+						 SPI_DIDO_REG(i / 4)), buf);
+			buf += 4;
+		}
+	}
+
+	if (i < len) {
+		val = readl(priv->base + SPI_DIDO_REG(i / 4));
+		for (; i < len; i++) {
 			*buf++ = val & 0xff;
 			val >>= 8;
 		}
-
-		len -= rx_len;
 	}
+}
 
-	return ret;
+/* Run one transaction: tx_len bytes already loaded, then rx_len bytes */
+static int mt7621_spi_trans(struct mt7621_spi_priv *priv, size_t tx_len,
+			    size_t rx_len)
+{
+	size_t opcode_len, dido_len;
+
+	opcode_len = min_t(size_t, tx_len, MT7621_OP_ADDR_LEN);
+	dido_len = tx_len - opcode_len;
+
+	writel(((opcode_len * 8) << CMD_BIT_CNT_SHIFT) |
+		((dido_len * 8) << MOSI_BIT_CNT_SHIFT) |
+		((rx_len * 8) << MISO_BIT_CNT_SHIFT),
+		priv->base + SPI_MOREBUF_REG);
+	writel(SPI_MASTER_START, priv->base + SPI_TRANS_REG);
+
+	return mt7621_spi_busy_wait(priv);
 }
 
-static int mt7621_spi_write(struct mt7621_spi_priv *priv, const u8 *buf,
-			    size_t len)
+static int mt7621_spi_exec_op(struct mt7621_spi_priv *priv,
+			      const struct mt7621_spi_op *op)
 {
-	size_t tx_len, opcode_len, dido_len;
-	int i, ret;
-	u32 val;
+	const u8 *cmd = op->cmd, *dout = op->dout;
+	size_t cmd_len = op->cmd_len, len = op->data_len;
+	u8 *din = op->din;
+	size_t tx_len, rx_len;
+	int ret;
 
-	while (len) {
-		tx_len = min_t(size_t, len, MT7621_TX_FIFO_LEN);
+	/* Command bytes which do not fit along with the data phase */
+	while (cmd_len > MT7621_TX_FIFO_LEN) {
+		mt7621_spi_fill_tx(priv, cmd, MT7621_TX_FIFO_LEN);
+		ret = mt7621_spi_trans(priv, MT7621_TX_FIFO_LEN, 0);
+		if (ret)
+			return ret;
 
-		opcode_len = min_t(size_t, tx_len, 4);
-		dido_len = tx_len - opcode_len;
+		cmd += MT7621_TX_FIFO_LEN;
+		cmd_len -= MT7621_TX_FIFO_LEN;
+	}
 
-		val = 0;
-		for (i = 0; i < opcode_len; i++) {
-			val <<= 8;
-			val |= *buf++;
-		}
+	if (din) {
+		if (cmd_len)
+			mt7621_spi_fill_tx(priv, cmd, cmd_len);
 
-		writel(val, priv->base + SPI_OP_ADDR_REG);
+		do {
+			rx_len = min_t(size_t, len, MT7621_RX_FIFO_LEN);
 
-		val = 0;
-		for (i = 0; i < dido_len; i++) {
-			val |= (*buf++) << ((i % 4) * 8);
+			ret = mt7621_spi_trans(priv, cmd_len, rx_len);
+			if (ret)
+				return ret;
 
-			if ((i % 4 == 3) || (i == dido_len - 1)) {
-				writel(val, priv->base + SPI_DIDO_REG(i / 4));
-				val = 0;
-			}
-		}
+			mt7621_spi_drain_rx(priv, din, rx_len);
+
+			cmd_len = 0;
+			din += rx_len;
+			len -= rx_len;
+		} while (len);
+
+		return 0;
+	}
+
+	/* Send the command bytes along with the start of the data */
+	if (cmd_len) {
+		u8 buf[MT7621_TX_FIFO_LEN];
+
+		tx_len = min_t(size_t, len, MT7621_TX_FIFO_LEN - cmd_len);
+
+		memcpy(buf, cmd, cmd_len);
+		if (tx_len)
+			memcpy(buf + cmd_len, dout, tx_len);
+
+		mt7621_spi_fill_tx(priv, buf, cmd_len + tx_len);
+		ret = mt7621_spi_trans(priv, cmd_len + tx_len, 0);
+		if (ret)
+			return ret;
+
+		dout += tx_len;
+		len -= tx_len;
+	}
 
-		writel(((opcode_len * 8) << CMD_BIT_CNT_SHIFT) |
-			((dido_len * 8) << MOSI_BIT_CNT_SHIFT),
-			priv->base + SPI_MOREBUF_REG);
-		writel(SPI_MASTER_START, priv->base + SPI_TRANS_REG);
+	while (len) {
+		tx_len = min_t(size_t, len, MT7621_TX_FIFO_LEN);
 
-		ret = mt7621_spi_busy_wait(priv);
+		mt7621_spi_fill_tx(priv, dout, tx_len);
+		ret = mt7621_spi_trans(priv, tx_len, 0);
 		if (ret)
 			return ret;
 
+		dout += tx_len;
 		len -= tx_len;
 	}
 
@@ -182,20 +282,51 @@ static int mt7621_spi_xfer(struct udevice *dev, unsigned int bitlen,
 	struct udevice *bus = dev_get_parent(dev);
 	struct mt7621_spi_priv *priv = dev_get_priv(bus);
 	struct dm_spi_slave_platdata *plat = dev_get_parent_platdata(dev);
+	struct mt7621_spi_op op;
 	int len, ret = 0;
 
+	if (flags & SPI_XFER_MMAP) {
+		/* Direct reads need the controller out of more-buffer mode */
+		mt7621_spi_set_cs(priv, plat->cs, 0);
+		return 0;
+	}
+
+	if (flags & SPI_XFER_MMAP_END)
+		return 0;
+
+	/* The controller is half-duplex only */
 	if (din && dout)
 		return -ENOTSUPP;
 
-	if (flags & SPI_XFER_BEGIN)
+	if (flags & SPI_XFER_BEGIN) {
 		mt7621_spi_set_cs(priv, plat->cs, 1);
+		priv->cmd_len = 0;
+	}
 
 	len = (bitlen + 7) / 8;
 
-	if (din)
-		ret = mt7621_spi_read(priv, din, len);
-	else if (dout)
-		ret = mt7621_spi_write(priv, dout, len);
+	/*
+	 * A short write which leaves the chip selected is the command phase
+	 * of a flash operation. Hold it back so that it goes out in the same
+	 * transaction as the first part of the data phase.
+	 */
+	if (dout && !(flags & SPI_XFER_END) &&
+	    priv->cmd_len + len <= MT7621_TX_FIFO_LEN) {
+		memcpy(priv->cmd_buf + priv->cmd_len, dout, len);
+		priv->cmd_len += len;
+		return 0;
+	}
+
+	if (din || dout || priv->cmd_len) {
+		op.cmd = priv->cmd_buf;
+		op.cmd_len = priv->cmd_len;
+		op.dout = dout;
+		op.din = din;
+		op.data_len = (din || dout) ? len : 0;
+
+		ret = mt7621_spi_exec_op(priv, &op);
+		priv->cmd_len = 0;
+	}
 
 	if (flags & SPI_XFER_END)
 		mt7621_spi_set_cs(priv, plat->cs, 0);
@@ -203,6 +334,19 @@ static int mt7621_spi_xfer(struct udevice *dev, unsigned int bitlen,
 	return ret;
 }
 
+/*
+ * The direct read window is copied through its cached alias so that the
+ * bus can use burst reads. Lines left over from an earlier copy may be
+ * stale if the flash has been written since, so they are dropped first.
+ */
+void spi_flash_copy_mmap(void *data, void *offset, size_t len)
+{
+	ulong src = CKSEG0ADDR((ulong)offset);
+
+	invalidate_dcache_range(src, src + len);
+	memcpy(data, (void *)src, len);
+}
+
 static int mt7621_spi_set_speed(struct udevice *bus, uint speed)
 {
 	struct mt7621_spi_priv *priv = dev_get_priv(bus);
@@ -20,6 +20,10 @@
 #define CMD_SAVEENV
 #endif
 
+#ifndef CONFIG_ENV_RANGE
+#define CONFIG_ENV_RANGE	CONFIG_ENV_SIZE
+#endif
+
 #if defined(ENV_IS_EMBEDDED)
 env_t *env_ptr = &environment;
 #else /* ! ENV_IS_EMBEDDED */
@@ -60,21 +64,12 @@ static int env_nmbm_init(void)
 }
 
 #ifdef CMD_SAVEENV
-static int env_nmbm_save(void)
+/* Save the environment as a single image, erasing the whole area */
+static int env_nmbm_save_image(struct mtd_info *mtd, env_t *env_new)
 {
-	ALLOC_CACHE_ALIGN_BUFFER(env_t, env_new, 1);
-	struct mtd_info *mtd;
 	struct erase_info ei;
 	int ret = 0;
 
-	ret = env_export(env_new);
-	if (ret)
-		return ret;
-
-	mtd = nmbm_mtd_get_upper_by_index(0);
-	if (!mtd)
-		return 1;
-
 	printf("Erasing on NMBM...\n");
 	memset(&ei, 0, sizeof(ei));
 
@@ -94,6 +89,313 @@ static int env_nmbm_save(void)
 }
 #endif /* CMD_SAVEENV */
 
+#ifdef CONFIG_ENV_NMBM_LOG
+/*
+ * Log-structured environment
+ *
+ * The CONFIG_ENV_RANGE area is split into two slots of whole erase blocks,
+ * so it must be at least two erase blocks large. Otherwise, or if a record does
+ * not fit into a slot, the single-image format is used. Every save appends
+ * one record to the active slot:
+ *
+ *   struct env_log_hdr | env data (up to the double NUL) | 0xff padding
+ *
+ * padded to a whole page. When the active slot is full the other slot is
+ * erased and becomes the active one. The record with the highest sequence
+ * number whose header and data CRCs are both valid is the current
+ * environment. A torn write only damages the record being written, which
+ * is skipped on load.
+ */
+#define ENV_LOG_MAGIC		0x474c4e45	/* "ENLG" */
+#define ENV_LOG_SLOTS		2
+
+struct env_log_hdr {
+	u32 magic;
+	u32 seq;
+	u32 len;
+	u32 data_crc;
+	u32 hdr_crc;
+};
+
+struct env_log_state {
+	bool valid;
+	u32 slot;
+	u32 seq;
+	u32 next[ENV_LOG_SLOTS];
+};
+
+struct env_log_scan {
+	u8 *buf;
+	env_t *env;
+	bool found;
+	u32 newest;
+	bool seq_valid;
+};
+
+static struct env_log_state env_log;
+
+/* Both slots lie within CONFIG_ENV_RANGE, the size of the env partition */
+static u32 env_log_slot_size(struct mtd_info *mtd)
+{
+	return rounddown(CONFIG_ENV_RANGE / ENV_LOG_SLOTS, mtd->erasesize);
+}
+
+static bool env_log_usable(struct mtd_info *mtd)
+{
+	return mtd->erasesize && env_log_slot_size(mtd);
+}
+
+static u32 env_log_slot_offset(struct mtd_info *mtd, u32 slot)
+{
+	return CONFIG_ENV_OFFSET + slot * env_log_slot_size(mtd);
+}
+
+static int env_log_read(struct mtd_info *mtd, u32 offset, u32 len, void *buf)
+{
+	size_t retlen;
+	int ret;
+
+	ret = mtd_read(mtd, offset, len, &retlen, buf);
+	if (ret && !mtd_is_bitflip(ret))
+		return ret;
+
+	return retlen == len ? 0 : -EIO;
+}
+
+static bool env_log_page_erased(const void *buf, u32 size)
+{
+	const u32 *p = buf;
+	u32 i;
+
+	for (i = 0; i < size / sizeof(u32); i++) {
+		if (p[i] != 0xffffffff)
+			return false;
+	}
+
+	return true;
+}
+
+static u32 env_log_hdr_crc(const struct env_log_hdr *hdr)
+{
+	return crc32(0, (const u8 *)hdr, offsetof(struct env_log_hdr, hdr_crc));
+}
+
+static u32 env_log_rec_size(struct mtd_info *mtd, u32 len)
+{
+	return ALIGN(sizeof(struct env_log_hdr) + len, mtd->writesize);
+}
+
+/*
+ * Walk one slot page by page. Records with a valid header are skipped as a
+ * whole, anything else which is not erased is skipped one page at a time.
+ * Returns the offset right after the last programmed page, i.e. where the
+ * next record can be appended.
+ */
+static u32 env_log_scan_slot(struct mtd_info *mtd, u32 slot,
+			     struct env_log_scan *sc)
+{
+	u32 base = env_log_slot_offset(mtd, slot);
+	u32 size = env_log_slot_size(mtd);
+	struct env_log_hdr *hdr = (struct env_log_hdr *)sc->buf;
+	u8 *buf = sc->buf;
+	u32 pos = 0, next = 0, rec_size;
+
+	while (pos < size) {
+		if (env_log_read(mtd, base + pos, mtd->writesize, buf)) {
+			pos += mtd->writesize;
+			next = pos;
+			continue;
+		}
+
+		if (env_log_page_erased(buf, mtd->writesize)) {
+			pos += mtd->writesize;
+			continue;
+		}
+
+		if (hdr->magic != ENV_LOG_MAGIC ||
+		    hdr->hdr_crc != env_log_hdr_crc(hdr) ||
+		    hdr->len > ENV_SIZE ||
+		    env_log_rec_size(mtd, hdr->len) > size - pos) {
+			pos += mtd->writesize;
+			next = pos;
+			continue;
+		}
+
+		rec_size = env_log_rec_size(mtd, hdr->len);
+
+		/* Sequence numbers of damaged records must not be reused */
+		if (!sc->seq_valid || (s32)(hdr->seq - env_log.seq) > 0)
+			env_log.seq = hdr->seq;
+		sc->seq_valid = true;
+
+		if (rec_size > mtd->writesize &&
+		    env_log_read(mtd, base + pos + mtd->writesize,
+				 rec_size - mtd->writesize,
+				 buf + mtd->writesize))
+			goto skip;
+
+		if (crc32(0, buf + sizeof(*hdr), hdr->len) != hdr->data_crc)
+			goto skip;
+
+		if (sc->found && (s32)(hdr->seq - sc->newest) < 0)
+			goto skip;
+
+		sc->found = true;
+		sc->newest = hdr->seq;
+		env_log.slot = slot;
+
+		if (sc->env) {
+			memset(sc->env->data, 0, ENV_SIZE);
+			memcpy(sc->env->data, buf + sizeof(*hdr), hdr->len);
+		}
+
+	skip:
+		pos += rec_size;
+		next = pos;
+	}
+
+	return next;
+}
+
+static int env_log_scan(struct mtd_info *mtd, env_t *env)
+{
+	struct env_log_scan sc = { .env = env };
+	u32 slot;
+
+	sc.buf = malloc(env_log_slot_size(mtd));
+	if (!sc.buf)
+		return -ENOMEM;
+
+	memset(&env_log, 0, sizeof(env_log));
+
+	for (slot = 0; slot < ENV_LOG_SLOTS; slot++)
+		env_log.next[slot] = env_log_scan_slot(mtd, slot, &sc);
+
+	env_log.valid = true;
+
+	free(sc.buf);
+
+	return sc.found ? 0 : -ENOENT;
+}
+
+#ifdef CMD_SAVEENV
+static u32 env_log_data_len(const char *data)
+{
+	u32 len;
+
+	for (len = 0; len < ENV_SIZE - 1; len++) {
+		if (!data[len] && !data[len + 1])
+			return len + 2;
+	}
+
+	return ENV_SIZE;
+}
+
+/* Returns -ENOSPC if the environment must be saved as a single image */
+static int env_log_save(struct mtd_info *mtd, env_t *env_new)
+{
+	struct env_log_hdr *hdr;
+	struct erase_info ei;
+	u32 slot, offset, len, rec_size;
+	size_t retlen;
+	u8 *rec;
+	int ret;
+
+	if (!env_log_usable(mtd))
+		return -ENOSPC;
+
+	len = env_log_data_len((const char *)env_new->data);
+	rec_size = env_log_rec_size(mtd, len);
+
+	if (rec_size > env_log_slot_size(mtd))
+		return -ENOSPC;
+
+	if (!env_log.valid)
+		env_log_scan(mtd, NULL);
+
+	slot = env_log.slot;
+	offset = env_log.next[slot];
+
+	if (rec_size > env_log_slot_size(mtd) - offset) {
+		slot = (slot + 1) % ENV_LOG_SLOTS;
+		offset = 0;
+
+		printf("Erasing on NMBM...\n");
+		memset(&ei, 0, sizeof(ei));
+
+		ei.mtd = mtd;
+		ei.addr = env_log_slot_offset(mtd, slot);
+		ei.len = env_log_slot_size(mtd);
+
+		if (mtd_erase(mtd, &ei)) {
+			env_log.next[slot] = env_log_slot_size(mtd);
+			return 1;
+		}
+
+		env_log.next[slot] = 0;
+	}
+
+	rec = malloc(rec_size);
+	if (!rec)
+		return 1;
+
+	memset(rec, 0xff, rec_size);
+
+	hdr = (struct env_log_hdr *)rec;
+	hdr->magic = ENV_LOG_MAGIC;
+	hdr->seq = env_log.seq + 1;
+	hdr->len = len;
+	hdr->data_crc = crc32(0, env_new->data, len);
+	hdr->hdr_crc = env_log_hdr_crc(hdr);
+	memcpy(rec + sizeof(*hdr), env_new->data, len);
+
+	printf("Writing on NMBM... ");
+	ret = mtd_write(mtd, env_log_slot_offset(mtd, slot) + offset, rec_size,
+			&retlen, rec);
+	puts(ret ? "FAILED!\n" : "OK\n");
+
+	free(rec);
+
+	/* Pages of a failed write may be partially programmed */
+	env_log.next[slot] = offset + rec_size;
+	env_log.seq++;
+
+	if (!ret)
+		env_log.slot = slot;
+
+	return !!ret;
+}
+#endif /* CMD_SAVEENV */
+#endif /* CONFIG_ENV_NMBM_LOG */
+
+#ifdef CMD_SAVEENV
+static int env_nmbm_save(void)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(env_t, env_new, 1);
+	struct mtd_info *mtd;
+	int ret;
+
+	ret = env_export(env_new);
+	if (ret)
+		return ret;
+
+	mtd = nmbm_mtd_get_upper_by_index(0);
+	if (!mtd)
+		return 1;
+
+#ifdef CONFIG_ENV_NMBM_LOG
+	ret = env_log_save(mtd, env_new);
+	if (ret != -ENOSPC)
+		return ret;
+
+	/* This erases the log, start over on the next save */
+	env_log.valid = false;
+#endif
+
+	return env_nmbm_save_image(mtd, env_new);
+}
+#endif /* CMD_SAVEENV */
+
 static int readenv(size_t offset, u_char *buf)
 {
 	struct mtd_info *mtd;
@@ -116,6 +418,19 @@ static int env_nmbm_load(void)
 	ALLOC_CACHE_ALIGN_BUFFER(char, buf, CONFIG_ENV_SIZE);
 	int ret;
 
+#ifdef CONFIG_ENV_NMBM_LOG
+	struct mtd_info *mtd;
+
+	mtd = nmbm_mtd_get_upper_by_index(0);
+	if (mtd && env_log_usable(mtd)) {
+		ret = env_log_scan(mtd, (env_t *)buf);
+		if (!ret)
+			return env_import(buf, 0);
+	}
+
+	/* Fall back to an environment saved in the single-image format */
+#endif /* CONFIG_ENV_NMBM_LOG */
+
 	ret = readenv(CONFIG_ENV_OFFSET, (u_char *)buf);
 	if (ret) {
 		set_default_env("readenv() failed", 0);
@@ -8,6 +8,7 @@
 
 #include <common.h>
 #include <malloc.h>
+#include <obj_pool.h>
 #include <net/tcp.h>
 #include <net/httpd.h>
 #include <u-boot/md5.h>
@@ -83,7 +84,7 @@ static void upload_handler(enum httpd_uri_handler_status status,
 			return;
 		}
 
-		buff = malloc(response->size + 1);
+		buff = obj_pool_alloc(OBJ_POOL_GET(page), response->size + 1);
 		if (buff) {
 			memcpy(buff, response->data, response->size);
 			buff[response->size] = 0;
@@ -92,7 +93,14 @@ static void upload_handler(enum httpd_uri_handler_status status,
 			size_ptr = strstr(buff, "YYYYYYYYYY");
 
 			if (md5_ptr) {
-				md5((u8 *) fw->data, fw->size, md5_sum);
+				/* Normally hashed while it was received */
+				if (fw->digest)
+					memcpy(md5_sum, fw->digest,
+					       sizeof(md5_sum));
+				else
+					md5((u8 *) fw->data, fw->size,
+					    md5_sum);
+
 				for (i = 0; i < 16; i++) {
 					u8 hex;
 					
@@ -127,7 +135,8 @@ static void upload_handler(enum httpd_uri_handler_status status,
 
 		if (file) {
 			if (file->data != response->data)
-				free((void *) response->data);
+				obj_pool_free(OBJ_POOL_GET(page),
+					      (void *) response->data);
 		}
 	}
 }
@@ -265,6 +274,8 @@ int start_web_failsafe(void)
 		return -1;
 	}
 
+	httpd_set_upload_hash(inst, "firmware", "md5");
+
 	httpd_register_uri_handler(inst, "/", &index_handler, NULL);
 	httpd_register_uri_handler(inst, "/cgi-bin/luci", &index_handler, NULL);
 	httpd_register_uri_handler(inst, "/upload", &upload_handler, NULL);
@@ -199,6 +199,18 @@ enum bootstage_id {
 	BOOTSTATE_ID_ACCUM_DM_SPL,
 	BOOTSTATE_ID_ACCUM_DM_F,
 	BOOTSTATE_ID_ACCUM_DM_R,
+	BOOTSTAGE_ID_ACCUM_FLASH,
+	BOOTSTAGE_ID_ACCUM_HASH,
+	BOOTSTAGE_ID_ACCUM_WAIT,
+	BOOTSTAGE_ID_SPL_NMBM_INIT,
+	BOOTSTAGE_ID_SPL_NMBM_INIT_DONE,
+	BOOTSTAGE_ID_NMBM_INIT,
+	BOOTSTAGE_ID_NMBM_INIT_DONE,
+	BOOTSTAGE_ID_UBI_ATTACH,
+	BOOTSTAGE_ID_UBI_ATTACH_DONE,
+	BOOTSTAGE_ID_DUAL_IMAGE_CHECK,
+	BOOTSTAGE_ID_DUAL_IMAGE_CHECK_DONE,
+	BOOTSTAGE_ID_BOARDBOOT,
 
 	/* a few spare for the user, from here */
 	BOOTSTAGE_ID_USER,
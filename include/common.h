@@ -354,6 +354,12 @@ void smp_kick_all_cpus(void);
 /* $(CPU)/serial.c */
 int	serial_init   (void);
 void	serial_setbrg (void);
+void	serial_flush  (void);
+#if defined(CONFIG_MTK_SERIAL_TX_BUFFER) && !defined(CONFIG_SPL_BUILD)
+void	serial_poll_tx(void);
+#else
+static inline void serial_poll_tx(void) {}
+#endif
 void	serial_putc   (const char);
 void	serial_putc_raw(const char);
 void	serial_puts   (const char *);
@@ -433,8 +439,12 @@ ulong	ticks2usec    (unsigned long ticks);
 /* lib/gunzip.c */
 int gzip_parse_header(const unsigned char *src, unsigned long len);
 int gunzip(void *, int, unsigned char *, unsigned long *);
+int gunzip_cb(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
+	      decomp_input_fn input, void *priv);
 int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
 						int stoponerr, int offset);
+int zunzip_cb(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
+	      int stoponerr, int offset, decomp_input_fn input, void *priv);
 
 /**
  * gzwrite progress indicators: defined weak to allow board-specific
@@ -477,6 +487,8 @@ int gzwrite(unsigned char *src, int len,
 
 /* lib/lz4_wrapper.c */
 int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn);
+int ulz4fn_cb(const void *src, size_t srcn, void *dst, size_t *dstn,
+	      decomp_input_fn input, void *priv);
 
 /* lib/qsort.c */
 void qsort(void *base, size_t nmemb, size_t size,
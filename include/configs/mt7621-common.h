@@ -13,7 +13,12 @@
 
 #define CONFIG_SYS_MONITOR_BASE		CONFIG_SYS_TEXT_BASE
 
+#ifdef CONFIG_MTK_BOARDBOOT_UBI
+/* UBI keeps per-PEB tables and a few PEB-sized buffers */
+#define CONFIG_SYS_MALLOC_LEN		0x400000
+#else
 #define CONFIG_SYS_MALLOC_LEN		0x100000
+#endif
 #define CONFIG_SYS_BOOTPARAMS_LEN	0x20000
 
 #define CONFIG_SYS_SDRAM_BASE		0x80000000
@@ -34,6 +39,11 @@
 
 #define CONFIG_SYS_BOOTM_LEN		0x2000000
 
+#ifdef CONFIG_ENV_NMBM_LOG
+/* Two erase blocks of the 512 KiB u-boot-env partition */
+#define CONFIG_ENV_RANGE		0x40000
+#endif
+
 /* SPL */
 #define CONFIG_SPL_BSS_START_ADDR	0xbe108000
 #define CONFIG_SPL_BSS_MAX_SIZE		0x2000
@@ -110,6 +110,101 @@ int hash_command(const char *algo_name, int flags, cmd_tbl_t *cmdtp, int flag,
 int hash_block(const char *algo_name, const void *data, unsigned int len,
 	       uint8_t *output, int *output_size);
 
+/**
+ * struct hash_stream - Progressive hash of data arriving in sequence
+ *
+ * This is used to hash data while it is being received (e.g. by TFTP or
+ * HTTP), so that the digest is available as soon as the transfer ends
+ * instead of requiring another pass over the loaded data.
+ *
+ * Every piece of data is passed in together with its offset in the
+ * stream. Pieces which have been seen before (retransmissions) are
+ * ignored. A piece which would leave a gap marks the stream as broken,
+ * in which case the caller has to hash the loaded data itself.
+ *
+ * @algo:	Hash algorithm in use
+ * @ctx:	Progressive hash context, NULL when not active
+ * @skip:	Number of leading bytes which are not hashed
+ * @len:	Number of bytes to hash after @skip, 0 to hash until the end
+ * @pos:	Stream offset of the next byte expected
+ * @hashed:	Number of bytes hashed so far
+ * @broken:	Data was missing, the digest is not usable
+ * @started:	@start has been called
+ * @start:	Optional callback invoked once, right before the first byte
+ *		after @skip is hashed. It may adjust @len, or set @broken
+ *		if the data is not worth hashing.
+ * @priv:	Private data for @start
+ */
+struct hash_stream {
+	struct hash_algo *algo;
+	void *ctx;
+	ulong skip;
+	ulong len;
+	ulong pos;
+	ulong hashed;
+	bool broken;
+	bool started;
+	void (*start)(struct hash_stream *hs);
+	void *priv;
+};
+
+/**
+ * hash_stream_start() - Set up a stream hash
+ *
+ * Fields other than the ones set up here (@len, @start and @priv) must be
+ * filled in by the caller before any data is passed in.
+ *
+ * @hs:		Stream to set up
+ * @algo_name:	Hash algorithm to use, must support progressive hashing
+ * @skip:	Number of leading bytes which are not hashed
+ * @return 0 if ok, -EPROTONOSUPPORT for an unknown algorithm, -ENOMEM if
+ * the hash context could not be created
+ */
+int hash_stream_start(struct hash_stream *hs, const char *algo_name,
+		      ulong skip);
+
+/**
+ * hash_stream_reset() - Discard all data hashed so far
+ *
+ * This is used when a transfer starts over from the beginning.
+ *
+ * @hs:		Stream to reset
+ */
+void hash_stream_reset(struct hash_stream *hs);
+
+/**
+ * hash_stream_update() - Pass a piece of received data to a stream hash
+ *
+ * @hs:		Stream to update
+ * @offset:	Offset of @buf in the stream
+ * @buf:	Data received
+ * @size:	Size of @buf in bytes
+ */
+void hash_stream_update(struct hash_stream *hs, ulong offset,
+			const void *buf, ulong size);
+
+/**
+ * hash_stream_finish() - Finish a stream hash and get its digest
+ *
+ * The hash context is released whether or not this succeeds.
+ *
+ * @hs:		Stream to finish
+ * @output:	Place to put the digest
+ * @size:	Size of @output in bytes
+ * @return 0 if ok, -EIO if the stream is broken or not active, or the
+ * error from the hash algorithm
+ */
+int hash_stream_finish(struct hash_stream *hs, void *output, int size);
+
+/**
+ * hash_stream_abort() - Release a stream hash without using its digest
+ *
+ * This may be called on a stream which is already finished.
+ *
+ * @hs:		Stream to release
+ */
+void hash_stream_abort(struct hash_stream *hs);
+
 #endif /* !USE_HOSTCC */
 
 /**
@@ -22,6 +22,7 @@
 /* Define this to avoid #ifdefs later on */
 struct lmb;
 struct fdt_region;
+struct fit_fused_verify;
 
 #ifdef USE_HOSTCC
 #include <sys/types.h>
@@ -92,6 +93,13 @@ struct fdt_region;
 #define IMAGE_ENABLE_SHA256	0
 #endif
 
+#if defined(CONFIG_FIT_FUSED_VERIFY) && !defined(USE_HOSTCC) && \
+	!defined(CONFIG_SPL_BUILD)
+#define IMAGE_ENABLE_FUSED_VERIFY	1
+#else
+#define IMAGE_ENABLE_FUSED_VERIFY	0
+#endif
+
 #endif /* IMAGE_ENABLE_FIT */
 
 #ifdef CONFIG_SYS_BOOT_GET_CMDLINE
@@ -295,10 +303,22 @@ enum {
 	IH_COMP_LZMA,			/* lzma  Compression Used	*/
 	IH_COMP_LZO,			/* lzo   Compression Used	*/
 	IH_COMP_LZ4,			/* lz4   Compression Used	*/
+	IH_COMP_MBLOCK,			/* Multi-block lz4/lzma		*/
 
 	IH_COMP_COUNT,
 };
 
+/*
+ * Input hook of the *_cb() decompressors. It is called with each piece of
+ * the compressed input, in order and without gaps from its start, right
+ * after the decompressor has consumed it. The decompressors accept NULL,
+ * which makes them equivalent to the versions without a hook.
+ */
+typedef void (*decomp_input_fn)(void *priv, const void *buf, size_t len);
+
+/* Amount of input the *_cb() decompressors consume between two hook calls */
+#define DECOMP_INPUT_CHUNK	0x4000
+
 #define IH_MAGIC	0x27051956	/* Image Magic Number		*/
 #define IH_NMLEN		32	/* Image Name Length		*/
 
@@ -332,6 +352,28 @@ typedef struct image_info {
 	uint8_t		arch;			/* CPU architecture */
 } image_info_t;
 
+#if IMAGE_ENABLE_FIT && IMAGE_ENABLE_FUSED_VERIFY
+#define FIT_FUSED_MAX_HASHES	2
+
+/**
+ * struct fit_fused_verify - Hashes of a compressed image checked while it
+ *			     is being decompressed
+ *
+ * @count:	Number of hashes, 0 if the image is verified as usual
+ * @pos:	Offset of the next byte expected from the decompressor
+ * @hs:		Stream hash for each hash node of the image
+ * @value:	Expected digest for each hash node
+ * @value_len:	Length of each expected digest
+ */
+struct fit_fused_verify {
+	int		count;
+	ulong		pos;
+	struct hash_stream hs[FIT_FUSED_MAX_HASHES];
+	uint8_t		value[FIT_FUSED_MAX_HASHES][HASH_MAX_DIGEST_SIZE];
+	int		value_len[FIT_FUSED_MAX_HASHES];
+};
+#endif
+
 /*
  * Legacy and FIT format headers used by do_bootm() and do_bootm_<os>()
  * routines.
@@ -366,6 +408,10 @@ typedef struct bootm_headers {
 	int		fit_noffset_setup;/* x86 setup subimage node offset */
 #endif
 
+#if IMAGE_ENABLE_FIT && IMAGE_ENABLE_FUSED_VERIFY
+	struct fit_fused_verify os_verify; /* os hashes checked on decomp */
+#endif
+
 #ifndef USE_HOSTCC
 	image_info_t	os;		/* os image info */
 	ulong		ep;		/* entry point of OS */
@@ -1031,6 +1077,14 @@ int fit_image_verify_with_data(const void *fit, int image_noffset,
 int fit_image_verify(const void *fit, int noffset);
 int fit_config_verify(const void *fit, int conf_noffset);
 int fit_all_image_verify(const void *fit);
+#if IMAGE_ENABLE_FIT && IMAGE_ENABLE_FUSED_VERIFY
+int fit_image_defer_verify(const void *fit, int noffset,
+			   struct fit_fused_verify *fv);
+void fit_fused_verify_input(void *priv, const void *buf, size_t len);
+int fit_fused_verify_finish(struct fit_fused_verify *fv, const void *data,
+			    size_t size);
+void fit_fused_verify_abort(struct fit_fused_verify *fv);
+#endif
 int fit_image_check_os(const void *fit, int noffset, uint8_t os);
 int fit_image_check_arch(const void *fit, int noffset, uint8_t arch);
 int fit_image_check_type(const void *fit, int noffset, uint8_t type);
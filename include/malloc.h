@@ -957,6 +957,17 @@ extern ulong mem_malloc_brk;
 
 void mem_malloc_init(ulong start, ulong size);
 
+struct malloc_heap_info {
+	size_t size;		/* of the whole heap */
+	size_t used;		/* by allocated chunks, overhead included */
+	size_t peak;		/* highest break of the heap */
+	size_t free;
+	size_t largest_free;	/* largest chunk which can be allocated */
+	int free_chunks;
+};
+
+void malloc_heap_info(struct malloc_heap_info *info);
+
 #ifdef __cplusplus
 };  /* end of extern "C" */
 #endif
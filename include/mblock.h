@@ -0,0 +1,63 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Multi-block compressed payload
+ *
+ * The payload is split into blocks of the same uncompressed size (except
+ * for the last one) which are compressed independently, so that they can
+ * be decompressed concurrently. It is stored as an image of compression
+ * type IH_COMP_MBLOCK and laid out as:
+ *
+ *	struct mblock_header
+ *	struct mblock_entry[count]
+ *	compressed blocks, each aligned to MBLOCK_ALIGN bytes
+ *
+ * All fields are big-endian. Each block is an LZ4 frame or an LZMA stream
+ * (as written by 'lzma'), as given by the header.
+ */
+
+#ifndef __MBLOCK_H
+#define __MBLOCK_H
+
+#define MBLOCK_MAGIC		0x4d424c4b	/* "MBLK" */
+#define MBLOCK_ALIGN		4
+#define MBLOCK_MAX_BLOCKS	1024
+
+struct mblock_header {
+	__be32	magic;		/* MBLOCK_MAGIC */
+	uint8_t	comp;		/* IH_COMP_LZ4 or IH_COMP_LZMA */
+	uint8_t	reserved[3];
+	__be32	block_size;	/* Uncompressed size of each block */
+	__be32	size;		/* Total uncompressed size */
+	__be32	count;		/* Number of blocks */
+};
+
+struct mblock_entry {
+	__be32	offset;		/* From the start of the header */
+	__be32	size;		/* Compressed size */
+};
+
+/**
+ * mblock_check() - Check the header and block index of a payload
+ *
+ * @buf:	Start of the payload
+ * @size:	Size of the payload
+ * @return 0 if the payload is valid, -ve on error
+ */
+int mblock_check(const void *buf, size_t size);
+
+/**
+ * mblock_decompress() - Decompress a multi-block payload
+ *
+ * The blocks are shared out between all CPUs available to run_parallel().
+ *
+ * @dst:	Destination buffer
+ * @dstn:	Size of @dst on entry, number of bytes written on exit (or the
+ *		size needed, if @dst is too small)
+ * @src:	Multi-block payload
+ * @srcn:	Size of @src
+ * @return 0 if OK, -ENOSPC if @dst is too small, -EPROTONOSUPPORT if the
+ * block compression is not supported, other -ve value on error
+ */
+int mblock_decompress(void *dst, size_t *dstn, const void *src, size_t srcn);
+
+#endif /* __MBLOCK_H */
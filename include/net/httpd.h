@@ -9,6 +9,7 @@
 #ifndef __NET_HTTPD_H__
 #define __NET_HTTPD_H__
 
+#include <linux/errno.h>
 #include <linux/list.h>
 
 #define MAX_HTTP_FORM_VALUE_ITEMS	5
@@ -18,6 +19,9 @@ struct httpd_form_value {
 	const char *data;
 	const char *filename;
 	size_t size;
+
+	/* Digest computed while the value was received, or NULL */
+	const u8 *digest;
 };
 
 struct httpd_form_values {
@@ -108,6 +112,23 @@ int httpd_unregister_uri_handler(struct httpd_instance *httpd_inst,
 struct httpd_uri_handler *httpd_find_uri_handler(
 	struct httpd_instance *httpd_inst, const char *uri);
 
+#ifdef CONFIG_NET_RX_HASH
+/*
+ * Hash the value of form field @name of every upload with @algo_name while
+ * it is being received. The result is found in the digest member of the
+ * form value. Passing NULL stops hashing.
+ */
+int httpd_set_upload_hash(struct httpd_instance *httpd_inst,
+			  const char *name, const char *algo_name);
+#else
+static inline int httpd_set_upload_hash(struct httpd_instance *httpd_inst,
+					const char *name,
+					const char *algo_name)
+{
+	return -ENOSYS;
+}
+#endif
+
 /* Generate HTTP response header */
 u32 http_make_response_header(struct http_response_info *info, char *buff,
 			      u32 size);
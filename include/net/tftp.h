@@ -22,6 +22,16 @@ void tftp_start(enum proto_t protocol);	/* Begin TFTP get/put */
 void tftp_start_server(void);	/* Wait for incoming TFTP put */
 #endif
 
+#ifdef CONFIG_NET_RX_HASH
+struct hash_stream;
+
+/*
+ * Hash received data into @hs while it is being stored, or stop doing so
+ * if @hs is NULL. The stream is reset whenever the transfer (re)starts.
+ */
+void tftp_set_rx_hash(struct hash_stream *hs);
+#endif
+
 extern ulong tftp_timeout_ms;
 extern int tftp_timeout_count_max;
 
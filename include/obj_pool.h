@@ -0,0 +1,101 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Fixed-size object pools
+ *
+ * A pool hands out objects of one size from a static array, beside the
+ * malloc() heap. Allocating and freeing take constant time, and objects
+ * which come and go all the time (connections, requests, bounce buffers)
+ * do not fragment the heap. When a pool is empty, or a request is larger
+ * than its objects, the object comes from the heap instead.
+ *
+ * Pools only work after relocation, as their state lives in the data
+ * section and their objects in BSS.
+ */
+
+#ifndef __OBJ_POOL_H
+#define __OBJ_POOL_H
+
+#include <linker_lists.h>
+#include <malloc.h>
+#include <asm/cache.h>
+
+struct obj_pool {
+	const char *name;
+	size_t size;		/* of one object */
+	size_t stride;
+	unsigned int count;
+	u8 *mem;
+
+	void *free_list;	/* objects freed earlier */
+	unsigned int next;	/* first object never handed out */
+
+	/* Statistics */
+	unsigned int used;
+	unsigned int peak;
+	unsigned long allocs;
+	unsigned long fallbacks;	/* served from the heap */
+};
+
+#if defined(CONFIG_OBJ_POOL) && !defined(CONFIG_SPL_BUILD)
+
+#define OBJ_POOL_STRIDE(_size)	ALIGN(_size, ARCH_DMA_MINALIGN)
+
+/*
+ * Define a pool of @_count objects of @_size bytes, aligned for DMA. Use
+ * OBJ_POOL_GET(@_name) to refer to it, in any file.
+ */
+#define OBJ_POOL(_name, _size, _count)					\
+	static u8 __obj_pool_mem_##_name[(_count) * OBJ_POOL_STRIDE(_size)] \
+		__aligned(ARCH_DMA_MINALIGN);				\
+	ll_entry_declare(struct obj_pool, _name, obj_pool) = {		\
+		.name = #_name,						\
+		.size = (_size),					\
+		.stride = OBJ_POOL_STRIDE(_size),			\
+		.count = (_count),					\
+		.mem = __obj_pool_mem_##_name,				\
+	}
+
+#define OBJ_POOL_GET(_name)	ll_entry_get(struct obj_pool, _name, obj_pool)
+
+/**
+ * obj_pool_alloc() - Allocate an object from a pool
+ *
+ * @pool:	Pool to allocate from
+ * @size:	Size needed, which may be less than the object size
+ * @return the object, or NULL if neither the pool nor the heap had room
+ */
+void *obj_pool_alloc(struct obj_pool *pool, size_t size);
+
+/**
+ * obj_pool_free() - Give back an object from obj_pool_alloc()
+ *
+ * @pool:	Pool the object was allocated from
+ * @ptr:	Object, may be NULL
+ */
+void obj_pool_free(struct obj_pool *pool, void *ptr);
+
+/* Print the statistics of all pools */
+void obj_pool_print_stats(void);
+
+#else
+
+#define OBJ_POOL(_name, _size, _count)
+#define OBJ_POOL_GET(_name)	NULL
+
+static inline void *obj_pool_alloc(struct obj_pool *pool, size_t size)
+{
+	return malloc(size);
+}
+
+static inline void obj_pool_free(struct obj_pool *pool, void *ptr)
+{
+	free(ptr);
+}
+
+static inline void obj_pool_print_stats(void)
+{
+}
+
+#endif
+
+#endif /* __OBJ_POOL_H */
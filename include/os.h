@@ -351,4 +351,18 @@ int os_setjmp(ulong *jmp, int size);
  */
 void os_longjmp(ulong *jmp, int ret);
 
+/**
+ * os_run_parallel() - Run a function on several host threads
+ *
+ * Worker 0 runs on the calling thread. Workers whose thread cannot be
+ * created run on the calling thread too, after worker 0.
+ *
+ * @fn:		Function to run
+ * @arg:	Argument for @fn
+ * @nworkers:	Number of workers
+ */
+void os_run_parallel(void (*fn)(void *arg, unsigned int worker,
+				unsigned int nworkers),
+		     void *arg, unsigned int nworkers);
+
 #endif
@@ -0,0 +1,48 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Running work on all CPUs of the board
+ */
+
+#ifndef __PARALLEL_H
+#define __PARALLEL_H
+
+/**
+ * typedef parallel_fn - Work function run by run_parallel()
+ *
+ * It may run on a secondary CPU, so it must not use gd, the console,
+ * malloc() or anything else which is not safe to call concurrently.
+ *
+ * @arg:	Argument passed to run_parallel()
+ * @worker:	Index of this worker, 0 to @nworkers - 1
+ * @nworkers:	Number of workers
+ */
+typedef void (*parallel_fn)(void *arg, uint worker, uint nworkers);
+
+/**
+ * parallel_workers() - Get the number of workers run_parallel() would use
+ *
+ * This lets callers set up per-worker state before calling run_parallel().
+ *
+ * @return number of workers, at least 1
+ */
+uint parallel_workers(void);
+
+/**
+ * run_parallel() - Run a function on all available CPUs and wait for it
+ *
+ * Worker 0 always runs on the calling CPU. Boards without support for
+ * secondary CPUs run @fn once, as worker 0 of 1.
+ *
+ * Caches need not be coherent between CPUs. The caller must write back
+ * everything @fn reads with flush_dcache_range() beforehand, @fn must
+ * write back everything it writes, and the caller must invalidate that
+ * before reading it. Workers must not write to the same cache line.
+ *
+ * @fn:		Function to run
+ * @arg:	Argument for @fn
+ * @return number of workers which ran @fn, never more than returned by
+ * parallel_workers() just before
+ */
+uint run_parallel(parallel_fn fn, void *arg);
+
+#endif /* __PARALLEL_H */
@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Named scratch regions of DRAM
+ *
+ * Code needing a large buffer for a while, e.g. for an image being
+ * received, verified or copied, reserves it here under a name instead of
+ * using a fixed address. Regions never overlap each other, U-Boot with its
+ * heap and stack, or the start of DRAM. A request which doesn't fit fails
+ * up front, instead of overwriting whatever is there.
+ */
+
+#ifndef __SCRATCH_H
+#define __SCRATCH_H
+
+/**
+ * scratch_alloc() - Reserve a named scratch region
+ *
+ * If @name is already reserved and large enough, the same region is
+ * returned again. Otherwise any region under @name is released first.
+ *
+ * @name:	Name of the region, must stay valid while it is reserved
+ * @size:	Size needed in bytes
+ * @return the region, or NULL if there isn't enough memory
+ */
+void *scratch_alloc(const char *name, phys_size_t size);
+
+/**
+ * scratch_alloc_max() - Reserve the largest free area as scratch region
+ *
+ * This is for data of unknown size. Once the size is known, give back the
+ * rest with scratch_shrink().
+ *
+ * @name:	Name of the region
+ * @size:	Returns the size of the region
+ * @return the region, or NULL if there is no free memory at all
+ */
+void *scratch_alloc_max(const char *name, phys_size_t *size);
+
+/**
+ * scratch_shrink() - Release the end of a scratch region
+ *
+ * @name:	Name of the region
+ * @size:	Size to keep
+ * @return 0 if OK, -ENOENT if @name isn't reserved
+ */
+int scratch_shrink(const char *name, phys_size_t size);
+
+/**
+ * scratch_free() - Release a scratch region
+ *
+ * @name:	Name of the region, nothing happens if it isn't reserved
+ */
+void scratch_free(const char *name);
+
+/* Print the reserved regions and the free memory */
+void scratch_print(void);
+
+#endif /* __SCRATCH_H */
@@ -15,6 +15,7 @@
 #define _SEARCH_H_
 
 #include <stddef.h>
+#include <linux/rbtree.h>
 
 #define __set_errno(val) do { errno = val; } while (0)
 
@@ -52,6 +53,8 @@ struct hsearch_data {
 	struct _ENTRY *table;
 	unsigned int size;
 	unsigned int filled;
+	/* Used entries sorted by key (CONFIG_HASHTABLE_ORDERED_INDEX) */
+	struct rb_root order;
 /*
  * Callback function which will check whether the given change for variable
  * "__item" to "newval" may be applied or not, and possibly apply such change.
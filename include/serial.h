@@ -181,6 +181,18 @@ struct serial_dev_priv {
 /* Access the serial operations for a device */
 #define serial_get_ops(dev)	((struct dm_serial_ops *)(dev)->driver->ops)
 
+/**
+ * serial_baud_error() - Get how far the console would be off a baud rate
+ *
+ * The UART clock divider can't produce every rate exactly. Drivers which
+ * know their divider can implement this, the default is 0.
+ *
+ * @baud:	Requested baud rate
+ * @return difference between the real and the requested rate, in 1/1000
+ * of the requested rate
+ */
+int serial_baud_error(int baud);
+
 void atmel_serial_initialize(void);
 void mcf_serial_initialize(void);
 void mpc85xx_serial_initialize(void);
@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Streaming file transfer over the serial console
+ *
+ * Unlike X/Ymodem, the sender does not wait for an acknowledgement of each
+ * block. It streams data frames back to back, and the receiver only talks
+ * back when a frame is lost or damaged, giving the offset to resume from.
+ * The link may also be switched to a higher baud rate for the transfer.
+ *
+ * All frames have the same layout, multi-byte fields are big-endian:
+ *
+ *	u8	sync[2]		SERIAL_STREAM_SYNC0, SERIAL_STREAM_SYNC1
+ *	u8	type		SERIAL_STREAM_*
+ *	u8	flags		0
+ *	__be32	arg		Depends on the type, see below
+ *	__be16	len		Payload length, up to SERIAL_STREAM_MAX_DATA
+ *	u8	payload[len]
+ *	__be32	crc		CRC32 of type to the end of the payload
+ *
+ * The replies of the target never have a payload. As the console adds a
+ * '\r' in front of each '\n', they are sent as text instead: a '#', the 12
+ * bytes from type to crc as upper-case hex digits, and "\r\n".
+ *
+ * A transfer goes like this (host -> target unless noted):
+ *
+ *	HELLO (arg: highest baud rate of the host), repeated until answered
+ *	<- ACK (arg: baud rate to use), both sides switch to it
+ *	SYNC, repeated until answered at the new rate, otherwise both sides
+ *	      go back to the console rate and the host sends a HELLO with a
+ *	      lower limit
+ *	<- ACK (arg: baud rate)
+ *	START (arg: file size)
+ *	<- ACK (arg: 0) or ERR (arg: largest file size accepted)
+ *	DATA (arg: offset of the payload in the file), ...
+ *	<- NAK (arg: offset to resume from) on any error, at any time
+ *	END (arg: file size, payload: __be32 CRC32 of the whole file)
+ *	<- ACK (arg: file size), or NAK if data is still missing
+ *
+ * The host can send ABORT at any time. The target goes back to the console
+ * rate at the end of the transfer. tools/serial_stream.py is the host side.
+ */
+
+#ifndef __SERIAL_STREAM_H
+#define __SERIAL_STREAM_H
+
+#define SERIAL_STREAM_SYNC0		0xa5
+#define SERIAL_STREAM_SYNC1		0x5a
+#define SERIAL_STREAM_MAX_DATA		1024
+#define SERIAL_STREAM_REPLY		'#'
+
+/* Frame types */
+#define SERIAL_STREAM_HELLO		0x01
+#define SERIAL_STREAM_SYNC		0x02
+#define SERIAL_STREAM_START		0x03
+#define SERIAL_STREAM_DATA		0x04
+#define SERIAL_STREAM_END		0x05
+#define SERIAL_STREAM_ABORT		0x06
+#define SERIAL_STREAM_ACK		0x80
+#define SERIAL_STREAM_NAK		0x81
+#define SERIAL_STREAM_ERR		0x82
+
+/**
+ * serial_stream_receive() - Receive a file over the serial console
+ *
+ * @buf:	Where to store the file
+ * @max:	Size of @buf
+ * @size:	Returns the size of the file
+ * @wait_ms:	How long to wait for the host to start, 0 to wait until
+ *		Ctrl-C is pressed
+ * @return 0 if OK, -ETIMEDOUT if the host did not show up within @wait_ms
+ * or stopped sending, -ECANCELED if aborted, -ENOSPC if the file is larger
+ * than @max, other -ve value on error
+ */
+int serial_stream_receive(void *buf, size_t max, size_t *size, ulong wait_ms);
+
+#endif /* __SERIAL_STREAM_H */
@@ -0,0 +1,11 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#ifndef __TEST_HASH_H__
+#define __TEST_HASH_H__
+
+#include <test/test.h>
+
+/* Declare a new hash test */
+#define HASH_TEST(_name, _flags)	UNIT_TEST(_name, _flags, hash_test)
+
+#endif /* __TEST_HASH_H__ */
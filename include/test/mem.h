@@ -0,0 +1,11 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#ifndef __TEST_MEM_H__
+#define __TEST_MEM_H__
+
+#include <test/test.h>
+
+/* Declare a new memcpy/memmove/memset test */
+#define MEM_TEST(_name, _flags)	UNIT_TEST(_name, _flags, mem_test)
+
+#endif /* __TEST_MEM_H__ */
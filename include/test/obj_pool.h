@@ -0,0 +1,11 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#ifndef __TEST_OBJ_POOL_H__
+#define __TEST_OBJ_POOL_H__
+
+#include <test/test.h>
+
+/* Declare a new object pool test */
+#define OBJ_POOL_TEST(_name, _flags)	UNIT_TEST(_name, _flags, obj_pool_test)
+
+#endif /* __TEST_OBJ_POOL_H__ */
@@ -0,0 +1,11 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#ifndef __TEST_SCRATCH_H__
+#define __TEST_SCRATCH_H__
+
+#include <test/test.h>
+
+/* Declare a new scratch region test */
+#define SCRATCH_TEST(_name, _flags)	UNIT_TEST(_name, _flags, scratch_test)
+
+#endif /* __TEST_SCRATCH_H__ */
@@ -17,6 +17,15 @@ struct MD5Context {
 	};
 };
 
+/*
+ * Progressive interface: MD5Init() resets 'ctx', MD5Update() may then be
+ * called any number of times and MD5Final() stores the 16-byte digest.
+ */
+void MD5Init(struct MD5Context *ctx);
+void MD5Update(struct MD5Context *ctx, unsigned char const *buf,
+	       unsigned len);
+void MD5Final(unsigned char digest[16], struct MD5Context *ctx);
+
 /*
  * Calculate and store in 'output' the MD5 digest of 'len' bytes at
  * 'input'. 'output' must have enough space to hold 16 bytes.
@@ -28,7 +37,7 @@ void md5 (unsigned char *input, int len, unsigned char output[16]);
  * 'output' must have enough space to hold 16 bytes. If 'chunk' Trigger the
  * watchdog every 'chunk_sz' bytes of input processed.
  */
-void md5_wd (unsigned char *input, int len, unsigned char output[16],
-		unsigned int chunk_sz);
+void md5_wd (const unsigned char *input, unsigned int len,
+		unsigned char output[16], unsigned int chunk_sz);
 
 #endif /* _MD5_H */
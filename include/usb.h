@@ -231,6 +231,22 @@ int board_usb_cleanup(int index, enum usb_init_type init);
 int usb_stor_scan(int mode);
 int usb_stor_info(void);
 
+/**
+ * usb_stor_load_file() - Load a file from any USB storage device
+ *
+ * USB is started if needed, and the partitions of all USB storage devices
+ * are searched for the file in turn.
+ *
+ * @name:	Path of the file
+ * @addr:	Where to load the file
+ * @max:	Largest file size allowed
+ * @size:	Returns the size of the file
+ * @return 0 if OK, -ENODEV if there is no USB storage device, -ENOENT if
+ * the file was not found, -EFBIG if it is larger than @max, -EIO on read
+ * error
+ */
+int usb_stor_load_file(const char *name, ulong addr, loff_t max, loff_t *size);
+
 #endif
 
 #ifdef CONFIG_USB_HOST_ETHER
@@ -79,6 +79,17 @@ int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp)
 	return zunzip(dst, dstlen, src, lenp, 1, offset);
 }
 
+int gunzip_cb(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
+	      decomp_input_fn input, void *priv)
+{
+	int offset = gzip_parse_header(src, *lenp);
+
+	if (offset < 0)
+		return offset;
+
+	return zunzip_cb(dst, dstlen, src, lenp, 1, offset, input, priv);
+}
+
 #ifdef CONFIG_CMD_UNZIP
 __weak
 void gzwrite_progress_init(u64 expectedsize)
@@ -305,3 +316,63 @@ int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
 
 	return err;
 }
+
+/*
+ * Same as zunzip(), but the input is fed to inflate() in chunks of
+ * DECOMP_INPUT_CHUNK bytes and passed to @input, if not NULL, once it has
+ * been consumed, while it is still in the cache.
+ */
+int zunzip_cb(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
+	      int stoponerr, int offset, decomp_input_fn input, void *priv)
+{
+	unsigned long left = *lenp - offset;
+	unsigned char *in;
+	z_stream s;
+	int err = 0;
+	int r;
+
+	s.zalloc = gzalloc;
+	s.zfree = gzfree;
+
+	r = inflateInit2(&s, -MAX_WBITS);
+	if (r != Z_OK) {
+		printf("Error: inflateInit2() returned %d\n", r);
+		return -1;
+	}
+
+	if (input)
+		input(priv, src, offset);
+
+	s.next_in = src + offset;
+	s.avail_in = 0;
+	s.next_out = dst;
+	s.avail_out = dstlen;
+	do {
+		if (!s.avail_in) {
+			s.avail_in = min(left, (unsigned long)DECOMP_INPUT_CHUNK);
+			left -= s.avail_in;
+		}
+
+		in = s.next_in;
+		r = inflate(&s, left ? Z_NO_FLUSH : Z_FINISH);
+		if (input)
+			input(priv, in, s.next_in - in);
+
+		if (r == Z_STREAM_END)
+			break;
+
+		if (r != Z_OK && r != Z_BUF_ERROR)
+			break;
+	} while (s.avail_out && (s.next_in != in || !s.avail_in) &&
+		 (s.avail_in || left));
+
+	if (stoponerr == 1 && r != Z_STREAM_END) {
+		printf("Error: inflate() returned %d\n", r);
+		err = -1;
+	}
+
+	*lenp = s.next_out - (unsigned char *) dst;
+	inflateEnd(&s);
+
+	return err;
+}
@@ -45,6 +45,10 @@
 #include <search.h>
 #include <slre.h>
 
+#if defined(CONFIG_HASHTABLE_ORDERED_INDEX) && !defined(CONFIG_SPL_BUILD)
+#define HTAB_ORDERED_INDEX
+#endif
+
 /*
  * [Aho,Sethi,Ullman] Compilers: Principles, Techniques and Tools, 1986
  * [Knuth]	      The Art of Computer Programming, part 3 (6.4)
@@ -59,12 +63,87 @@
 typedef struct _ENTRY {
 	int used;
 	ENTRY entry;
+#ifdef HTAB_ORDERED_INDEX
+	struct rb_node node;
+#endif
 } _ENTRY;
 
 
 static void _hdelete(const char *key, struct hsearch_data *htab, ENTRY *ep,
 	int idx);
 
+/*
+ * Ordered index
+ */
+
+/*
+ * Used entries are additionally linked into a red-black tree sorted by key,
+ * so that hexport() can output them in order without sorting. The table
+ * itself is never reallocated while in use, so the tree nodes can live in
+ * the table slots.
+ */
+#ifdef HTAB_ORDERED_INDEX
+static void _hindex_insert(struct hsearch_data *htab, _ENTRY *ep)
+{
+	struct rb_node **link = &htab->order.rb_node, *parent = NULL;
+	struct rb_node *last = rb_last(&htab->order);
+	_ENTRY *cur;
+
+	/* Saved environments are sorted, so appending is the common case */
+	if (last && strcmp(ep->entry.key,
+			   rb_entry(last, _ENTRY, node)->entry.key) > 0) {
+		parent = last;
+		link = &last->rb_right;
+	}
+
+	while (*link) {
+		parent = *link;
+		cur = rb_entry(parent, _ENTRY, node);
+
+		if (strcmp(ep->entry.key, cur->entry.key) < 0)
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
+	}
+
+	rb_link_node(&ep->node, parent, link);
+	rb_insert_color(&ep->node, &htab->order);
+}
+
+static void _hindex_remove(struct hsearch_data *htab, _ENTRY *ep)
+{
+	rb_erase(&ep->node, &htab->order);
+}
+#else
+static inline void _hindex_insert(struct hsearch_data *htab, _ENTRY *ep) {}
+static inline void _hindex_remove(struct hsearch_data *htab, _ENTRY *ep) {}
+#endif
+
+/*
+ * Return the used entry following "prev" (or the first one if "prev" is
+ * NULL). With the ordered index the entries are returned sorted by key,
+ * otherwise in table order.
+ */
+static __maybe_unused _ENTRY *_hnext(struct hsearch_data *htab, _ENTRY *prev)
+{
+#ifdef HTAB_ORDERED_INDEX
+	struct rb_node *node;
+
+	node = prev ? rb_next(&prev->node) : rb_first(&htab->order);
+
+	return node ? rb_entry(node, _ENTRY, node) : NULL;
+#else
+	unsigned int idx = prev ? prev - htab->table + 1 : 1;
+
+	for (; idx <= htab->size; ++idx) {
+		if (htab->table[idx].used > 0)
+			return &htab->table[idx];
+	}
+
+	return NULL;
+#endif
+}
+
 /*
  * hcreate()
  */
@@ -115,6 +194,7 @@ int hcreate_r(size_t nel, struct hsearch_data *htab)
 
 	htab->size = nel;
 	htab->filled = 0;
+	htab->order = RB_ROOT;
 
 	/* allocate memory and zero out */
 	htab->table = (_ENTRY *) calloc(htab->size + 1, sizeof(_ENTRY));
@@ -158,6 +238,7 @@ void hdestroy_r(struct hsearch_data *htab)
 
 	/* the sign for an existing table is an value != NULL in htable */
 	htab->table = NULL;
+	htab->order = RB_ROOT;
 }
 
 /*
@@ -375,6 +456,8 @@ int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 
 		++htab->filled;
 
+		_hindex_insert(htab, &htab->table[idx]);
+
 		/* This is a new entry, so look up a possible callback */
 		env_callback_init(&htab->table[idx].entry);
 		/* Also look for flags */
@@ -429,6 +512,7 @@ static void _hdelete(const char *key, struct hsearch_data *htab, ENTRY *ep,
 {
 	/* free used ENTRY */
 	debug("hdelete: DELETING key \"%s\"\n", key);
+	_hindex_remove(htab, &htab->table[idx]);
 	free((void *)ep->key);
 	free(ep->data);
 	ep->callback = NULL;
@@ -519,6 +603,7 @@ int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
  *		bytes in the string will be '\0'-padded.
  */
 
+#ifndef HTAB_ORDERED_INDEX
 static int cmpkey(const void *p1, const void *p2)
 {
 	ENTRY *e1 = *(ENTRY **) p1;
@@ -526,6 +611,7 @@ static int cmpkey(const void *p1, const void *p2)
 
 	return (strcmp(e1->key, e2->key));
 }
+#endif
 
 static int match_string(int flag, const char *str, const char *pat, void *priv)
 {
@@ -591,6 +677,7 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 		 int argc, char * const argv[])
 {
 	ENTRY *list[htab->size];
+	_ENTRY *e;
 	char *res, *p;
 	size_t totlen;
 	int i, n;
@@ -608,37 +695,36 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 	 * search used entries,
 	 * save addresses and compute total length
 	 */
-	for (i = 1, n = 0, totlen = 0; i <= htab->size; ++i) {
-
-		if (htab->table[i].used > 0) {
-			ENTRY *ep = &htab->table[i].entry;
-			int found = match_entry(ep, flag, argc, argv);
+	n = 0;
+	totlen = 0;
+	for (e = _hnext(htab, NULL); e; e = _hnext(htab, e)) {
+		ENTRY *ep = &e->entry;
+		int found = match_entry(ep, flag, argc, argv);
 
-			if ((argc > 0) && (found == 0))
-				continue;
+		if ((argc > 0) && (found == 0))
+			continue;
 
-			if ((flag & H_HIDE_DOT) && ep->key[0] == '.')
-				continue;
+		if ((flag & H_HIDE_DOT) && ep->key[0] == '.')
+			continue;
 
-			list[n++] = ep;
+		list[n++] = ep;
 
-			totlen += strlen(ep->key);
+		totlen += strlen(ep->key);
 
-			if (sep == '\0') {
-				totlen += strlen(ep->data);
-			} else {	/* check if escapes are needed */
-				char *s = ep->data;
+		if (sep == '\0') {
+			totlen += strlen(ep->data);
+		} else {	/* check if escapes are needed */
+			char *s = ep->data;
 
-				while (*s) {
+			while (*s) {
+				++totlen;
+				/* add room for needed escape chars */
+				if ((*s == sep) || (*s == '\\'))
 					++totlen;
-					/* add room for needed escape chars */
-					if ((*s == sep) || (*s == '\\'))
-						++totlen;
-					++s;
-				}
+				++s;
 			}
-			totlen += 2;	/* for '=' and 'sep' char */
 		}
+		totlen += 2;	/* for '=' and 'sep' char */
 	}
 
 #ifdef DEBUG
@@ -650,8 +736,10 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 	}
 #endif
 
+#ifndef HTAB_ORDERED_INDEX
 	/* Sort list by keys */
 	qsort(list, n, sizeof(ENTRY *), cmpkey);
+#endif
 
 	/* Check if the user supplied buffer size is sufficient */
 	if (size) {
@@ -662,7 +750,7 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 			return (-1);
 		}
 	} else {
-		size = totlen;
+		size = totlen + 1;
 	}
 
 	/* Check if the user provided a buffer */
@@ -738,6 +826,26 @@ static int drop_var_from_set(const char *name, int nvars, char * vars[])
 	return res;
 }
 
+/*
+ * Count the "name=value" entries in linearized data. Escaped separators
+ * are counted as well, which is fine for sizing the hash table.
+ */
+static unsigned int himport_count(const char *env, size_t size, const char sep)
+{
+	const char *p = env, *end = env + size;
+	unsigned int n = 0;
+
+	while (p < end && *p) {
+		while (p < end && *p && *p != sep)
+			++p;
+		++n;
+		if (p < end && *p == sep)
+			++p;
+	}
+
+	return n;
+}
+
 /*
  * Import linearized data into hash table.
  *
@@ -828,14 +936,23 @@ int himport_r(struct hsearch_data *htab,
 	 * On the other hand we need to add some more entries for free
 	 * space when importing very small buffers. Both boundaries can
 	 * be overwritten in the board config file if needed.
+	 *
+	 * The table is never smaller than twice the number of entries
+	 * actually being imported, so that large environments neither
+	 * overflow the table nor end up with long probe sequences.
 	 */
 
 	if (!htab->table) {
 		int nent = CONFIG_ENV_MIN_ENTRIES + size / 8;
+		unsigned int count;
 
 		if (nent > CONFIG_ENV_MAX_ENTRIES)
 			nent = CONFIG_ENV_MAX_ENTRIES;
 
+		count = himport_count(env, size, sep);
+		if (nent < 2 * count)
+			nent = 2 * count;
+
 		debug("Create Hash Table: N=%d\n", nent);
 
 		if (hcreate_r(nent, htab) == 0) {
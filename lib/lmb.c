@@ -321,6 +321,43 @@ phys_addr_t __lmb_alloc_base(struct lmb *lmb, phys_size_t size, ulong align, phy
 	return 0;
 }
 
+/* Find the largest area which isn't reserved, return its size and base */
+phys_size_t lmb_largest_free(struct lmb *lmb, phys_addr_t *base)
+{
+	phys_addr_t start, end, rstart, rend;
+	phys_size_t largest = 0;
+	long i, j;
+
+	for (i = 0; i < lmb->memory.cnt; i++) {
+		start = lmb->memory.region[i].base;
+		end = start + lmb->memory.region[i].size;
+
+		/* Reserved regions are sorted, the end closes the last gap */
+		for (j = 0; j <= lmb->reserved.cnt && start < end; j++) {
+			if (j < lmb->reserved.cnt) {
+				rstart = lmb->reserved.region[j].base;
+				rend = rstart + lmb->reserved.region[j].size;
+			} else {
+				rstart = end;
+				rend = end;
+			}
+
+			if (rend <= start)
+				continue;
+
+			rstart = min(rstart, end);
+			if (rstart > start && rstart - start > largest) {
+				largest = rstart - start;
+				*base = start;
+			}
+
+			start = max(start, rend);
+		}
+	}
+
+	return largest;
+}
+
 int lmb_is_reserved(struct lmb *lmb, phys_addr_t addr)
 {
 	int i;
@@ -62,10 +62,17 @@ struct lz4_block_header {
 	/* + u32 block_checksum iff has_block_checksum is set */
 } __packed;
 
-int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
+/*
+ * Blocks are at most 4MiB, so unlike the other *_cb() decompressors the
+ * input is passed to @input one whole block at a time. Images compressed
+ * with the default 64KiB blocks are still hashed from the cache.
+ */
+int ulz4fn_cb(const void *src, size_t srcn, void *dst, size_t *dstn,
+	      decomp_input_fn input, void *priv)
 {
 	const void *end = dst + *dstn;
 	const void *in = src;
+	const void *block;
 	void *out = dst;
 	int has_block_checksum;
 	int ret;
@@ -92,9 +99,13 @@ int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 		in += sizeof(u8);
 	}
 
+	if (input)
+		input(priv, src, in - src);
+
 	while (1) {
 		struct lz4_block_header b;
 
+		block = in;
 		b.raw = le32_to_cpu(*(u32 *)in);
 		in += sizeof(struct lz4_block_header);
 
@@ -104,6 +115,8 @@ int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 		}
 
 		if (!b.size) {
+			if (input)
+				input(priv, block, in - block);
 			ret = 0;	/* decompression successful */
 			break;
 		}
@@ -131,8 +144,16 @@ int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 		in += b.size;
 		if (has_block_checksum)
 			in += sizeof(u32);
+
+		if (input)
+			input(priv, block, in - block);
 	}
 
 	*dstn = out - dst;
 	return ret;
 }
+
+int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
+{
+	return ulz4fn_cb(src, srcn, dst, dstn, NULL, NULL);
+}
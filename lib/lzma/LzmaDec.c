@@ -27,7 +27,26 @@
   { UPDATE_1(p); i = (i + i) + 1; A1; }
 #define GET_BIT(p, i) GET_BIT2(p, i, ; , ;)
 
-#define TREE_GET_BIT(probs, i) { GET_BIT((probs + i), i); }
+/*
+ * Branch-free GET_BIT() for the literal and bit-tree coders, whose bits are
+ * the hardest to predict. The decoded bit is turned into a mask (all ones
+ * for 1) which selects the new range, code and probability. The update of
+ * the probability is the same as UPDATE_0/UPDATE_1: for a 0 bit,
+ * ttt - ((ttt + 31 - kBitModelTotal) >> kNumMoveBits) equals
+ * ttt + ((kBitModelTotal - ttt) >> kNumMoveBits).
+ */
+#define kBitModelOffset ((1 << kNumMoveBits) - 1)
+
+#define GET_BIT_MASK(p, i, m) \
+  { ttt = *(p); NORMALIZE; bound = (range >> kNumBitModelTotalBits) * ttt; \
+  m = (UInt32)0 - (UInt32)(code >= bound); \
+  range = ((range - bound) & m) | (bound & ~m); \
+  code -= bound & m; \
+  *(p) = (CLzmaProb)(ttt - ((int)(ttt + (~m & (kBitModelOffset - kBitModelTotal))) >> kNumMoveBits)); \
+  i = (i + i) + (m & 1); }
+#define GET_BIT_NB(p, i) { UInt32 mask; GET_BIT_MASK(p, i, mask); }
+
+#define TREE_GET_BIT(probs, i) { GET_BIT_NB((probs + i), i); }
 #define TREE_DECODE(probs, limit, i) \
   { i = 1; do { TREE_GET_BIT(probs, i); } while (i < limit); i -= limit; }
 
@@ -107,9 +126,6 @@
 #define RepLenCoder (LenCoder + kNumLenProbs)
 #define Literal (RepLenCoder + kNumLenProbs)
 
-#define LZMA_BASE_SIZE 1846
-#define LZMA_LIT_SIZE 768
-
 #define LzmaProps_GetNumProbs(p) ((UInt32)LZMA_BASE_SIZE + (LZMA_LIT_SIZE << ((p)->lc + (p)->lp)))
 
 #if Literal != LZMA_BASE_SIZE
@@ -118,6 +134,9 @@ StopCompilingDueBUG
 
 #define LZMA_DIC_MIN (1 << 12)
 
+/* Output decoded between two watchdog resets */
+#define LZMA_DEC_WATCHDOG_CHUNK (1 << 16)
+
 /* First LZMA-symbol is always decoded.
 And it decodes new LZMA-symbols while (buf < bufLimit), but "buf" is without last normalization
 Out:
@@ -176,10 +195,7 @@ static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte
       {
         state -= (state < 4) ? state : 3;
         symbol = 1;
-
-        WATCHDOG_RESET();
-
-        do { GET_BIT(prob + symbol, symbol) } while (symbol < 0x100);
+        do { GET_BIT_NB(prob + symbol, symbol) } while (symbol < 0x100);
       }
       else
       {
@@ -187,17 +203,17 @@ static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte
         unsigned offs = 0x100;
         state -= (state < 10) ? 3 : 6;
         symbol = 1;
-
-        WATCHDOG_RESET();
-
         do
         {
           unsigned bit;
+          UInt32 mask;
           CLzmaProb *probLit;
           matchByte <<= 1;
           bit = (matchByte & offs);
           probLit = prob + offs + bit + symbol;
-          GET_BIT2(probLit, symbol, offs &= ~bit, offs &= bit)
+          GET_BIT_MASK(probLit, symbol, mask);
+          /* offs &= bit for a 1 bit, offs &= ~bit for a 0 bit */
+          offs &= bit ^ ~mask;
         }
         while (symbol < 0x100);
       }
@@ -320,9 +336,6 @@ static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte
             {
               UInt32 mask = 1;
               unsigned i = 1;
-
-              WATCHDOG_RESET();
-
               do
               {
                 GET_BIT2(prob + i, i, ; , distance |= mask);
@@ -334,9 +347,6 @@ static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte
           else
           {
             numDirectBits -= kNumAlignBits;
-
-            WATCHDOG_RESET();
-
             do
             {
               NORMALIZE
@@ -408,18 +418,12 @@ static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte
           ptrdiff_t src = (ptrdiff_t)pos - (ptrdiff_t)dicPos;
           const Byte *lim = dest + curLen;
           dicPos += curLen;
-
-          WATCHDOG_RESET();
-
           do
             *(dest) = (Byte)*(dest + src);
           while (++dest != lim);
         }
         else
         {
-
-          WATCHDOG_RESET();
-
           do
           {
             dic[dicPos++] = dic[pos];
@@ -433,8 +437,6 @@ static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte
   }
   while (dicPos < limit && buf < bufLimit);
 
-  WATCHDOG_RESET();
-
   NORMALIZE;
   p->buf = buf;
   p->range = range;
@@ -488,6 +490,9 @@ static int MY_FAST_CALL LzmaDec_DecodeReal2(CLzmaDec *p, SizeT limit, const Byte
       if (limit - p->dicPos > rem)
         limit2 = p->dicPos + rem;
     }
+    /* Keep the watchdog out of the inner loops of LzmaDec_DecodeReal() */
+    if (limit2 - p->dicPos > LZMA_DEC_WATCHDOG_CHUNK)
+      limit2 = p->dicPos + LZMA_DEC_WATCHDOG_CHUNK;
     RINOK(LzmaDec_DecodeReal(p, limit2, bufLimit));
     if (p->processedPos >= p->prop.dicSize)
       p->checkDicSize = p->prop.dicSize;
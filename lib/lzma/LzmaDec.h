@@ -16,6 +16,11 @@
 #define CLzmaProb UInt16
 #endif
 
+/* CLzmaDec::probs has LZMA_BASE_SIZE + (LZMA_LIT_SIZE << (lc + lp)) entries,
+   the literal coder starting at LZMA_BASE_SIZE */
+#define LZMA_BASE_SIZE 1846
+#define LZMA_LIT_SIZE 768
+
 
 /* ---------- LZMA Properties ---------- */
 
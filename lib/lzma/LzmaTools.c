@@ -25,16 +25,51 @@
 
 #define LZMA_PROPERTIES_OFFSET 0
 #define LZMA_SIZE_OFFSET       LZMA_PROPS_SIZE
-#define LZMA_DATA_OFFSET       LZMA_SIZE_OFFSET+sizeof(uint64_t)
+#define LZMA_DATA_OFFSET       (LZMA_SIZE_OFFSET + sizeof(uint64_t))
 
 #include "LzmaTools.h"
 #include "LzmaDec.h"
 
 #include <linux/string.h>
 #include <malloc.h>
+#include <asm/cache.h>
 
+#if defined(CONFIG_LZMA_STATIC_WORKSPACE) && !defined(CONFIG_SPL_BUILD)
+/*
+ * Probability model of the decoder, large enough for lc + lp <= 3 (the
+ * default of the lzma tool). It is offset so that the literal coder, which
+ * takes most of it and is used for every literal, starts on a cache line.
+ */
+#define LZMA_WORKSPACE_PAD \
+    ((ARCH_DMA_MINALIGN - (LZMA_BASE_SIZE * sizeof(CLzmaProb)) % \
+      ARCH_DMA_MINALIGN) % ARCH_DMA_MINALIGN)
+#define LZMA_WORKSPACE_SIZE \
+    ((LZMA_BASE_SIZE + (LZMA_LIT_SIZE << 3)) * sizeof(CLzmaProb))
+
+static u8 lzma_workspace[LZMA_WORKSPACE_PAD + LZMA_WORKSPACE_SIZE]
+    __aligned(ARCH_DMA_MINALIGN);
+static bool lzma_workspace_used;
+
+static void *SzAlloc(void *p, size_t size)
+{
+    if (lzma_workspace_used || size > LZMA_WORKSPACE_SIZE)
+        return malloc(size);
+
+    lzma_workspace_used = true;
+    return lzma_workspace + LZMA_WORKSPACE_PAD;
+}
+
+static void SzFree(void *p, void *address)
+{
+    if (address == lzma_workspace + LZMA_WORKSPACE_PAD)
+        lzma_workspace_used = false;
+    else
+        free(address);
+}
+#else
 static void *SzAlloc(void *p, size_t size) { return malloc(size); }
 static void SzFree(void *p, void *address) { free(address); }
+#endif
 
 int lzmaBuffToBuffDecompress (unsigned char *outStream, SizeT *uncompressedSize,
                   unsigned char *inStream,  SizeT  length)
@@ -120,4 +155,92 @@ int lzmaBuffToBuffDecompress (unsigned char *outStream, SizeT *uncompressedSize,
     return res;
 }
 
+/*
+ * Same as lzmaBuffToBuffDecompress(), but the input is fed to the decoder in
+ * chunks of DECOMP_INPUT_CHUNK bytes and passed to @input, if not NULL, once
+ * it has been consumed, while it is still in the cache.
+ */
+int lzmaBuffToBuffDecompressCb(unsigned char *outStream,
+                               SizeT *uncompressedSize,
+                               unsigned char *inStream, SizeT length,
+                               decomp_input_fn input, void *priv)
+{
+    int res;
+    int i;
+    ISzAlloc g_Alloc;
+    CLzmaDec dec;
+    ELzmaStatus state;
+    SizeT outSize = 0;
+    SizeT outSizeHigh = 0;
+    SizeT inLeft, inUsed;
+    unsigned char *in;
+
+    if (length <= LZMA_DATA_OFFSET)
+        return SZ_ERROR_INPUT_EOF;
+
+    /* Read the uncompressed size */
+    for (i = 0; i < 8; i++) {
+        unsigned char b = inStream[LZMA_SIZE_OFFSET + i];
+
+        if (i < 4)
+            outSize |= (UInt32)(b) << (i * 8);
+        else
+            outSizeHigh |= (UInt32)(b) << ((i - 4) * 8);
+    }
+
+    if (sizeof(SizeT) >= 8) {
+        outSize |= ((outSizeHigh << 16) << 16);
+    } else if (outSizeHigh != 0) {
+        /* An all 0xff size means "unknown size" */
+        if (outSizeHigh != (SizeT)-1 || outSize != (SizeT)-1) {
+            debug ("LZMA: 64bit support not enabled.\n");
+            return SZ_ERROR_DATA;
+        }
+    }
+
+    if (outSize != (SizeT)-1 && *uncompressedSize < outSize)
+        return SZ_ERROR_OUTPUT_EOF;
+
+    g_Alloc.Alloc = SzAlloc;
+    g_Alloc.Free = SzFree;
+
+    LzmaDec_Construct(&dec);
+    res = LzmaDec_AllocateProbs(&dec, inStream, LZMA_PROPS_SIZE, &g_Alloc);
+    if (res != SZ_OK)
+        return res;
+
+    dec.dic = outStream;
+    dec.dicBufSize = min(outSize, *uncompressedSize);
+    LzmaDec_Init(&dec);
+
+    if (input)
+        input(priv, inStream, LZMA_DATA_OFFSET);
+
+    in = inStream + LZMA_DATA_OFFSET;
+    inLeft = length - LZMA_DATA_OFFSET;
+
+    do {
+        WATCHDOG_RESET();
+
+        inUsed = min(inLeft, (SizeT)DECOMP_INPUT_CHUNK);
+        res = LzmaDec_DecodeToDic(&dec, dec.dicBufSize, in, &inUsed,
+                                  LZMA_FINISH_END, &state);
+        if (input)
+            input(priv, in, inUsed);
+
+        in += inUsed;
+        inLeft -= inUsed;
+    } while (res == SZ_OK && state == LZMA_STATUS_NEEDS_MORE_INPUT && inLeft);
+
+    if (res == SZ_OK && state == LZMA_STATUS_NEEDS_MORE_INPUT)
+        res = SZ_ERROR_INPUT_EOF;
+
+    *uncompressedSize = dec.dicPos;
+    LzmaDec_FreeProbs(&dec, &g_Alloc);
+
+    debug("LZMA: Uncompressed ............... 0x%zx\n", dec.dicPos);
+
+    return res;
+}
+
 #endif
@@ -15,4 +15,8 @@
 
 extern int lzmaBuffToBuffDecompress (unsigned char *outStream, SizeT *uncompressedSize,
 			      unsigned char *inStream,  SizeT  length);
+extern int lzmaBuffToBuffDecompressCb(unsigned char *outStream,
+				      SizeT *uncompressedSize,
+				      unsigned char *inStream, SizeT length,
+				      decomp_input_fn input, void *priv);
 #endif
@@ -0,0 +1,297 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Multi-block compressed payload, see include/mblock.h
+ *
+ * The header check is shared with mkimage, which builds such payloads.
+ */
+
+#ifdef USE_HOSTCC
+#include "mkimage.h"
+#else
+#include <common.h>
+#include <malloc.h>
+#include <asm/cache.h>
+#include <parallel.h>
+#include <lzma/LzmaTypes.h>
+#include <lzma/LzmaDec.h>
+#endif
+#include <image.h>
+#include <mblock.h>
+
+int mblock_check(const void *buf, size_t size)
+{
+	const struct mblock_header *hdr = buf;
+	const struct mblock_entry *ent = (const void *)(hdr + 1);
+	uint32_t i, count, block_size, offset, len;
+	uint64_t total;
+	size_t data_start;
+
+	if (size < sizeof(*hdr) || be32_to_cpu(hdr->magic) != MBLOCK_MAGIC)
+		return -EINVAL;
+
+	if (hdr->comp != IH_COMP_LZ4 && hdr->comp != IH_COMP_LZMA)
+		return -EINVAL;
+
+	count = be32_to_cpu(hdr->count);
+	block_size = be32_to_cpu(hdr->block_size);
+	total = be32_to_cpu(hdr->size);
+
+	if (!count || count > MBLOCK_MAX_BLOCKS || !block_size)
+		return -EINVAL;
+
+	/* Only the last block may be short */
+	if (total <= (uint64_t)(count - 1) * block_size ||
+	    total > (uint64_t)count * block_size)
+		return -EINVAL;
+
+	data_start = sizeof(*hdr) + count * sizeof(*ent);
+	if (size < data_start)
+		return -EINVAL;
+
+	for (i = 0; i < count; i++) {
+		offset = be32_to_cpu(ent[i].offset);
+		len = be32_to_cpu(ent[i].size);
+
+		if (offset < data_start || offset % MBLOCK_ALIGN || !len ||
+		    offset > size || len > size - offset)
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
+#ifndef USE_HOSTCC
+
+#define MBLOCK_LZMA_HDR_SIZE	(LZMA_PROPS_SIZE + sizeof(uint64_t))
+
+/* Result of one block, on its own cache line as workers write it back */
+struct mblock_status {
+	int err;
+} __aligned(ARCH_DMA_MINALIGN);
+
+/* Hands out the probability model preallocated for one worker */
+struct mblock_alloc {
+	ISzAlloc alloc;
+	void *buf;
+	size_t size;
+};
+
+struct mblock_job {
+	const struct mblock_header *hdr;
+	const struct mblock_entry *ent;
+	u8 *dst;
+	uint count;
+	size_t block_size;
+	size_t size;
+
+	/* LZMA only: one probability model per worker */
+	void *probs;
+	size_t probs_size;
+	uint nprobs;
+
+	/* Result of each block */
+	struct mblock_status *status;
+};
+
+static void *mblock_lzma_alloc(void *p, size_t size)
+{
+	struct mblock_alloc *a = p;
+
+	return size <= a->size ? a->buf : NULL;
+}
+
+static void mblock_lzma_free(void *p, void *address)
+{
+}
+
+static int mblock_lzma_block(struct mblock_job *job, uint worker,
+			     const u8 *in, size_t inn, u8 *out, size_t outn)
+{
+	struct mblock_alloc a = {
+		.alloc = {
+			.Alloc = mblock_lzma_alloc,
+			.Free = mblock_lzma_free,
+		},
+		.buf = job->probs + worker * job->probs_size,
+		.size = job->probs_size,
+	};
+	ELzmaStatus status;
+	SizeT destlen = outn, srclen;
+	int ret;
+
+	if (inn < MBLOCK_LZMA_HDR_SIZE || worker >= job->nprobs)
+		return -EINVAL;
+
+	srclen = inn - MBLOCK_LZMA_HDR_SIZE;
+	ret = LzmaDecode(out, &destlen, in + MBLOCK_LZMA_HDR_SIZE, &srclen,
+			 in, LZMA_PROPS_SIZE, LZMA_FINISH_END, &status,
+			 &a.alloc);
+	if (ret != SZ_OK)
+		return -EIO;
+
+	return destlen == outn ? 0 : -EIO;
+}
+
+static int mblock_lz4_block(const u8 *in, size_t inn, u8 *out, size_t outn)
+{
+	size_t len = outn;
+	int ret;
+
+	ret = ulz4fn(in, inn, out, &len);
+	if (ret)
+		return ret;
+
+	return len == outn ? 0 : -EIO;
+}
+
+/* Blocks are shared out statically, as all but the last have the same size */
+static void mblock_worker(void *arg, uint worker, uint nworkers)
+{
+	struct mblock_job *job = arg;
+	const u8 *in;
+	size_t inn, outn;
+	u8 *out;
+	int err = -EPROTONOSUPPORT;
+	uint i;
+
+	for (i = worker; i < job->count; i += nworkers) {
+		in = (const u8 *)job->hdr + be32_to_cpu(job->ent[i].offset);
+		inn = be32_to_cpu(job->ent[i].size);
+		out = job->dst + i * job->block_size;
+		outn = min(job->block_size, job->size - i * job->block_size);
+
+		if (job->hdr->comp == IH_COMP_LZMA && IS_ENABLED(CONFIG_LZMA))
+			err = mblock_lzma_block(job, worker, in, inn, out,
+						outn);
+		else if (IS_ENABLED(CONFIG_LZ4))
+			err = mblock_lz4_block(in, inn, out, outn);
+
+		job->status[i].err = err;
+		flush_dcache_range((ulong)out, (ulong)out + outn);
+		flush_dcache_range((ulong)&job->status[i],
+				   (ulong)&job->status[i + 1]);
+	}
+}
+
+/* Set up one LZMA probability model per worker, large enough for all blocks */
+static int mblock_lzma_prepare(struct mblock_job *job, uint nworkers)
+{
+	const u8 *in;
+	CLzmaProps props;
+	size_t size = 0;
+	uint i;
+
+	for (i = 0; i < job->count; i++) {
+		in = (const u8 *)job->hdr + be32_to_cpu(job->ent[i].offset);
+		if (be32_to_cpu(job->ent[i].size) < MBLOCK_LZMA_HDR_SIZE ||
+		    LzmaProps_Decode(&props, in, LZMA_PROPS_SIZE) != SZ_OK)
+			return -EINVAL;
+
+		size = max(size, (LZMA_BASE_SIZE +
+				  (LZMA_LIT_SIZE << (props.lc + props.lp))) *
+			   sizeof(CLzmaProb));
+	}
+
+	/* Keep each model on its own cache lines */
+	job->probs_size = roundup(size, ARCH_DMA_MINALIGN);
+	job->probs = memalign(ARCH_DMA_MINALIGN, job->probs_size * nworkers);
+	if (!job->probs)
+		return -ENOMEM;
+
+	job->nprobs = nworkers;
+
+	return 0;
+}
+
+int mblock_decompress(void *dst, size_t *dstn, const void *src, size_t srcn)
+{
+	const struct mblock_header *hdr = src;
+	struct mblock_job job;
+	size_t space = *dstn;
+	uint i, nworkers;
+	bool parallel;
+	int ret;
+
+	*dstn = 0;
+	ret = mblock_check(src, srcn);
+	if (ret)
+		return ret;
+
+	if ((hdr->comp == IH_COMP_LZMA && !IS_ENABLED(CONFIG_LZMA)) ||
+	    (hdr->comp == IH_COMP_LZ4 && !IS_ENABLED(CONFIG_LZ4)))
+		return -EPROTONOSUPPORT;
+
+	memset(&job, 0, sizeof(job));
+	job.hdr = hdr;
+	job.ent = (const void *)(hdr + 1);
+	job.dst = dst;
+	job.count = be32_to_cpu(hdr->count);
+	job.block_size = be32_to_cpu(hdr->block_size);
+	job.size = be32_to_cpu(hdr->size);
+
+	if (space < job.size) {
+		*dstn = job.size;
+		return -ENOSPC;
+	}
+
+	job.status = memalign(ARCH_DMA_MINALIGN,
+			      job.count * sizeof(*job.status));
+	if (!job.status)
+		return -ENOMEM;
+
+	/* A block no worker got to must not pass for a good one */
+	for (i = 0; i < job.count; i++)
+		job.status[i].err = -EINPROGRESS;
+
+	/*
+	 * Workers write back whole cache lines, so blocks sharing a line
+	 * can't be spread over CPUs without coherent caches
+	 */
+	parallel = IS_ALIGNED((ulong)dst, ARCH_DMA_MINALIGN) &&
+		   IS_ALIGNED(job.block_size, ARCH_DMA_MINALIGN);
+	nworkers = parallel ? parallel_workers() : 1;
+
+	if (IS_ENABLED(CONFIG_LZMA) && hdr->comp == IH_COMP_LZMA) {
+		ret = mblock_lzma_prepare(&job, nworkers);
+		if (ret)
+			goto out;
+	}
+
+	if (parallel) {
+		flush_dcache_range((ulong)&job, (ulong)&job + sizeof(job));
+		flush_dcache_range((ulong)src, (ulong)src + srcn);
+		flush_dcache_range((ulong)dst, (ulong)dst + job.size);
+		flush_dcache_range((ulong)job.status,
+				   (ulong)&job.status[job.count]);
+		if (job.probs)
+			flush_dcache_range((ulong)job.probs, (ulong)job.probs +
+					   job.probs_size * job.nprobs);
+
+		run_parallel(mblock_worker, &job);
+
+		invalidate_dcache_range((ulong)dst, (ulong)dst + job.size);
+		invalidate_dcache_range((ulong)job.status,
+					(ulong)&job.status[job.count]);
+	} else {
+		mblock_worker(&job, 0, 1);
+	}
+
+	for (i = 0; i < job.count; i++) {
+		if (job.status[i].err) {
+			debug("mblock: block %u failed: %d\n", i,
+			      job.status[i].err);
+			ret = job.status[i].err;
+			goto out;
+		}
+	}
+
+	*dstn = job.size;
+
+out:
+	free(job.probs);
+	free(job.status);
+
+	return ret;
+}
+
+#endif /* !USE_HOSTCC */
@@ -36,6 +36,9 @@
 static void
 MD5Transform(__u32 buf[4], __u32 const in[16]);
 
+#if defined(CONFIG_MD5_FAST) && defined(__LITTLE_ENDIAN)
+#define byteReverse(buf, len)	/* Nothing */
+#else
 /*
  * Note: this code is harmless on little-endian machines.
  */
@@ -50,12 +53,13 @@ byteReverse(unsigned char *buf, unsigned longs)
 		buf += 4;
 	} while (--longs);
 }
+#endif
 
 /*
  * Start MD5 accumulation.  Set bit count to 0 and buffer to mysterious
  * initialization constants.
  */
-static void
+void
 MD5Init(struct MD5Context *ctx)
 {
 	ctx->buf[0] = 0x67452301;
@@ -71,7 +75,7 @@ MD5Init(struct MD5Context *ctx)
  * Update context to reflect the concatenation of another buffer full
  * of bytes.
  */
-static void
+void
 MD5Update(struct MD5Context *ctx, unsigned char const *buf, unsigned len)
 {
 	register __u32 t;
@@ -103,6 +107,20 @@ MD5Update(struct MD5Context *ctx, unsigned char const *buf, unsigned len)
 	}
 	/* Process data in 64-byte chunks */
 
+#if defined(CONFIG_MD5_FAST) && defined(__LITTLE_ENDIAN)
+	/*
+	 * The words are already in host order, so aligned input can be
+	 * transformed in place without the bounce through ctx->in.
+	 */
+	if (!((uintptr_t)buf & 3)) {
+		while (len >= 64) {
+			MD5Transform(ctx->buf, (const __u32 *) buf);
+			buf += 64;
+			len -= 64;
+		}
+	}
+#endif
+
 	while (len >= 64) {
 		memmove(ctx->in, buf, 64);
 		byteReverse(ctx->in, 16);
@@ -120,7 +138,7 @@ MD5Update(struct MD5Context *ctx, unsigned char const *buf, unsigned len)
  * Final wrapup - pad to 64-byte boundary with the bit pattern
  * 1 0* (64-bit count of bits processed, MSB-first)
  */
-static void
+void
 MD5Final(unsigned char digest[16], struct MD5Context *ctx)
 {
 	unsigned int count;
@@ -284,12 +302,12 @@ md5 (unsigned char *input, int len, unsigned char output[16])
  * watchdog every 'chunk_sz' bytes of input processed.
  */
 void
-md5_wd (unsigned char *input, int len, unsigned char output[16],
-	unsigned int chunk_sz)
+md5_wd (const unsigned char *input, unsigned int len,
+	unsigned char output[16], unsigned int chunk_sz)
 {
 	struct MD5Context context;
 #if defined(CONFIG_HW_WATCHDOG) || defined(CONFIG_WATCHDOG)
-	unsigned char *end, *curr;
+	const unsigned char *end, *curr;
 	int chunk;
 #endif
 
@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Fixed-size object pools, see include/obj_pool.h
+ */
+
+#include <common.h>
+#include <obj_pool.h>
+
+/* General purpose page buffers */
+OBJ_POOL(page, CONFIG_OBJ_POOL_PAGE_SIZE, CONFIG_OBJ_POOL_PAGE_COUNT);
+
+/* Bounce buffers for flash erase blocks */
+OBJ_POOL(block, CONFIG_OBJ_POOL_BLOCK_SIZE, CONFIG_OBJ_POOL_BLOCK_COUNT);
+
+static bool obj_pool_owns(struct obj_pool *pool, void *ptr)
+{
+	return (u8 *)ptr >= pool->mem &&
+	       (u8 *)ptr < pool->mem + pool->count * pool->stride;
+}
+
+void *obj_pool_alloc(struct obj_pool *pool, size_t size)
+{
+	void *ptr;
+
+	pool->allocs++;
+
+	if (size > pool->size)
+		goto fallback;
+
+	if (pool->free_list) {
+		ptr = pool->free_list;
+		pool->free_list = *(void **)ptr;
+	} else if (pool->next < pool->count) {
+		/* Objects are only put on the free list once freed */
+		ptr = pool->mem + pool->next * pool->stride;
+		pool->next++;
+	} else {
+		goto fallback;
+	}
+
+	pool->used++;
+	if (pool->used > pool->peak)
+		pool->peak = pool->used;
+
+	return ptr;
+
+fallback:
+	pool->fallbacks++;
+
+	return malloc(size);
+}
+
+void obj_pool_free(struct obj_pool *pool, void *ptr)
+{
+	if (!ptr)
+		return;
+
+	if (!obj_pool_owns(pool, ptr)) {
+		free(ptr);
+		return;
+	}
+
+	*(void **)ptr = pool->free_list;
+	pool->free_list = ptr;
+	pool->used--;
+}
+
+void obj_pool_print_stats(void)
+{
+	struct obj_pool *pool = ll_entry_start(struct obj_pool, obj_pool);
+	const int n = ll_entry_count(struct obj_pool, obj_pool);
+	int i;
+
+	printf("%-12s %8s %6s %6s %6s %10s %10s\n", "Pool", "Size", "Count",
+	       "Used", "Peak", "Allocs", "Fallbacks");
+
+	for (i = 0; i < n; i++, pool++)
+		printf("%-12s %8zu %6u %6u %6u %10lu %10lu\n", pool->name,
+		       pool->size, pool->count, pool->used, pool->peak,
+		       pool->allocs, pool->fallbacks);
+}
@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Default run_parallel() for boards which only use the boot CPU
+ */
+
+#include <common.h>
+#include <parallel.h>
+
+__weak uint parallel_workers(void)
+{
+	return 1;
+}
+
+__weak uint run_parallel(parallel_fn fn, void *arg)
+{
+	fn(arg, 0, 1);
+
+	return 1;
+}
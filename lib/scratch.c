@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Named scratch regions of DRAM, see include/scratch.h
+ */
+
+#include <common.h>
+#include <lmb.h>
+#include <mapmem.h>
+#include <scratch.h>
+#include <linux/sizes.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define SCRATCH_MAX_REGIONS	6
+#define SCRATCH_ALIGN		SZ_4K
+
+/* Exception vectors and such at the start of DRAM */
+#define SCRATCH_LOW_RESERVED	SZ_64K
+
+/* Room for the stack to grow below its initial top */
+#define SCRATCH_STACK_SIZE	SZ_1M
+
+struct scratch_region {
+	const char *name;
+	phys_addr_t base;
+	phys_size_t size;
+};
+
+static struct lmb scratch_lmb;
+static struct scratch_region scratch_regions[SCRATCH_MAX_REGIONS];
+static bool scratch_ready;
+
+static void scratch_init(void)
+{
+	phys_addr_t start = CONFIG_SYS_SDRAM_BASE;
+
+	if (scratch_ready)
+		return;
+
+	lmb_init(&scratch_lmb);
+	lmb_add(&scratch_lmb, start, gd->ram_top - start);
+	lmb_reserve(&scratch_lmb, start, SCRATCH_LOW_RESERVED);
+
+	/* U-Boot with its heap, and the stack */
+	lmb_reserve(&scratch_lmb, gd->start_addr_sp - SCRATCH_STACK_SIZE,
+		    gd->ram_top - gd->start_addr_sp + SCRATCH_STACK_SIZE);
+
+	scratch_ready = true;
+}
+
+static struct scratch_region *scratch_find(const char *name)
+{
+	int i;
+
+	for (i = 0; i < SCRATCH_MAX_REGIONS; i++) {
+		if (scratch_regions[i].name &&
+		    !strcmp(scratch_regions[i].name, name))
+			return &scratch_regions[i];
+	}
+
+	return NULL;
+}
+
+/* Release the region under @name if any, and return a free slot */
+static struct scratch_region *scratch_slot(const char *name)
+{
+	struct scratch_region *r = scratch_find(name);
+	int i;
+
+	if (r) {
+		lmb_free(&scratch_lmb, r->base, r->size);
+		r->name = NULL;
+		return r;
+	}
+
+	for (i = 0; i < SCRATCH_MAX_REGIONS; i++) {
+		if (!scratch_regions[i].name)
+			return &scratch_regions[i];
+	}
+
+	printf("No scratch region left for %s\n", name);
+
+	return NULL;
+}
+
+void *scratch_alloc(const char *name, phys_size_t size)
+{
+	struct scratch_region *r;
+	phys_addr_t base;
+
+	scratch_init();
+
+	r = scratch_find(name);
+	if (r && r->size >= size)
+		return map_sysmem(r->base, r->size);
+
+	r = scratch_slot(name);
+	if (!r)
+		return NULL;
+
+	size = ALIGN(size, SCRATCH_ALIGN);
+	base = __lmb_alloc_base(&scratch_lmb, size, SCRATCH_ALIGN, 0);
+	if (!base) {
+		printf("Not enough memory for %s (0x%llx bytes)\n", name,
+		       (unsigned long long)size);
+		return NULL;
+	}
+
+	r->name = name;
+	r->base = base;
+	r->size = size;
+
+	return map_sysmem(base, size);
+}
+
+void *scratch_alloc_max(const char *name, phys_size_t *size)
+{
+	struct scratch_region *r;
+	phys_addr_t base, end;
+	phys_size_t len;
+
+	scratch_init();
+
+	r = scratch_slot(name);
+	if (!r)
+		return NULL;
+
+	len = lmb_largest_free(&scratch_lmb, &base);
+	end = base + len;
+	base = ALIGN(base, SCRATCH_ALIGN);
+	if (!len || base >= end) {
+		printf("No memory left for %s\n", name);
+		return NULL;
+	}
+
+	r->name = name;
+	r->base = base;
+	r->size = end - base;
+	lmb_reserve(&scratch_lmb, r->base, r->size);
+
+	*size = r->size;
+
+	return map_sysmem(r->base, r->size);
+}
+
+int scratch_shrink(const char *name, phys_size_t size)
+{
+	struct scratch_region *r = scratch_find(name);
+
+	if (!r)
+		return -ENOENT;
+
+	size = ALIGN(size, SCRATCH_ALIGN);
+	if (size < r->size) {
+		lmb_free(&scratch_lmb, r->base + size, r->size - size);
+		r->size = size;
+	}
+
+	return 0;
+}
+
+void scratch_free(const char *name)
+{
+	struct scratch_region *r = scratch_find(name);
+
+	if (!r)
+		return;
+
+	lmb_free(&scratch_lmb, r->base, r->size);
+	r->name = NULL;
+}
+
+void scratch_print(void)
+{
+	phys_addr_t base = 0;
+	phys_size_t len;
+	int i;
+
+	scratch_init();
+
+	for (i = 0; i < SCRATCH_MAX_REGIONS; i++) {
+		if (!scratch_regions[i].name)
+			continue;
+
+		printf("Scratch: %-16s 0x%08llx, ", scratch_regions[i].name,
+		       (unsigned long long)scratch_regions[i].base);
+		print_size(scratch_regions[i].size, "\n");
+	}
+
+	len = lmb_largest_free(&scratch_lmb, &base);
+	printf("Scratch: largest free area 0x%08llx, ",
+	       (unsigned long long)base);
+	print_size(len, "\n");
+}
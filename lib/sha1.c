@@ -24,6 +24,9 @@
 #endif /* USE_HOSTCC */
 #include <watchdog.h>
 #include <u-boot/sha1.h>
+#ifdef CONFIG_SHA1_FAST
+#include <asm/unaligned.h>
+#endif
 
 const uint8_t sha1_der_prefix[SHA1_DER_LEN] = {
 	0x30, 0x21, 0x30, 0x09, 0x06, 0x05, 0x2b, 0x0e,
@@ -65,6 +68,161 @@ void sha1_starts (sha1_context * ctx)
 	ctx->state[4] = 0xC3D2E1F0;
 }
 
+#ifdef CONFIG_SHA1_FAST
+/* Plain shifts of a 32-bit value, which gcc turns into a single rotr */
+#define ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define F1(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define F2(x, y, z) ((x) ^ (y) ^ (z))
+#define F3(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+
+#define GET_ALIGNED_BE32(p, i)		be32_to_cpu(((const u32 *)(p))[i])
+#define GET_UNALIGNED_BE32(p, i)	get_unaligned_be32((p) + 4 * (i))
+
+/*
+ * Same round structure as the generic code, but with the 16-word
+ * schedule ring held in scalars and all 80 rounds spelled out so that
+ * every ring index is a compile-time constant.
+ */
+#define SCHED(i, i3, i8, i14)	\
+	(W##i = ROTL(W##i3 ^ W##i8 ^ W##i14 ^ W##i, 1))
+
+#define RND(a, b, c, d, e, F, K, x) {			\
+	e += ROTL(a, 5) + F(b, c, d) + (K) + (x);	\
+	b = ROTL(b, 30);				\
+}
+
+#define SHA1_LOAD_BLOCK(get, p)					\
+	W0 = get(p, 0); W1 = get(p, 1);				\
+	W2 = get(p, 2); W3 = get(p, 3);				\
+	W4 = get(p, 4); W5 = get(p, 5);				\
+	W6 = get(p, 6); W7 = get(p, 7);				\
+	W8 = get(p, 8); W9 = get(p, 9);				\
+	W10 = get(p, 10); W11 = get(p, 11);			\
+	W12 = get(p, 12); W13 = get(p, 13);			\
+	W14 = get(p, 14); W15 = get(p, 15);
+
+static void sha1_process_blocks(sha1_context *ctx, const unsigned char *data,
+				unsigned int blocks)
+{
+	u32 W0, W1, W2, W3, W4, W5, W6, W7;
+	u32 W8, W9, W10, W11, W12, W13, W14, W15;
+	u32 A, B, C, D, E;
+	bool aligned = IS_ALIGNED((uintptr_t)data, sizeof(u32));
+
+	A = ctx->state[0];
+	B = ctx->state[1];
+	C = ctx->state[2];
+	D = ctx->state[3];
+	E = ctx->state[4];
+
+	while (blocks--) {
+		if (aligned) {
+			SHA1_LOAD_BLOCK(GET_ALIGNED_BE32, data);
+		} else {
+			SHA1_LOAD_BLOCK(GET_UNALIGNED_BE32, data);
+		}
+
+		RND(A, B, C, D, E, F1, 0x5A827999, W0);
+		RND(E, A, B, C, D, F1, 0x5A827999, W1);
+		RND(D, E, A, B, C, F1, 0x5A827999, W2);
+		RND(C, D, E, A, B, F1, 0x5A827999, W3);
+		RND(B, C, D, E, A, F1, 0x5A827999, W4);
+		RND(A, B, C, D, E, F1, 0x5A827999, W5);
+		RND(E, A, B, C, D, F1, 0x5A827999, W6);
+		RND(D, E, A, B, C, F1, 0x5A827999, W7);
+		RND(C, D, E, A, B, F1, 0x5A827999, W8);
+		RND(B, C, D, E, A, F1, 0x5A827999, W9);
+		RND(A, B, C, D, E, F1, 0x5A827999, W10);
+		RND(E, A, B, C, D, F1, 0x5A827999, W11);
+		RND(D, E, A, B, C, F1, 0x5A827999, W12);
+		RND(C, D, E, A, B, F1, 0x5A827999, W13);
+		RND(B, C, D, E, A, F1, 0x5A827999, W14);
+		RND(A, B, C, D, E, F1, 0x5A827999, W15);
+		RND(E, A, B, C, D, F1, 0x5A827999, SCHED(0, 13, 8, 2));
+		RND(D, E, A, B, C, F1, 0x5A827999, SCHED(1, 14, 9, 3));
+		RND(C, D, E, A, B, F1, 0x5A827999, SCHED(2, 15, 10, 4));
+		RND(B, C, D, E, A, F1, 0x5A827999, SCHED(3, 0, 11, 5));
+
+		RND(A, B, C, D, E, F2, 0x6ED9EBA1, SCHED(4, 1, 12, 6));
+		RND(E, A, B, C, D, F2, 0x6ED9EBA1, SCHED(5, 2, 13, 7));
+		RND(D, E, A, B, C, F2, 0x6ED9EBA1, SCHED(6, 3, 14, 8));
+		RND(C, D, E, A, B, F2, 0x6ED9EBA1, SCHED(7, 4, 15, 9));
+		RND(B, C, D, E, A, F2, 0x6ED9EBA1, SCHED(8, 5, 0, 10));
+		RND(A, B, C, D, E, F2, 0x6ED9EBA1, SCHED(9, 6, 1, 11));
+		RND(E, A, B, C, D, F2, 0x6ED9EBA1, SCHED(10, 7, 2, 12));
+		RND(D, E, A, B, C, F2, 0x6ED9EBA1, SCHED(11, 8, 3, 13));
+		RND(C, D, E, A, B, F2, 0x6ED9EBA1, SCHED(12, 9, 4, 14));
+		RND(B, C, D, E, A, F2, 0x6ED9EBA1, SCHED(13, 10, 5, 15));
+		RND(A, B, C, D, E, F2, 0x6ED9EBA1, SCHED(14, 11, 6, 0));
+		RND(E, A, B, C, D, F2, 0x6ED9EBA1, SCHED(15, 12, 7, 1));
+		RND(D, E, A, B, C, F2, 0x6ED9EBA1, SCHED(0, 13, 8, 2));
+		RND(C, D, E, A, B, F2, 0x6ED9EBA1, SCHED(1, 14, 9, 3));
+		RND(B, C, D, E, A, F2, 0x6ED9EBA1, SCHED(2, 15, 10, 4));
+		RND(A, B, C, D, E, F2, 0x6ED9EBA1, SCHED(3, 0, 11, 5));
+		RND(E, A, B, C, D, F2, 0x6ED9EBA1, SCHED(4, 1, 12, 6));
+		RND(D, E, A, B, C, F2, 0x6ED9EBA1, SCHED(5, 2, 13, 7));
+		RND(C, D, E, A, B, F2, 0x6ED9EBA1, SCHED(6, 3, 14, 8));
+		RND(B, C, D, E, A, F2, 0x6ED9EBA1, SCHED(7, 4, 15, 9));
+
+		RND(A, B, C, D, E, F3, 0x8F1BBCDC, SCHED(8, 5, 0, 10));
+		RND(E, A, B, C, D, F3, 0x8F1BBCDC, SCHED(9, 6, 1, 11));
+		RND(D, E, A, B, C, F3, 0x8F1BBCDC, SCHED(10, 7, 2, 12));
+		RND(C, D, E, A, B, F3, 0x8F1BBCDC, SCHED(11, 8, 3, 13));
+		RND(B, C, D, E, A, F3, 0x8F1BBCDC, SCHED(12, 9, 4, 14));
+		RND(A, B, C, D, E, F3, 0x8F1BBCDC, SCHED(13, 10, 5, 15));
+		RND(E, A, B, C, D, F3, 0x8F1BBCDC, SCHED(14, 11, 6, 0));
+		RND(D, E, A, B, C, F3, 0x8F1BBCDC, SCHED(15, 12, 7, 1));
+		RND(C, D, E, A, B, F3, 0x8F1BBCDC, SCHED(0, 13, 8, 2));
+		RND(B, C, D, E, A, F3, 0x8F1BBCDC, SCHED(1, 14, 9, 3));
+		RND(A, B, C, D, E, F3, 0x8F1BBCDC, SCHED(2, 15, 10, 4));
+		RND(E, A, B, C, D, F3, 0x8F1BBCDC, SCHED(3, 0, 11, 5));
+		RND(D, E, A, B, C, F3, 0x8F1BBCDC, SCHED(4, 1, 12, 6));
+		RND(C, D, E, A, B, F3, 0x8F1BBCDC, SCHED(5, 2, 13, 7));
+		RND(B, C, D, E, A, F3, 0x8F1BBCDC, SCHED(6, 3, 14, 8));
+		RND(A, B, C, D, E, F3, 0x8F1BBCDC, SCHED(7, 4, 15, 9));
+		RND(E, A, B, C, D, F3, 0x8F1BBCDC, SCHED(8, 5, 0, 10));
+		RND(D, E, A, B, C, F3, 0x8F1BBCDC, SCHED(9, 6, 1, 11));
+		RND(C, D, E, A, B, F3, 0x8F1BBCDC, SCHED(10, 7, 2, 12));
+		RND(B, C, D, E, A, F3, 0x8F1BBCDC, SCHED(11, 8, 3, 13));
+
+		RND(A, B, C, D, E, F2, 0xCA62C1D6, SCHED(12, 9, 4, 14));
+		RND(E, A, B, C, D, F2, 0xCA62C1D6, SCHED(13, 10, 5, 15));
+		RND(D, E, A, B, C, F2, 0xCA62C1D6, SCHED(14, 11, 6, 0));
+		RND(C, D, E, A, B, F2, 0xCA62C1D6, SCHED(15, 12, 7, 1));
+		RND(B, C, D, E, A, F2, 0xCA62C1D6, SCHED(0, 13, 8, 2));
+		RND(A, B, C, D, E, F2, 0xCA62C1D6, SCHED(1, 14, 9, 3));
+		RND(E, A, B, C, D, F2, 0xCA62C1D6, SCHED(2, 15, 10, 4));
+		RND(D, E, A, B, C, F2, 0xCA62C1D6, SCHED(3, 0, 11, 5));
+		RND(C, D, E, A, B, F2, 0xCA62C1D6, SCHED(4, 1, 12, 6));
+		RND(B, C, D, E, A, F2, 0xCA62C1D6, SCHED(5, 2, 13, 7));
+		RND(A, B, C, D, E, F2, 0xCA62C1D6, SCHED(6, 3, 14, 8));
+		RND(E, A, B, C, D, F2, 0xCA62C1D6, SCHED(7, 4, 15, 9));
+		RND(D, E, A, B, C, F2, 0xCA62C1D6, SCHED(8, 5, 0, 10));
+		RND(C, D, E, A, B, F2, 0xCA62C1D6, SCHED(9, 6, 1, 11));
+		RND(B, C, D, E, A, F2, 0xCA62C1D6, SCHED(10, 7, 2, 12));
+		RND(A, B, C, D, E, F2, 0xCA62C1D6, SCHED(11, 8, 3, 13));
+		RND(E, A, B, C, D, F2, 0xCA62C1D6, SCHED(12, 9, 4, 14));
+		RND(D, E, A, B, C, F2, 0xCA62C1D6, SCHED(13, 10, 5, 15));
+		RND(C, D, E, A, B, F2, 0xCA62C1D6, SCHED(14, 11, 6, 0));
+		RND(B, C, D, E, A, F2, 0xCA62C1D6, SCHED(15, 12, 7, 1));
+
+		A += ctx->state[0];
+		B += ctx->state[1];
+		C += ctx->state[2];
+		D += ctx->state[3];
+		E += ctx->state[4];
+
+		ctx->state[0] = A;
+		ctx->state[1] = B;
+		ctx->state[2] = C;
+		ctx->state[3] = D;
+		ctx->state[4] = E;
+
+		data += 64;
+	}
+}
+#else
 static void sha1_process(sha1_context *ctx, const unsigned char data[64])
 {
 	unsigned long temp, W[16], A, B, C, D, E;
@@ -219,6 +377,16 @@ static void sha1_process(sha1_context *ctx, const unsigned char data[64])
 	ctx->state[4] += E;
 }
 
+static void sha1_process_blocks(sha1_context *ctx, const unsigned char *data,
+				unsigned int blocks)
+{
+	while (blocks--) {
+		sha1_process(ctx, data);
+		data += 64;
+	}
+}
+#endif /* CONFIG_SHA1_FAST */
+
 /*
  * SHA-1 process buffer
  */
@@ -242,16 +410,16 @@ void sha1_update(sha1_context *ctx, const unsigned char *input,
 
 	if (left && ilen >= fill) {
 		memcpy ((void *) (ctx->buffer + left), (void *) input, fill);
-		sha1_process (ctx, ctx->buffer);
+		sha1_process_blocks(ctx, ctx->buffer, 1);
 		input += fill;
 		ilen -= fill;
 		left = 0;
 	}
 
-	while (ilen >= 64) {
-		sha1_process (ctx, input);
-		input += 64;
-		ilen -= 64;
+	if (ilen >= 64) {
+		sha1_process_blocks(ctx, input, ilen / 64);
+		input += ilen & ~0x3F;
+		ilen &= 0x3F;
 	}
 
 	if (ilen > 0) {
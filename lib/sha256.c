@@ -13,6 +13,9 @@
 #endif /* USE_HOSTCC */
 #include <watchdog.h>
 #include <u-boot/sha256.h>
+#ifdef CONFIG_SHA256_FAST
+#include <asm/unaligned.h>
+#endif
 
 const uint8_t sha256_der_prefix[SHA256_DER_LEN] = {
 	0x30, 0x31, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86,
@@ -55,6 +58,170 @@ void sha256_starts(sha256_context * ctx)
 	ctx->state[7] = 0x5BE0CD19;
 }
 
+#ifdef CONFIG_SHA256_FAST
+static const uint32_t sha256_k[64] = {
+	0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+	0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+	0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+	0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+	0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC,
+	0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+	0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7,
+	0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+	0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+	0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+	0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3,
+	0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+	0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5,
+	0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+	0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+	0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+/* Plain shifts of a 32-bit value, which gcc turns into a single rotr */
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+#define S0(x) (ROTR(x, 7) ^ ROTR(x, 18) ^ ((x) >> 3))
+#define S1(x) (ROTR(x, 17) ^ ROTR(x, 19) ^ ((x) >> 10))
+
+#define S2(x) (ROTR(x, 2) ^ ROTR(x, 13) ^ ROTR(x, 22))
+#define S3(x) (ROTR(x, 6) ^ ROTR(x, 11) ^ ROTR(x, 25))
+
+#define F0(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+#define F1(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+
+#define GET_ALIGNED_BE32(p, i)		be32_to_cpu(((const uint32_t *)(p))[i])
+#define GET_UNALIGNED_BE32(p, i)	get_unaligned_be32((p) + 4 * (i))
+
+/*
+ * The message schedule is kept in sixteen scalars instead of an array
+ * and every round is expanded with constant indices, so the compiler
+ * can keep the working set in registers. W[t] replaces W[t - 16] in
+ * place once the first sixteen rounds have consumed the input words.
+ */
+#define SCHED(i, i2, i7, i15)	\
+	(W##i += S1(W##i2) + W##i7 + S0(W##i15))
+
+#define RND(a, b, c, d, e, f, g, h, x, K) {		\
+	temp1 = h + S3(e) + F1(e, f, g) + (K) + (x);	\
+	temp2 = S2(a) + F0(a, b, c);			\
+	d += temp1; h = temp1 + temp2;			\
+}
+
+#define SHA256_LOAD_BLOCK(get, p)				\
+	W0 = get(p, 0); W1 = get(p, 1);				\
+	W2 = get(p, 2); W3 = get(p, 3);				\
+	W4 = get(p, 4); W5 = get(p, 5);				\
+	W6 = get(p, 6); W7 = get(p, 7);				\
+	W8 = get(p, 8); W9 = get(p, 9);				\
+	W10 = get(p, 10); W11 = get(p, 11);			\
+	W12 = get(p, 12); W13 = get(p, 13);			\
+	W14 = get(p, 14); W15 = get(p, 15);
+
+#define SHA256_ROUNDS16_LOAD(k)					\
+	RND(A, B, C, D, E, F, G, H, W0, (k)[0]);		\
+	RND(H, A, B, C, D, E, F, G, W1, (k)[1]);		\
+	RND(G, H, A, B, C, D, E, F, W2, (k)[2]);		\
+	RND(F, G, H, A, B, C, D, E, W3, (k)[3]);		\
+	RND(E, F, G, H, A, B, C, D, W4, (k)[4]);		\
+	RND(D, E, F, G, H, A, B, C, W5, (k)[5]);		\
+	RND(C, D, E, F, G, H, A, B, W6, (k)[6]);		\
+	RND(B, C, D, E, F, G, H, A, W7, (k)[7]);		\
+	RND(A, B, C, D, E, F, G, H, W8, (k)[8]);		\
+	RND(H, A, B, C, D, E, F, G, W9, (k)[9]);		\
+	RND(G, H, A, B, C, D, E, F, W10, (k)[10]);		\
+	RND(F, G, H, A, B, C, D, E, W11, (k)[11]);		\
+	RND(E, F, G, H, A, B, C, D, W12, (k)[12]);		\
+	RND(D, E, F, G, H, A, B, C, W13, (k)[13]);		\
+	RND(C, D, E, F, G, H, A, B, W14, (k)[14]);		\
+	RND(B, C, D, E, F, G, H, A, W15, (k)[15]);
+
+#define SHA256_ROUNDS16(k)					\
+	RND(A, B, C, D, E, F, G, H,				\
+	    SCHED(0, 14, 9, 1), (k)[0]);			\
+	RND(H, A, B, C, D, E, F, G,				\
+	    SCHED(1, 15, 10, 2), (k)[1]);			\
+	RND(G, H, A, B, C, D, E, F,				\
+	    SCHED(2, 0, 11, 3), (k)[2]);			\
+	RND(F, G, H, A, B, C, D, E,				\
+	    SCHED(3, 1, 12, 4), (k)[3]);			\
+	RND(E, F, G, H, A, B, C, D,				\
+	    SCHED(4, 2, 13, 5), (k)[4]);			\
+	RND(D, E, F, G, H, A, B, C,				\
+	    SCHED(5, 3, 14, 6), (k)[5]);			\
+	RND(C, D, E, F, G, H, A, B,				\
+	    SCHED(6, 4, 15, 7), (k)[6]);			\
+	RND(B, C, D, E, F, G, H, A,				\
+	    SCHED(7, 5, 0, 8), (k)[7]);				\
+	RND(A, B, C, D, E, F, G, H,				\
+	    SCHED(8, 6, 1, 9), (k)[8]);				\
+	RND(H, A, B, C, D, E, F, G,				\
+	    SCHED(9, 7, 2, 10), (k)[9]);			\
+	RND(G, H, A, B, C, D, E, F,				\
+	    SCHED(10, 8, 3, 11), (k)[10]);			\
+	RND(F, G, H, A, B, C, D, E,				\
+	    SCHED(11, 9, 4, 12), (k)[11]);			\
+	RND(E, F, G, H, A, B, C, D,				\
+	    SCHED(12, 10, 5, 13), (k)[12]);			\
+	RND(D, E, F, G, H, A, B, C,				\
+	    SCHED(13, 11, 6, 14), (k)[13]);			\
+	RND(C, D, E, F, G, H, A, B,				\
+	    SCHED(14, 12, 7, 15), (k)[14]);			\
+	RND(B, C, D, E, F, G, H, A,				\
+	    SCHED(15, 13, 8, 0), (k)[15]);
+
+static void sha256_process_blocks(sha256_context *ctx, const uint8_t *data,
+				  uint32_t blocks)
+{
+	uint32_t temp1, temp2;
+	uint32_t W0, W1, W2, W3, W4, W5, W6, W7;
+	uint32_t W8, W9, W10, W11, W12, W13, W14, W15;
+	uint32_t A, B, C, D, E, F, G, H;
+	bool aligned = IS_ALIGNED((uintptr_t)data, sizeof(uint32_t));
+
+	A = ctx->state[0];
+	B = ctx->state[1];
+	C = ctx->state[2];
+	D = ctx->state[3];
+	E = ctx->state[4];
+	F = ctx->state[5];
+	G = ctx->state[6];
+	H = ctx->state[7];
+
+	while (blocks--) {
+		if (aligned) {
+			SHA256_LOAD_BLOCK(GET_ALIGNED_BE32, data);
+		} else {
+			SHA256_LOAD_BLOCK(GET_UNALIGNED_BE32, data);
+		}
+
+		SHA256_ROUNDS16_LOAD(sha256_k);
+		SHA256_ROUNDS16(sha256_k + 16);
+		SHA256_ROUNDS16(sha256_k + 32);
+		SHA256_ROUNDS16(sha256_k + 48);
+
+		A += ctx->state[0];
+		B += ctx->state[1];
+		C += ctx->state[2];
+		D += ctx->state[3];
+		E += ctx->state[4];
+		F += ctx->state[5];
+		G += ctx->state[6];
+		H += ctx->state[7];
+
+		ctx->state[0] = A;
+		ctx->state[1] = B;
+		ctx->state[2] = C;
+		ctx->state[3] = D;
+		ctx->state[4] = E;
+		ctx->state[5] = F;
+		ctx->state[6] = G;
+		ctx->state[7] = H;
+
+		data += 64;
+	}
+}
+#else
 static void sha256_process(sha256_context *ctx, const uint8_t data[64])
 {
 	uint32_t temp1, temp2;
@@ -186,6 +353,16 @@ static void sha256_process(sha256_context *ctx, const uint8_t data[64])
 	ctx->state[7] += H;
 }
 
+static void sha256_process_blocks(sha256_context *ctx, const uint8_t *data,
+				  uint32_t blocks)
+{
+	while (blocks--) {
+		sha256_process(ctx, data);
+		data += 64;
+	}
+}
+#endif /* CONFIG_SHA256_FAST */
+
 void sha256_update(sha256_context *ctx, const uint8_t *input, uint32_t length)
 {
 	uint32_t left, fill;
@@ -204,16 +381,16 @@ void sha256_update(sha256_context *ctx, const uint8_t *input, uint32_t length)
 
 	if (left && length >= fill) {
 		memcpy((void *) (ctx->buffer + left), (void *) input, fill);
-		sha256_process(ctx, ctx->buffer);
+		sha256_process_blocks(ctx, ctx->buffer, 1);
 		length -= fill;
 		input += fill;
 		left = 0;
 	}
 
-	while (length >= 64) {
-		sha256_process(ctx, input);
-		length -= 64;
-		input += 64;
+	if (length >= 64) {
+		sha256_process_blocks(ctx, input, length / 64);
+		input += length & ~0x3F;
+		length &= 0x3F;
 	}
 
 	if (length)
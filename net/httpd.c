@@ -9,9 +9,12 @@
 
 #include <common.h>
 #include <errno.h>
+#include <hash.h>
 #include <watchdog.h>
 #include <malloc.h>
 #include <net.h>
+#include <obj_pool.h>
+#include <scratch.h>
 #include <net/tcp.h>
 #include <net/httpd.h>
 
@@ -20,6 +23,11 @@ struct httpd_instance {
 
 	u16 port;
 	struct list_head uri_handlers;
+
+#ifdef CONFIG_NET_RX_HASH
+	const char *rx_hash_name;
+	const char *rx_hash_algo;
+#endif
 };
 
 struct _httpd_uri_handler {
@@ -28,6 +36,41 @@ struct _httpd_uri_handler {
 	struct httpd_uri_handler urih;
 };
 
+#ifdef CONFIG_NET_RX_HASH
+/* RFC 2046 limits the boundary to 70 characters */
+#define HTTPD_BOUNDARY_MAX	70
+
+enum httpd_rx_hash_state {
+	HTTPD_RXH_NONE = 0,
+	HTTPD_RXH_BOUNDARY,
+	HTTPD_RXH_HEADER,
+	HTTPD_RXH_SKIP,
+	HTTPD_RXH_DATA,
+	HTTPD_RXH_DONE
+};
+
+/*
+ * Follows the multipart payload while it is being received and hashes
+ * the value of one form field. The parsing mirrors the one done by
+ * httpd_handle_request() so that both agree on where the value is.
+ */
+struct httpd_rx_hash {
+	enum httpd_rx_hash_state state;
+	struct hash_stream hs;
+	const char *name;
+
+	char delim[HTTPD_BOUNDARY_MAX + 3];
+	u32 delimlen;
+
+	char *scan;	/* where parsing continues */
+	char *part;	/* start of the part headers of the hashed value */
+	char *data;	/* start of the hashed value */
+	char *next;	/* boundary after the value, set once hashed */
+
+	u8 digest[HASH_MAX_DIGEST_SIZE];
+};
+#endif
+
 enum httpd_session_status {
 	HTTPD_S_NEW = 0,
 	HTTPD_S_HEADER_RECVING,
@@ -55,8 +98,17 @@ struct httpd_tcp_pdata {
 	struct httpd_response response;
 
 	int resp_std_cnt;
+
+#ifdef CONFIG_NET_RX_HASH
+	struct httpd_rx_hash rxh;
+#endif
 };
 
+/* Requests beyond this come from the heap */
+#define HTTPD_PDATA_POOL_SIZE	4
+
+OBJ_POOL(httpd_pdata, sizeof(struct httpd_tcp_pdata), HTTPD_PDATA_POOL_SIZE);
+
 struct http_response_code {
 	u32 code;
 	const char *text;
@@ -83,6 +135,11 @@ static LIST_HEAD(inst_head);
 
 static void httpd_tcp_callback(struct tcb_cb_data *cbd);
 static void httpd_std_err_response(struct tcb_cb_data *cbd, u32 code);
+#ifdef CONFIG_NET_RX_HASH
+static void httpd_rx_hash_start(struct httpd_instance *inst,
+				struct httpd_tcp_pdata *pdata);
+static void httpd_rx_hash_update(struct httpd_tcp_pdata *pdata);
+#endif
 
 static void dummy_urih_cb(enum httpd_uri_handler_status status,
 			  struct httpd_request *request,
@@ -116,7 +173,7 @@ struct httpd_instance *httpd_create_instance(u16 port)
 	if (httpd_find_instance(port))
 		return NULL;
 
-	inst = malloc(sizeof(*inst));
+	inst = calloc(1, sizeof(*inst));
 	if (!inst)
 		return NULL;
 
@@ -237,6 +294,30 @@ struct httpd_uri_handler *httpd_find_uri_handler(
 	return NULL;
 }
 
+#ifdef CONFIG_NET_RX_HASH
+int httpd_set_upload_hash(struct httpd_instance *httpd_inst,
+			  const char *name, const char *algo_name)
+{
+	struct hash_algo *algo;
+
+	if (!httpd_inst)
+		return -EINVAL;
+
+	if (name && algo_name) {
+		if (hash_progressive_lookup_algo(algo_name, &algo))
+			return -EPROTONOSUPPORT;
+	} else {
+		name = NULL;
+		algo_name = NULL;
+	}
+
+	httpd_inst->rx_hash_name = name;
+	httpd_inst->rx_hash_algo = algo_name;
+
+	return 0;
+}
+#endif
+
 u32 http_make_response_header(struct http_response_info *info, char *buff,
 			      u32 size)
 {
@@ -438,12 +519,20 @@ static int httpd_recv_hdr(struct httpd_instance *inst,
 				return 1;
 			}
 
+			/*
+			 * The upload stays there for its handler after the
+			 * connection is closed, until the next upload
+			 */
+			pdata->upload_ptr = scratch_alloc("httpd upload",
+						pdata->payload_size + 1);
+			if (!pdata->upload_ptr) {
+				err_code = 413;
+				goto bad_request;
+			}
+
 			/* generate new upload identifier */
 			upload_id = rand();
 
-			/* calculate new cache address */
-			pdata->upload_ptr =
-				(char *) CONFIG_SYS_SDRAM_BASE + 0x10000;
 			pdata->upload_size = pdata->bufsize - hdr_size;
 			/* copy received parts to new cache */
 			memcpy(pdata->upload_ptr, pdata->buf + hdr_size,
@@ -458,6 +547,10 @@ static int httpd_recv_hdr(struct httpd_instance *inst,
 			}
 		}
 
+#ifdef CONFIG_NET_RX_HASH
+		httpd_rx_hash_start(inst, pdata);
+#endif
+
 		if (pdata->upload_size == pdata->payload_size) {
 			/* upload completed */
 			pdata->upload_ptr[pdata->payload_size] = 0;
@@ -498,6 +591,10 @@ static int httpd_recv_payload(struct httpd_instance *inst,
 	memcpy(pdata->upload_ptr + pdata->upload_size, cbd->data, size_recv);
 	pdata->upload_size += size_recv;
 
+#ifdef CONFIG_NET_RX_HASH
+	httpd_rx_hash_update(pdata);
+#endif
+
 	if (pdata->upload_size == pdata->payload_size) {
 		pdata->upload_ptr[pdata->payload_size] = 0;
 		pdata->status = HTTPD_S_FULL_RCVD;
@@ -528,6 +625,152 @@ static void *memstr(void *src, size_t limit, const char *str)
 	return NULL;
 }
 
+#ifdef CONFIG_NET_RX_HASH
+/* Check whether part headers in [hdr, end) carry the given field name */
+static int httpd_rx_hash_match(const char *hdr, const char *end,
+			       const char *name)
+{
+	static const char name_str[] = "name=";
+	u32 namelen = strlen(name);
+	const char *p;
+
+	p = memstr((void *)hdr, end - hdr, name_str);
+	if (!p)
+		return 0;
+
+	p += sizeof(name_str) - 1;
+
+	if (*p == '\"') {
+		p++;
+		if (end - p < namelen + 1)
+			return 0;
+
+		return !strncmp(p, name, namelen) && p[namelen] == '\"';
+	}
+
+	if (end - p < namelen)
+		return 0;
+
+	return !strncmp(p, name, namelen) &&
+	       (p + namelen == end || p[namelen] == '\r');
+}
+
+static void httpd_rx_hash_start(struct httpd_instance *inst,
+				struct httpd_tcp_pdata *pdata)
+{
+	struct httpd_rx_hash *rxh = &pdata->rxh;
+	u32 len;
+
+	if (!inst->rx_hash_algo || !pdata->boundary)
+		return;
+
+	len = strlen(pdata->boundary);
+	if (len > HTTPD_BOUNDARY_MAX)
+		return;
+
+	if (hash_stream_start(&rxh->hs, inst->rx_hash_algo, 0))
+		return;
+
+	rxh->delim[0] = rxh->delim[1] = '-';
+	memcpy(rxh->delim + 2, pdata->boundary, len + 1);
+	rxh->delimlen = len + 2;
+
+	rxh->name = inst->rx_hash_name;
+	rxh->scan = pdata->upload_ptr;
+	rxh->state = HTTPD_RXH_BOUNDARY;
+
+	httpd_rx_hash_update(pdata);
+}
+
+static void httpd_rx_hash_value(struct httpd_rx_hash *rxh, const char *end)
+{
+	const char *p = rxh->data + rxh->hs.pos;
+
+	if (end > p)
+		hash_stream_update(&rxh->hs, rxh->hs.pos, p, end - p);
+}
+
+static void httpd_rx_hash_update(struct httpd_tcp_pdata *pdata)
+{
+	struct httpd_rx_hash *rxh = &pdata->rxh;
+	char *end = pdata->upload_ptr + pdata->upload_size;
+	char *p;
+
+	while (1) {
+		switch (rxh->state) {
+		case HTTPD_RXH_BOUNDARY:
+			if (end - rxh->scan < rxh->delimlen + 2)
+				return;
+
+			/* Anything else than a new part ends the payload */
+			if (memcmp(rxh->scan, rxh->delim, rxh->delimlen) ||
+			    strncmp(rxh->scan + rxh->delimlen, "\r\n", 2))
+				goto abort;
+
+			rxh->scan += rxh->delimlen + 2;
+			rxh->part = rxh->scan;
+			rxh->state = HTTPD_RXH_HEADER;
+			break;
+
+		case HTTPD_RXH_HEADER:
+			p = memstr(rxh->part, end - rxh->part, "\r\n\r\n");
+			if (!p)
+				return;
+
+			rxh->data = p + 4;
+			rxh->scan = rxh->data;
+
+			if (httpd_rx_hash_match(rxh->part, p, rxh->name))
+				rxh->state = HTTPD_RXH_DATA;
+			else
+				rxh->state = HTTPD_RXH_SKIP;
+			break;
+
+		case HTTPD_RXH_SKIP:
+		case HTTPD_RXH_DATA:
+			p = memstr(rxh->scan, end - rxh->scan, rxh->delim);
+			if (!p) {
+				/* A boundary may start in the last bytes */
+				if (end - rxh->scan >= rxh->delimlen)
+					rxh->scan = end - rxh->delimlen + 1;
+
+				/* The value ends at least 2 bytes before it */
+				if (rxh->state == HTTPD_RXH_DATA)
+					httpd_rx_hash_value(rxh,
+							    rxh->scan - 2);
+				return;
+			}
+
+			if (rxh->state == HTTPD_RXH_SKIP) {
+				rxh->scan = p;
+				rxh->state = HTTPD_RXH_BOUNDARY;
+				break;
+			}
+
+			if (p - 2 < rxh->data + rxh->hs.pos)
+				goto abort;
+
+			httpd_rx_hash_value(rxh, p - 2);
+
+			if (hash_stream_finish(&rxh->hs, rxh->digest,
+					       sizeof(rxh->digest)))
+				goto abort;
+
+			rxh->next = p;
+			rxh->state = HTTPD_RXH_DONE;
+			return;
+
+		default:
+			return;
+		}
+	}
+
+abort:
+	hash_stream_abort(&rxh->hs);
+	rxh->state = HTTPD_RXH_DONE;
+}
+#endif
+
 static char *name_extract(char *s)
 {
 	char *name, *p;
@@ -596,6 +839,12 @@ static int httpd_handle_request(struct httpd_instance *inst,
 
 			formdata[numformdata] = p;
 
+#ifdef CONFIG_NET_RX_HASH
+			/* The end of the hashed value is already known */
+			if (p == pdata->rxh.part && pdata->rxh.next)
+				p = pdata->rxh.next;
+			else
+#endif
 			p = memstr(p, payload_end - p, boundary);
 			if (!p)
 				break;
@@ -635,6 +884,12 @@ static int httpd_handle_request(struct httpd_instance *inst,
 			}
 
 			val->size = formdata_end[i] - val->data;
+
+#ifdef CONFIG_NET_RX_HASH
+			if (val->data == pdata->rxh.data && pdata->rxh.next)
+				val->digest = pdata->rxh.digest;
+#endif
+
 			req->form.count++;
 		}
 
@@ -744,13 +999,17 @@ static void httpd_cleanup(struct httpd_instance *inst, struct tcb_cb_data *cbd)
 	if (pdata->is_uploading)
 		is_uploading = 0;
 
+#ifdef CONFIG_NET_RX_HASH
+	hash_stream_abort(&pdata->rxh.hs);
+#endif
+
 	/* call uri handler */
 	if (req->urih) {
 		assert((size_t) req->urih->cb > CONFIG_SYS_SDRAM_BASE);
 		req->urih->cb(HTTP_CB_CLOSED, req, resp);
 	}
 
-	free(pdata);
+	obj_pool_free(OBJ_POOL_GET(httpd_pdata), pdata);
 }
 
 static void httpd_tcp_callback(struct tcb_cb_data *cbd)
@@ -764,12 +1023,15 @@ static void httpd_tcp_callback(struct tcb_cb_data *cbd)
 	}
 
 	if (cbd->status == TCP_CB_NEW_CONN) {
-		cbd->pdata = calloc(1, sizeof(struct httpd_tcp_pdata));
+		cbd->pdata = obj_pool_alloc(OBJ_POOL_GET(httpd_pdata),
+					    sizeof(struct httpd_tcp_pdata));
 		if (!cbd->pdata) {
 			tcp_close_conn(cbd->conn, 1);
 			return;
 		}
 
+		memset(cbd->pdata, 0, sizeof(struct httpd_tcp_pdata));
+
 		tcp_conn_set_pdata(cbd->conn, cbd->pdata);
 	}
 
@@ -567,6 +567,7 @@ restart:
 	 */
 	for (;;) {
 		WATCHDOG_RESET();
+		serial_poll_tx();
 #ifdef CONFIG_SHOW_ACTIVITY
 		show_activity(1);
 #endif
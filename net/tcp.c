@@ -12,6 +12,7 @@
 #include <watchdog.h>
 #include <malloc.h>
 #include <net.h>
+#include <obj_pool.h>
 #include <command.h>
 #include <div64.h>
 
@@ -64,6 +65,11 @@ struct tcp_conn {
 	void *pdata;
 };
 
+/* Connections beyond this come from the heap */
+#define TCP_CONN_POOL_SIZE	8
+
+OBJ_POOL(tcp_conn, sizeof(struct tcp_conn), TCP_CONN_POOL_SIZE);
+
 struct tcp_listen {
 	struct list_head node;
 
@@ -157,7 +163,7 @@ static struct tcp_conn *tcp_conn_find(__be32 remoteip, __be16 remoteport,
 static void tcp_conn_del(struct tcp_conn *c)
 {
 	list_del(&c->node);
-	free(c);
+	obj_pool_free(OBJ_POOL_GET(tcp_conn), c);
 }
 
 static u16 tcp_checksum_compute(void *data, int len, __be32 sip,
@@ -257,7 +263,7 @@ static struct tcp_conn *tcp_conn_create(__be32 remoteip, struct tcp_hdr *tcp,
 	u8 *optend;
 	u8 opt[8];
 
-	c = malloc(sizeof(struct tcp_conn));
+	c = obj_pool_alloc(OBJ_POOL_GET(tcp_conn), sizeof(struct tcp_conn));
 	if (!c) {
 		tcp_send_packet(c, TCP_RST | TCP_ACK, 1, c->peer_seq, NULL, 0);
 		return NULL;
@@ -9,6 +9,7 @@
 #include <common.h>
 #include <command.h>
 #include <efi_loader.h>
+#include <hash.h>
 #include <mapmem.h>
 #include <net.h>
 #include <net/tftp.h>
@@ -164,6 +165,16 @@ static void mcast_cleanup(void)
 
 #endif	/* CONFIG_MCAST_TFTP */
 
+#ifdef CONFIG_NET_RX_HASH
+/* Hash of the data received, set up by the caller of tftp_start() */
+static struct hash_stream *tftp_rx_hash;
+
+void tftp_set_rx_hash(struct hash_stream *hs)
+{
+	tftp_rx_hash = hs;
+}
+#endif
+
 static inline void store_block(int block, uchar *src, unsigned len)
 {
 	ulong offset = block * tftp_block_size + tftp_block_wrap_offset;
@@ -196,6 +207,10 @@ static inline void store_block(int block, uchar *src, unsigned len)
 		memcpy(ptr, src, len);
 		unmap_sysmem(ptr);
 	}
+#ifdef CONFIG_NET_RX_HASH
+	if (tftp_rx_hash)
+		hash_stream_update(tftp_rx_hash, offset, src, len);
+#endif
 #ifdef CONFIG_MCAST_TFTP
 	if (tftp_mcast_active)
 		ext2_set_bit(block, tftp_mcast_bitmap);
@@ -214,6 +229,10 @@ static void new_transfer(void)
 #ifdef CONFIG_CMD_TFTPPUT
 	tftp_put_final_block_sent = 0;
 #endif
+#ifdef CONFIG_NET_RX_HASH
+	if (tftp_rx_hash)
+		hash_stream_reset(tftp_rx_hash);
+#endif
 }
 
 #ifdef CONFIG_CMD_TFTPPUT
@@ -43,9 +43,22 @@ static cmd_tbl_t cmd_ut_sub[] = {
 #if defined(CONFIG_UT_ENV)
 	U_BOOT_CMD_MKENT(env, CONFIG_SYS_MAXARGS, 1, do_ut_env, "", ""),
 #endif
+#ifdef CONFIG_UT_HASH
+	U_BOOT_CMD_MKENT(hash, CONFIG_SYS_MAXARGS, 1, do_ut_hash, "", ""),
+#endif
+#ifdef CONFIG_UT_MEM
+	U_BOOT_CMD_MKENT(mem, CONFIG_SYS_MAXARGS, 1, do_ut_mem, "", ""),
+#endif
+#ifdef CONFIG_UT_OBJ_POOL
+	U_BOOT_CMD_MKENT(obj_pool, CONFIG_SYS_MAXARGS, 1, do_ut_obj_pool, "",
+			 ""),
+#endif
 #ifdef CONFIG_UT_OVERLAY
 	U_BOOT_CMD_MKENT(overlay, CONFIG_SYS_MAXARGS, 1, do_ut_overlay, "", ""),
 #endif
+#ifdef CONFIG_UT_SCRATCH
+	U_BOOT_CMD_MKENT(scratch, CONFIG_SYS_MAXARGS, 1, do_ut_scratch, "", ""),
+#endif
 #ifdef CONFIG_UT_TIME
 	U_BOOT_CMD_MKENT(time, CONFIG_SYS_MAXARGS, 1, do_ut_time, "", ""),
 #endif
@@ -99,9 +112,21 @@ static char ut_help_text[] =
 #ifdef CONFIG_UT_ENV
 	"ut env [test-name]\n"
 #endif
+#ifdef CONFIG_UT_HASH
+	"ut hash [test-name]\n"
+#endif
+#ifdef CONFIG_UT_MEM
+	"ut mem [test-name]\n"
+#endif
+#ifdef CONFIG_UT_OBJ_POOL
+	"ut obj_pool [test-name]\n"
+#endif
 #ifdef CONFIG_UT_OVERLAY
 	"ut overlay [test-name]\n"
 #endif
+#ifdef CONFIG_UT_SCRATCH
+	"ut scratch [test-name]\n"
+#endif
 #ifdef CONFIG_UT_TIME
 	"ut time - Very basic test of time functions\n"
 #endif
@@ -8,6 +8,7 @@
 #include <command.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <mblock.h>
 #include <asm/io.h>
 
 #include <u-boot/zlib.h>
@@ -292,6 +293,56 @@ static int uncompress_using_lz4(struct unit_test_state *uts,
 	return (ret != 0);
 }
 
+/*
+ * The *_cb() decompressors with a NULL input hook, as used by bootm for
+ * images which are not verified while decompressing
+ */
+static int uncompress_using_gzip_cb(struct unit_test_state *uts,
+				    void *in, unsigned long in_size,
+				    void *out, unsigned long out_max,
+				    unsigned long *out_size)
+{
+	int ret;
+	unsigned long inout_size = in_size;
+
+	ret = gunzip_cb(out, out_max, in, &inout_size, NULL, NULL);
+	if (out_size)
+		*out_size = inout_size;
+
+	return ret;
+}
+
+static int uncompress_using_lzma_cb(struct unit_test_state *uts,
+				    void *in, unsigned long in_size,
+				    void *out, unsigned long out_max,
+				    unsigned long *out_size)
+{
+	int ret;
+	SizeT inout_size = out_max;
+
+	ret = lzmaBuffToBuffDecompressCb(out, &inout_size, in, in_size, NULL,
+					 NULL);
+	if (out_size)
+		*out_size = inout_size;
+
+	return (ret != SZ_OK);
+}
+
+static int uncompress_using_lz4_cb(struct unit_test_state *uts,
+				   void *in, unsigned long in_size,
+				   void *out, unsigned long out_max,
+				   unsigned long *out_size)
+{
+	int ret;
+	size_t output_size = out_max;
+
+	ret = ulz4fn_cb(in, in_size, out, &output_size, NULL, NULL);
+	if (out_size)
+		*out_size = output_size;
+
+	return (ret != 0);
+}
+
 #define errcheck(statement) if (!(statement)) { \
 	fprintf(stderr, "\tFailed: %s\n", #statement); \
 	ret = 1; \
@@ -424,6 +475,97 @@ static int compression_test_lzma(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_lzma, 0);
 
+static int compression_test_gzip_cb(struct unit_test_state *uts)
+{
+	return run_test(uts, "gzip_cb", compress_using_gzip,
+			uncompress_using_gzip_cb);
+}
+COMPRESSION_TEST(compression_test_gzip_cb, 0);
+
+static int compression_test_lzma_cb(struct unit_test_state *uts)
+{
+	return run_test(uts, "lzma_cb", compress_using_lzma,
+			uncompress_using_lzma_cb);
+}
+COMPRESSION_TEST(compression_test_lzma_cb, 0);
+
+static int compression_test_lz4_cb(struct unit_test_state *uts)
+{
+	return run_test(uts, "lz4_cb", compress_using_lz4,
+			uncompress_using_lz4_cb);
+}
+COMPRESSION_TEST(compression_test_lz4_cb, 0);
+
+#define LZMA_BENCH_LOOPS	2000
+
+static void *lzma_bench_alloc(void *p, size_t size) { return malloc(size); }
+static void lzma_bench_free(void *p, void *address) { free(address); }
+
+static void lzma_bench_print(const char *name, ulong us, ulong bytes)
+{
+	printf("  %-26s %8lu us (%lu KiB/s)\n", name, us,
+	       us ? (ulong)((u64)bytes * 1000000 / 1024 / us) : 0);
+}
+
+/*
+ * Decompress the test stream many times, with the probability model
+ * allocated from the heap for each call as the decoder used to do, and
+ * through lzmaBuffToBuffDecompress() which may use a static workspace.
+ * For a stream this small the cost of setting up the model dominates;
+ * run "lzmadec" on a real kernel for the throughput of the decoder itself.
+ */
+static int compression_test_lzma_bench(struct unit_test_state *uts)
+{
+	ISzAlloc heap = { lzma_bench_alloc, lzma_bench_free };
+	const unsigned char *in = (const unsigned char *)lzma_compressed;
+	ulong plain_size = strlen(plain);
+	ulong start, t_heap, t_tools;
+	ELzmaStatus status;
+	SizeT out_size, in_size;
+	char *out;
+	int i;
+
+	out = malloc(TEST_BUFFER_SIZE);
+	ut_assertnonnull(out);
+
+	start = timer_get_us();
+	for (i = 0; i < LZMA_BENCH_LOOPS; i++) {
+		out_size = TEST_BUFFER_SIZE;
+		in_size = lzma_compressed_size - LZMA_PROPS_SIZE - 8;
+		ut_asserteq(SZ_OK, LzmaDecode((Byte *)out, &out_size,
+					      in + LZMA_PROPS_SIZE + 8,
+					      &in_size, in, LZMA_PROPS_SIZE,
+					      LZMA_FINISH_END, &status,
+					      &heap));
+	}
+	t_heap = timer_get_us() - start;
+	ut_asserteq(plain_size, out_size);
+	ut_assertok(memcmp(plain, out, plain_size));
+
+	start = timer_get_us();
+	for (i = 0; i < LZMA_BENCH_LOOPS; i++) {
+		out_size = TEST_BUFFER_SIZE;
+		ut_asserteq(SZ_OK, lzmaBuffToBuffDecompress((unsigned char *)out,
+							    &out_size,
+							    (unsigned char *)in,
+							    lzma_compressed_size));
+	}
+	t_tools = timer_get_us() - start;
+	ut_asserteq(plain_size, out_size);
+	ut_assertok(memcmp(plain, out, plain_size));
+
+	free(out);
+
+	printf("%d x %lu bytes:\n", LZMA_BENCH_LOOPS, plain_size);
+	lzma_bench_print("LzmaDecode(), heap model:", t_heap,
+			 LZMA_BENCH_LOOPS * plain_size);
+	lzma_bench_print("lzmaBuffToBuffDecompress():", t_tools,
+			 LZMA_BENCH_LOOPS * plain_size);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_lzma_bench, 0);
+
 static int compression_test_lzo(struct unit_test_state *uts)
 {
 	return run_test(uts, "lzo", compress_using_lzo, uncompress_using_lzo);
@@ -436,6 +578,160 @@ static int compression_test_lz4(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_lz4, 0);
 
+#define MBLOCK_TEST_BLOCKS	3
+
+/* Wrap @count copies of a compressed plain[] in a multi-block payload */
+static int mblock_wrap(int comp, const char *stream, ulong stream_size,
+		       uint count, void *out, ulong out_max, ulong *out_size)
+{
+	struct mblock_header *hdr = out;
+	struct mblock_entry *ent = (void *)(hdr + 1);
+	ulong offset = sizeof(*hdr) + count * sizeof(*ent);
+	ulong step = ALIGN(stream_size, MBLOCK_ALIGN);
+	ulong size = offset + (count - 1) * step + stream_size;
+	ulong plain_size = strlen(plain);
+	uint i;
+
+	if (size > out_max)
+		return -ENOSPC;
+
+	memset(out, '\0', size);
+	hdr->magic = cpu_to_be32(MBLOCK_MAGIC);
+	hdr->comp = comp;
+	hdr->block_size = cpu_to_be32(plain_size);
+	hdr->size = cpu_to_be32(count * plain_size);
+	hdr->count = cpu_to_be32(count);
+
+	for (i = 0; i < count; i++, offset += step) {
+		ent[i].offset = cpu_to_be32(offset);
+		ent[i].size = cpu_to_be32(stream_size);
+		memcpy(out + offset, stream, stream_size);
+	}
+
+	if (out_size)
+		*out_size = size;
+
+	return 0;
+}
+
+static int compress_using_mblock_lzma(struct unit_test_state *uts,
+				      void *in, unsigned long in_size,
+				      void *out, unsigned long out_max,
+				      unsigned long *out_size)
+{
+	/* There is no lzma compression in u-boot, so fake it. */
+	ut_asserteq(in_size, strlen(plain));
+	ut_asserteq(0, memcmp(plain, in, in_size));
+
+	return mblock_wrap(IH_COMP_LZMA, lzma_compressed,
+			   lzma_compressed_size, 1, out, out_max, out_size);
+}
+
+static int compress_using_mblock_lz4(struct unit_test_state *uts,
+				     void *in, unsigned long in_size,
+				     void *out, unsigned long out_max,
+				     unsigned long *out_size)
+{
+	/* There is no lz4 compression in u-boot, so fake it. */
+	ut_asserteq(in_size, strlen(plain));
+	ut_asserteq(0, memcmp(plain, in, in_size));
+
+	return mblock_wrap(IH_COMP_LZ4, lz4_compressed, lz4_compressed_size,
+			   1, out, out_max, out_size);
+}
+
+static int uncompress_using_mblock(struct unit_test_state *uts,
+				   void *in, unsigned long in_size,
+				   void *out, unsigned long out_max,
+				   unsigned long *out_size)
+{
+	size_t size = out_max;
+	int ret;
+
+	ret = mblock_decompress(out, &size, in, in_size);
+	if (out_size)
+		*out_size = size;
+
+	return ret;
+}
+
+static int compression_test_mblock_lzma(struct unit_test_state *uts)
+{
+	return run_test(uts, "mblock-lzma", compress_using_mblock_lzma,
+			uncompress_using_mblock);
+}
+COMPRESSION_TEST(compression_test_mblock_lzma, 0);
+
+static int compression_test_mblock_lz4(struct unit_test_state *uts)
+{
+	return run_test(uts, "mblock-lz4", compress_using_mblock_lz4,
+			uncompress_using_mblock);
+}
+COMPRESSION_TEST(compression_test_mblock_lz4, 0);
+
+/* Several blocks, decompressed by several workers */
+static int run_mblock_blocks_test(struct unit_test_state *uts, int comp,
+				  const char *stream, ulong stream_size)
+{
+	ulong plain_size = strlen(plain), size;
+	struct mblock_entry *ent;
+	size_t out_size;
+	void *in, *out;
+	uint i;
+
+	in = malloc(TEST_BUFFER_SIZE * MBLOCK_TEST_BLOCKS);
+	out = malloc(plain_size * MBLOCK_TEST_BLOCKS);
+	ut_assertnonnull(in);
+	ut_assertnonnull(out);
+	ent = in + sizeof(struct mblock_header);
+
+	ut_assertok(mblock_wrap(comp, stream, stream_size, MBLOCK_TEST_BLOCKS,
+				in, TEST_BUFFER_SIZE * MBLOCK_TEST_BLOCKS,
+				&size));
+	ut_assertok(mblock_check(in, size));
+
+	out_size = plain_size * MBLOCK_TEST_BLOCKS;
+	ut_assertok(mblock_decompress(out, &out_size, in, size));
+	ut_asserteq(plain_size * MBLOCK_TEST_BLOCKS, out_size);
+	for (i = 0; i < MBLOCK_TEST_BLOCKS; i++)
+		ut_assertok(memcmp(out + i * plain_size, plain, plain_size));
+
+	/* Too small an output buffer is caught before decompressing */
+	out_size = plain_size * MBLOCK_TEST_BLOCKS - 1;
+	ut_asserteq(-ENOSPC, mblock_decompress(out, &out_size, in, size));
+	ut_asserteq(plain_size * MBLOCK_TEST_BLOCKS, out_size);
+
+	/* A block reaching past the end of the payload */
+	ent[MBLOCK_TEST_BLOCKS - 1].size = cpu_to_be32(stream_size + 1);
+	ut_asserteq(-EINVAL, mblock_check(in, size));
+	ent[MBLOCK_TEST_BLOCKS - 1].size = cpu_to_be32(stream_size);
+
+	/* A corrupted block fails the whole payload */
+	memset(in + be32_to_cpu(ent[1].offset) + stream_size / 2, '\x49',
+	       stream_size / 2);
+	out_size = plain_size * MBLOCK_TEST_BLOCKS;
+	ut_assert(mblock_decompress(out, &out_size, in, size));
+
+	free(out);
+	free(in);
+
+	return 0;
+}
+
+static int compression_test_mblock_blocks_lzma(struct unit_test_state *uts)
+{
+	return run_mblock_blocks_test(uts, IH_COMP_LZMA, lzma_compressed,
+				      lzma_compressed_size);
+}
+COMPRESSION_TEST(compression_test_mblock_blocks_lzma, 0);
+
+static int compression_test_mblock_blocks_lz4(struct unit_test_state *uts)
+{
+	return run_mblock_blocks_test(uts, IH_COMP_LZ4, lz4_compressed,
+				      lz4_compressed_size);
+}
+COMPRESSION_TEST(compression_test_mblock_blocks_lz4, 0);
+
 static int compress_using_none(struct unit_test_state *uts,
 			       void *in, unsigned long in_size,
 			       void *out, unsigned long out_max,
@@ -526,6 +822,12 @@ static int compression_test_bootm_lz4(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_bootm_lz4, 0);
 
+static int compression_test_bootm_mblock(struct unit_test_state *uts)
+{
+	return run_bootm_test(uts, IH_COMP_MBLOCK, compress_using_mblock_lzma);
+}
+COMPRESSION_TEST(compression_test_bootm_mblock, 0);
+
 static int compression_test_bootm_none(struct unit_test_state *uts)
 {
 	return run_bootm_test(uts, IH_COMP_NONE, compress_using_none);
@@ -6,6 +6,7 @@
 #include <common.h>
 #include <dm.h>
 #include <fdtdec.h>
+#include <malloc.h>
 #include <spi.h>
 #include <spi_flash.h>
 #include <asm/state.h>
@@ -40,3 +41,48 @@ static int dm_test_spi_flash(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_spi_flash, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/*
+ * Reading a region in one request and one MT7621-style FIFO (32 bytes) at
+ * a time must both return what was written
+ */
+static int dm_test_spi_flash_read(struct unit_test_state *uts)
+{
+	const size_t size = 0x20000, chunk = 32;
+	struct udevice *dev;
+	u8 *pattern, *buf;
+	size_t i;
+
+	ut_asserteq(0, run_command_list(
+		"sb save hostfs - 0 spi.bin 200000;"
+		"sf probe", -1, 0));
+	ut_assertok(uclass_first_device_err(UCLASS_SPI_FLASH, &dev));
+
+	pattern = malloc(size);
+	ut_assertnonnull(pattern);
+	buf = malloc(size);
+	ut_assertnonnull(buf);
+
+	for (i = 0; i < size; i++)
+		pattern[i] = i * 7 + (i >> 10);
+
+	ut_assertok(spi_flash_erase_dm(dev, 0, size));
+	ut_assertok(spi_flash_write_dm(dev, 0, size, pattern));
+
+	memset(buf, 0, size);
+	ut_assertok(spi_flash_read_dm(dev, 0, size, buf));
+	ut_assertok(memcmp(buf, pattern, size));
+
+	memset(buf, 0, size);
+	for (i = 0; i < size; i += chunk)
+		ut_assertok(spi_flash_read_dm(dev, i, chunk, buf + i));
+	ut_assertok(memcmp(buf, pattern, size));
+
+	free(buf);
+	free(pattern);
+
+	sandbox_sf_unbind_emul(state_get_current(), 0, 0);
+
+	return 0;
+}
+DM_TEST(dm_test_spi_flash_read, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
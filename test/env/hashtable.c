@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests and micro-benchmark for the environment hash table
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <search.h>
+#include <test/env.h>
+#include <test/ut.h>
+
+#define HTAB_BENCH_VARS		3000
+#define HTAB_BENCH_SETS		200
+
+static int htab_set(struct hsearch_data *htab, const char *key,
+		    const char *data)
+{
+	ENTRY e, *ep;
+
+	e.key = key;
+	e.data = (char *)data;
+
+	return !hsearch_r(e, ENTER, &ep, htab, H_PROGRAMMATIC);
+}
+
+/* Check that "name=value" entries separated by "sep" are sorted by name */
+static int htab_check_sorted(struct unit_test_state *uts, const char *buf,
+			     const char sep, unsigned int *count)
+{
+	const char *prev = NULL, *p = buf;
+	size_t prev_len = 0, len;
+
+	*count = 0;
+
+	while (*p) {
+		len = strchr(p, '=') - p;
+
+		if (prev) {
+			int cmp = strncmp(prev, p, min(prev_len, len));
+
+			ut_assert(cmp < 0 || (!cmp && prev_len < len));
+		}
+
+		prev = p;
+		prev_len = len;
+		(*count)++;
+
+		p = strchr(p, sep);
+		ut_assertnonnull(p);
+		p++;
+	}
+
+	return 0;
+}
+
+/* Test that export is sorted by key after inserting and deleting */
+static int env_test_htab_export_order(struct unit_test_state *uts)
+{
+	struct hsearch_data htab = { };
+	char *buf = NULL;
+
+	ut_assert(hcreate_r(64, &htab));
+
+	ut_assertok(htab_set(&htab, "ipaddr", "192.168.1.1"));
+	ut_assertok(htab_set(&htab, "bootcmd", "run boot_a"));
+	ut_assertok(htab_set(&htab, "serverip", "192.168.1.2"));
+	ut_assertok(htab_set(&htab, "boot_a", "bootm"));
+	ut_assertok(htab_set(&htab, "bootdelay", "3"));
+	ut_assertok(htab_set(&htab, "baudrate", "115200"));
+	ut_assertok(htab_set(&htab, "bootcmd", "run boot_b"));
+	ut_assert(hdelete_r("serverip", &htab, 0));
+
+	ut_assert(hexport_r(&htab, '\n', 0, &buf, 0, 0, NULL) > 0);
+	ut_asserteq_str("baudrate=115200\n"
+			"boot_a=bootm\n"
+			"bootcmd=run boot_b\n"
+			"bootdelay=3\n"
+			"ipaddr=192.168.1.1\n", buf);
+
+	/* Importing the exported text gives the same table */
+	ut_assert(himport_r(&htab, buf, strlen(buf), '\n', 0, 0, 0, NULL));
+	ut_asserteq(5, htab.filled);
+	free(buf);
+	buf = NULL;
+
+	ut_assertok(htab_set(&htab, "serverip", "192.168.1.3"));
+	ut_assert(hdelete_r("baudrate", &htab, 0));
+	ut_assert(hdelete_r("ipaddr", &htab, 0));
+
+	ut_assert(hexport_r(&htab, '\n', 0, &buf, 0, 0, NULL) > 0);
+	ut_asserteq_str("boot_a=bootm\n"
+			"bootcmd=run boot_b\n"
+			"bootdelay=3\n"
+			"serverip=192.168.1.3\n", buf);
+	free(buf);
+
+	hdestroy_r(&htab);
+
+	return 0;
+}
+ENV_TEST(env_test_htab_export_order, 0);
+
+/* Import, export and set with a few thousand variables */
+static int env_test_htab_bench(struct unit_test_state *uts)
+{
+	struct hsearch_data htab = { };
+	unsigned long start, t_import, t_export, t_set, t_saveenv;
+	unsigned int i, count;
+	char *env, *p, *buf = NULL;
+	char key[16], val[32];
+	size_t size;
+
+	size = HTAB_BENCH_VARS * 32 + 1;
+	env = calloc(1, size);
+	ut_assertnonnull(env);
+
+	/* Keys out of order, as when importing a hand-written text file */
+	for (i = 0, p = env; i < HTAB_BENCH_VARS; i++) {
+		p += sprintf(p, "var%04u=value%u",
+			     (i * 7919) % HTAB_BENCH_VARS, i);
+		p++;
+	}
+
+	start = timer_get_us();
+	ut_assert(himport_r(&htab, env, p - env + 1, '\0', 0, 0, 0, NULL));
+	t_import = timer_get_us() - start;
+	ut_asserteq(HTAB_BENCH_VARS, htab.filled);
+	ut_assert(htab.size >= 2 * HTAB_BENCH_VARS);
+
+	start = timer_get_us();
+	ut_assert(hexport_r(&htab, '\0', 0, &buf, 0, 0, NULL) > 0);
+	t_export = timer_get_us() - start;
+	ut_assertok(htab_check_sorted(uts, buf, '\0', &count));
+	ut_asserteq(HTAB_BENCH_VARS, count);
+	free(buf);
+	buf = NULL;
+
+	start = timer_get_us();
+	for (i = 0; i < HTAB_BENCH_VARS; i++) {
+		snprintf(key, sizeof(key), "var%04u", i);
+		snprintf(val, sizeof(val), "new%u", i);
+		ut_assertok(htab_set(&htab, key, val));
+	}
+	t_set = timer_get_us() - start;
+
+	/* Scripted provisioning: "env set" followed by "saveenv" */
+	start = timer_get_us();
+	for (i = 0; i < HTAB_BENCH_SETS; i++) {
+		snprintf(key, sizeof(key), "prov%04u", i);
+		ut_assertok(htab_set(&htab, key, "1"));
+		ut_assert(hexport_r(&htab, '\0', 0, &buf, 0, 0, NULL) > 0);
+		free(buf);
+		buf = NULL;
+	}
+	t_saveenv = timer_get_us() - start;
+
+	ut_assert(hexport_r(&htab, '\0', 0, &buf, 0, 0, NULL) > 0);
+	ut_assertok(htab_check_sorted(uts, buf, '\0', &count));
+	ut_asserteq(HTAB_BENCH_VARS + HTAB_BENCH_SETS, count);
+	free(buf);
+
+	printf("%u variables, table size %u:\n", HTAB_BENCH_VARS, htab.size);
+	printf("  import:       %8lu us\n", t_import);
+	printf("  export:       %8lu us\n", t_export);
+	printf("  set:          %8lu us (%lu ns/op)\n", t_set,
+	       t_set * 1000 / HTAB_BENCH_VARS);
+	printf("  set + export: %8lu us (%lu us/op)\n", t_saveenv,
+	       t_saveenv / HTAB_BENCH_SETS);
+
+	hdestroy_r(&htab);
+	free(env);
+
+	return 0;
+}
+ENV_TEST(env_test_htab_bench, 0);
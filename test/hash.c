@@ -0,0 +1,268 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Known-answer and consistency tests for the software hash algorithms
+ */
+
+#include <common.h>
+#include <command.h>
+#include <hash.h>
+#include <malloc.h>
+#include <test/hash.h>
+#include <test/suites.h>
+#include <test/ut.h>
+
+#define MSG_448	"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"
+
+/* A NULL message stands for one million repetitions of 'a' */
+static const struct {
+	const char *algo;
+	const char *msg;
+	const char *digest;
+} hash_kats[] = {
+	{ "crc32", "123456789", "cbf43926" },
+	{ "crc32", "abc", "352441c2" },
+	{ "crc32", NULL, "dc25bfbc" },
+	{ "md5", "", "d41d8cd98f00b204e9800998ecf8427e" },
+	{ "md5", "abc", "900150983cd24fb0d6963f7d28e17f72" },
+	{ "md5", MSG_448, "8215ef0796a20bcaaae116d3876c664a" },
+	{ "md5", NULL, "7707d6ae4e027c70eea2a935c2296f21" },
+	{ "sha1", "", "da39a3ee5e6b4b0d3255bfef95601890afd80709" },
+	{ "sha1", "abc", "a9993e364706816aba3e25717850c26c9cd0d89d" },
+	{ "sha1", MSG_448, "84983e441c3bd26ebaae4aa1f95129e5e54670f1" },
+	{ "sha1", NULL, "34aa973cd4c4daa4f61eeb2bdbad27316534016f" },
+	{ "sha256", "",
+	  "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+	{ "sha256", "abc",
+	  "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+	{ "sha256", MSG_448,
+	  "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+	{ "sha256", NULL,
+	  "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0" },
+};
+
+static const char *const hash_algos[] = { "crc32", "md5", "sha1", "sha256" };
+
+static int hash_million_a(struct hash_algo *algo, uint8_t *output)
+{
+	char buf[1000];
+	void *ctx;
+	int i;
+
+	memset(buf, 'a', sizeof(buf));
+
+	if (algo->hash_init(algo, &ctx))
+		return -1;
+
+	for (i = 0; i < 1000; i++) {
+		if (algo->hash_update(algo, ctx, buf, sizeof(buf), i == 999))
+			return -1;
+	}
+
+	return algo->hash_finish(algo, ctx, output, HASH_MAX_DIGEST_SIZE);
+}
+
+/*
+ * Check each algorithm against the FIPS 180 / RFC 1321 test vectors, and
+ * CRC-32 against its check value
+ */
+static int hash_test_kat(struct unit_test_state *uts)
+{
+	uint8_t output[HASH_MAX_DIGEST_SIZE], expect[HASH_MAX_DIGEST_SIZE];
+	struct hash_algo *algo;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(hash_kats); i++) {
+		ut_assertok(hash_progressive_lookup_algo(hash_kats[i].algo,
+							 &algo));
+
+		ut_assertok(hash_parse_string(algo->name, hash_kats[i].digest,
+					      expect));
+
+		if (hash_kats[i].msg) {
+			ut_assertok(hash_block(algo->name, hash_kats[i].msg,
+					       strlen(hash_kats[i].msg),
+					       output, NULL));
+		} else {
+			ut_assertok(hash_million_a(algo, output));
+		}
+
+		ut_assertf(!memcmp(output, expect, algo->digest_size),
+			   "%s vector %d mismatch\n", algo->name, i);
+	}
+
+	return 0;
+}
+HASH_TEST(hash_test_kat, 0);
+
+/*
+ * The progressive CRC-32 must give the digest in the same byte order as
+ * the one-shot crc32_wd_buf(), which "crc32 -v" and FIT images rely on
+ */
+static int hash_test_crc32(struct unit_test_state *uts)
+{
+	static const char msg[] = "123456789";
+	static const uint8_t expect[] = { 0xcb, 0xf4, 0x39, 0x26 };
+	uint8_t output[HASH_MAX_DIGEST_SIZE];
+	struct hash_algo *algo;
+	void *ctx;
+	int i;
+
+	ut_assertok(hash_progressive_lookup_algo("crc32", &algo));
+	ut_asserteq(sizeof(expect), algo->digest_size);
+
+	ut_assertok(algo->hash_init(algo, &ctx));
+	for (i = 0; i < strlen(msg); i++)
+		ut_assertok(algo->hash_update(algo, ctx, msg + i, 1,
+					      i == strlen(msg) - 1));
+	ut_assertok(algo->hash_finish(algo, ctx, output, sizeof(output)));
+	ut_assertok(memcmp(output, expect, sizeof(expect)));
+
+	memset(output, 0, sizeof(output));
+	ut_assertok(hash_block("crc32", msg, strlen(msg), output, NULL));
+	ut_assertok(memcmp(output, expect, sizeof(expect)));
+
+	return 0;
+}
+HASH_TEST(hash_test_crc32, 0);
+
+/*
+ * The same data must hash identically whatever its alignment and however
+ * it is split across updates, so that both the word-aligned fast path
+ * and the byte-wise fallback get exercised.
+ */
+static int hash_test_split(struct unit_test_state *uts)
+{
+	static const unsigned int chunks[] = { 1, 3, 63, 64, 65, 200, 4096 };
+	uint8_t expect[HASH_MAX_DIGEST_SIZE], output[HASH_MAX_DIGEST_SIZE];
+	const unsigned int len = 4099;
+	struct hash_algo *algo;
+	unsigned int pos, n;
+	uint8_t *buf;
+	void *ctx;
+	int i, j, off;
+
+	buf = malloc(len + sizeof(u32));
+	ut_assertnonnull(buf);
+
+	for (i = 0; i < ARRAY_SIZE(hash_algos); i++) {
+		ut_assertok(hash_progressive_lookup_algo(hash_algos[i], &algo));
+
+		for (pos = 0; pos < len; pos++)
+			buf[pos] = pos * 7 + (pos >> 8);
+		ut_assertok(hash_block(algo->name, buf, len, expect, NULL));
+
+		for (off = 1; off < sizeof(u32); off++) {
+			memmove(buf + off, buf + off - 1, len);
+			ut_assertok(hash_block(algo->name, buf + off, len,
+					       output, NULL));
+			ut_assertf(!memcmp(output, expect, algo->digest_size),
+				   "%s differs at offset %d\n", algo->name,
+				   off);
+		}
+
+		/* The data now sits at the last, unaligned offset */
+		off--;
+		for (j = 0; j < ARRAY_SIZE(chunks); j++) {
+			ut_assertok(algo->hash_init(algo, &ctx));
+			for (pos = 0; pos < len; pos += n) {
+				n = min(chunks[j], len - pos);
+				ut_assertok(algo->hash_update(algo, ctx,
+							      buf + off + pos,
+							      n,
+							      pos + n == len));
+			}
+			ut_assertok(algo->hash_finish(algo, ctx, output,
+						      sizeof(output)));
+			ut_assertf(!memcmp(output, expect, algo->digest_size),
+				   "%s differs with %u-byte updates\n",
+				   algo->name, chunks[j]);
+		}
+	}
+
+	free(buf);
+
+	return 0;
+}
+HASH_TEST(hash_test_split, 0);
+
+static void hash_stream_start_cb(struct hash_stream *hs)
+{
+	hs->len = *(ulong *)hs->priv;
+}
+
+/* Feed @buf to a stream in @blk-sized pieces, sending each piece twice */
+static void hash_stream_feed(struct hash_stream *hs, const uint8_t *buf,
+			     ulong len, ulong blk)
+{
+	ulong pos, n;
+
+	for (pos = 0; pos < len; pos += n) {
+		n = min(blk, len - pos);
+		hash_stream_update(hs, pos, buf + pos, n);
+		hash_stream_update(hs, pos, buf + pos, n);
+	}
+}
+
+/*
+ * A stream hash must give the same digest as hashing the loaded data in
+ * one go, ignoring retransmitted pieces and honouring the skip and length
+ * limits, and must refuse to produce a digest when data is missing.
+ */
+static int hash_test_stream(struct unit_test_state *uts)
+{
+	uint8_t expect[HASH_MAX_DIGEST_SIZE], output[HASH_MAX_DIGEST_SIZE];
+	const ulong len = 3000, skip = 64;
+	struct hash_stream hs;
+	ulong pos, limit;
+	uint8_t buf[3000];
+	int i;
+
+	for (pos = 0; pos < len; pos++)
+		buf[pos] = pos * 13 + (pos >> 8);
+
+	for (i = 0; i < ARRAY_SIZE(hash_algos); i++) {
+		ut_assertok(hash_stream_start(&hs, hash_algos[i], skip));
+
+		/* Whole stream after the skipped header */
+		hash_stream_feed(&hs, buf, len, 512);
+		ut_asserteq(len - skip, hs.hashed);
+		ut_assertok(hash_stream_finish(&hs, output, sizeof(output)));
+		ut_assertok(hash_block(hs.algo->name, buf + skip, len - skip,
+				       expect, NULL));
+		ut_assert(!memcmp(expect, output, hs.algo->digest_size));
+
+		/* Length set by the start callback, transfer restarted */
+		ut_assertok(hash_stream_start(&hs, hash_algos[i], skip));
+		limit = 1000;
+		hs.start = hash_stream_start_cb;
+		hs.priv = &limit;
+		hash_stream_feed(&hs, buf, 700, 100);
+		hash_stream_reset(&hs);
+		hash_stream_feed(&hs, buf, len, 1468);
+		ut_asserteq(limit, hs.hashed);
+		ut_assertok(hash_stream_finish(&hs, output, sizeof(output)));
+		ut_assertok(hash_block(hs.algo->name, buf + skip, limit,
+				       expect, NULL));
+		ut_assert(!memcmp(expect, output, hs.algo->digest_size));
+
+		/* A missing piece makes the digest unusable */
+		ut_assertok(hash_stream_start(&hs, hash_algos[i], 0));
+		hash_stream_update(&hs, 0, buf, 512);
+		hash_stream_update(&hs, 1024, buf + 1024, 512);
+		ut_assert(hs.broken);
+		ut_asserteq(-EIO, hash_stream_finish(&hs, output,
+						     sizeof(output)));
+		ut_assertnull(hs.ctx);
+	}
+
+	return 0;
+}
+HASH_TEST(hash_test_stream, 0);
+
+int do_ut_hash(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	struct unit_test *tests = ll_entry_start(struct unit_test, hash_test);
+	const int n_ents = ll_entry_count(struct unit_test, hash_test);
+
+	return cmd_ut_category("hash", tests, n_ents, argc, argv);
+}
@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for memcpy(), memmove() and memset(), mostly for the alignment
+ * handling of the arch versions selected by USE_ARCH_MEMCPY/MEMSET
+ */
+
+#include <common.h>
+#include <command.h>
+#include <malloc.h>
+#include <test/mem.h>
+#include <test/suites.h>
+#include <test/ut.h>
+
+#define MEM_TEST_LEN	300
+
+/* Room for the offsets below on either side of the data */
+#define MEM_TEST_PAD	64
+#define MEM_TEST_SIZE	(MEM_TEST_PAD + MEM_TEST_LEN + MEM_TEST_PAD + 8)
+
+/* Lengths around the word and 32-byte block boundaries */
+static const unsigned int mem_test_lens[] = {
+	0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 35, 63, 64, 65,
+	67, 95, 96, 97, 127, 128, 129, 255, 256, 257, MEM_TEST_LEN,
+};
+
+/* Fill a buffer with a pattern which differs for each byte and seed */
+static void mem_test_fill(u8 *buf, unsigned int seed)
+{
+	int i;
+
+	for (i = 0; i < MEM_TEST_SIZE; i++)
+		buf[i] = i * 13 + seed + (i >> 8);
+}
+
+/* Byte-wise reference copy, correct for overlapping buffers too */
+static void mem_test_move(u8 *dst, const u8 *src, unsigned int len)
+{
+	int i;
+
+	if (dst < src) {
+		for (i = 0; i < len; i++)
+			dst[i] = src[i];
+	} else {
+		for (i = len - 1; i >= 0; i--)
+			dst[i] = src[i];
+	}
+}
+
+/* Check every combination of destination and source misalignment */
+static int mem_test_memcpy(struct unit_test_state *uts)
+{
+	u8 *buf, *src, *expect;
+	int i, doff, soff;
+	unsigned int len;
+
+	buf = malloc(3 * MEM_TEST_SIZE);
+	ut_assertnonnull(buf);
+	src = buf + MEM_TEST_SIZE;
+	expect = src + MEM_TEST_SIZE;
+
+	mem_test_fill(src, 1);
+
+	for (i = 0; i < ARRAY_SIZE(mem_test_lens); i++) {
+		len = mem_test_lens[i];
+		for (doff = 0; doff < 8; doff++) {
+			for (soff = 0; soff < 8; soff++) {
+				mem_test_fill(buf, 2);
+				mem_test_fill(expect, 2);
+				mem_test_move(expect + doff, src + soff, len);
+
+				ut_asserteq_ptr(buf + doff,
+						memcpy(buf + doff, src + soff,
+						       len));
+				ut_assertf(!memcmp(buf, expect, MEM_TEST_SIZE),
+					   "len %u dst+%d src+%d\n", len, doff,
+					   soff);
+			}
+		}
+	}
+
+	free(buf);
+
+	return 0;
+}
+MEM_TEST(mem_test_memcpy, 0);
+
+/* Overlap in both directions, by less and more than a block */
+static int mem_test_memmove(struct unit_test_state *uts)
+{
+	u8 *buf, *expect;
+	int i, delta, soff;
+	unsigned int len;
+
+	buf = malloc(2 * MEM_TEST_SIZE);
+	ut_assertnonnull(buf);
+	expect = buf + MEM_TEST_SIZE;
+
+	for (i = 0; i < ARRAY_SIZE(mem_test_lens); i++) {
+		len = mem_test_lens[i];
+		for (delta = -MEM_TEST_PAD; delta <= MEM_TEST_PAD; delta++) {
+			for (soff = 0; soff < 4; soff++) {
+				u8 *src = buf + MEM_TEST_PAD + soff;
+				u8 *ref = expect + MEM_TEST_PAD + soff;
+
+				mem_test_fill(buf, 3);
+				mem_test_fill(expect, 3);
+				mem_test_move(ref + delta, ref, len);
+
+				ut_asserteq_ptr(src + delta,
+						memmove(src + delta, src, len));
+				ut_assertf(!memcmp(buf, expect, MEM_TEST_SIZE),
+					   "len %u src+%d by %d\n", len, soff,
+					   delta);
+			}
+		}
+	}
+
+	free(buf);
+
+	return 0;
+}
+MEM_TEST(mem_test_memmove, 0);
+
+/* Only the low byte of the value counts */
+static int mem_test_memset(struct unit_test_state *uts)
+{
+	static const int values[] = { 0, 0xa5, 0x1ff, -1 };
+	u8 *buf, *expect;
+	int i, j, k, off;
+	unsigned int len;
+
+	buf = malloc(2 * MEM_TEST_SIZE);
+	ut_assertnonnull(buf);
+	expect = buf + MEM_TEST_SIZE;
+
+	for (i = 0; i < ARRAY_SIZE(mem_test_lens); i++) {
+		len = mem_test_lens[i];
+		for (off = 0; off < 8; off++) {
+			for (j = 0; j < ARRAY_SIZE(values); j++) {
+				mem_test_fill(buf, 4);
+				mem_test_fill(expect, 4);
+				for (k = 0; k < len; k++)
+					expect[off + k] = values[j];
+
+				ut_asserteq_ptr(buf + off,
+						memset(buf + off, values[j],
+						       len));
+				ut_assertf(!memcmp(buf, expect, MEM_TEST_SIZE),
+					   "len %u dst+%d value %x\n", len,
+					   off, values[j]);
+			}
+		}
+	}
+
+	free(buf);
+
+	return 0;
+}
+MEM_TEST(mem_test_memset, 0);
+
+int do_ut_mem(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	struct unit_test *tests = ll_entry_start(struct unit_test, mem_test);
+	const int n_ents = ll_entry_count(struct unit_test, mem_test);
+
+	return cmd_ut_category("mem", tests, n_ents, argc, argv);
+}
@@ -0,0 +1,137 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the fixed-size object pools
+ */
+
+#include <common.h>
+#include <command.h>
+#include <obj_pool.h>
+#include <test/obj_pool.h>
+#include <test/suites.h>
+#include <test/ut.h>
+
+#define UT_OBJ_SIZE	40
+#define UT_OBJ_COUNT	2
+
+OBJ_POOL(ut_obj, UT_OBJ_SIZE, UT_OBJ_COUNT);
+
+/* Start from a fresh pool, as earlier runs leave their statistics behind */
+static struct obj_pool *obj_pool_test_get(void)
+{
+	struct obj_pool *pool = OBJ_POOL_GET(ut_obj);
+
+	pool->free_list = NULL;
+	pool->next = 0;
+	pool->used = 0;
+	pool->peak = 0;
+	pool->allocs = 0;
+	pool->fallbacks = 0;
+
+	return pool;
+}
+
+static bool obj_pool_test_owns(struct obj_pool *pool, void *ptr)
+{
+	return (u8 *)ptr >= pool->mem &&
+	       (u8 *)ptr < pool->mem + pool->count * pool->stride;
+}
+
+static int obj_pool_test_reuse(struct unit_test_state *uts)
+{
+	struct obj_pool *pool = obj_pool_test_get();
+	void *a, *b, *c;
+
+	a = obj_pool_alloc(pool, UT_OBJ_SIZE);
+	ut_assertnonnull(a);
+	b = obj_pool_alloc(pool, 1);
+	ut_assertnonnull(b);
+	ut_assert(obj_pool_test_owns(pool, a));
+	ut_assert(obj_pool_test_owns(pool, b));
+	ut_assert(a != b);
+	ut_asserteq(0, (ulong)a % ARCH_DMA_MINALIGN);
+	ut_asserteq(0, (ulong)b % ARCH_DMA_MINALIGN);
+	ut_asserteq(2, pool->used);
+	ut_asserteq(2, pool->peak);
+
+	/* A freed object is handed out again before anything else */
+	obj_pool_free(pool, a);
+	ut_asserteq(1, pool->used);
+	c = obj_pool_alloc(pool, UT_OBJ_SIZE);
+	ut_asserteq_ptr(a, c);
+	ut_asserteq(2, pool->used);
+
+	/* The free list is last in, first out */
+	obj_pool_free(pool, b);
+	obj_pool_free(pool, c);
+	ut_asserteq(0, pool->used);
+	ut_asserteq_ptr(c, obj_pool_alloc(pool, UT_OBJ_SIZE));
+	ut_asserteq_ptr(b, obj_pool_alloc(pool, UT_OBJ_SIZE));
+	obj_pool_free(pool, b);
+	obj_pool_free(pool, c);
+
+	obj_pool_free(pool, NULL);
+
+	ut_asserteq(0, pool->used);
+	ut_asserteq(2, pool->peak);
+	ut_asserteq(5, pool->allocs);
+	ut_asserteq(0, pool->fallbacks);
+
+	return 0;
+}
+OBJ_POOL_TEST(obj_pool_test_reuse, 0);
+
+static int obj_pool_test_fallback(struct unit_test_state *uts)
+{
+	struct obj_pool *pool = obj_pool_test_get();
+	void *a, *b, *heap, *large;
+
+	/* Too large for the pool */
+	large = obj_pool_alloc(pool, UT_OBJ_SIZE + 1);
+	ut_assertnonnull(large);
+	ut_assert(!obj_pool_test_owns(pool, large));
+	ut_asserteq(0, pool->used);
+	ut_asserteq(1, pool->fallbacks);
+
+	a = obj_pool_alloc(pool, UT_OBJ_SIZE);
+	b = obj_pool_alloc(pool, UT_OBJ_SIZE);
+	ut_assert(obj_pool_test_owns(pool, a));
+	ut_assert(obj_pool_test_owns(pool, b));
+
+	/* The pool is empty */
+	heap = obj_pool_alloc(pool, UT_OBJ_SIZE);
+	ut_assertnonnull(heap);
+	ut_assert(!obj_pool_test_owns(pool, heap));
+	ut_asserteq(2, pool->used);
+	ut_asserteq(2, pool->fallbacks);
+
+	/* Heap objects go back to the heap, not to the pool */
+	obj_pool_free(pool, heap);
+	obj_pool_free(pool, large);
+	ut_asserteq(2, pool->used);
+	ut_assertnull(pool->free_list);
+
+	obj_pool_free(pool, a);
+	obj_pool_free(pool, b);
+	ut_asserteq(0, pool->used);
+	ut_asserteq(2, pool->peak);
+	ut_asserteq(4, pool->allocs);
+	ut_asserteq(2, pool->fallbacks);
+
+	/* Once an object is back, the pool serves again */
+	a = obj_pool_alloc(pool, UT_OBJ_SIZE);
+	ut_assert(obj_pool_test_owns(pool, a));
+	ut_asserteq(2, pool->fallbacks);
+	obj_pool_free(pool, a);
+
+	return 0;
+}
+OBJ_POOL_TEST(obj_pool_test_fallback, 0);
+
+int do_ut_obj_pool(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	struct unit_test *tests = ll_entry_start(struct unit_test,
+						 obj_pool_test);
+	const int n_ents = ll_entry_count(struct unit_test, obj_pool_test);
+
+	return cmd_ut_category("obj_pool", tests, n_ents, argc, argv);
+}
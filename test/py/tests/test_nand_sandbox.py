@@ -0,0 +1,336 @@
+# SPDX-License-Identifier: GPL-2.0+
+#
+# Exercise the NAND flash stack (NMBM, firmware updates, dual image
+# recovery and UBI) on the simulated NAND of sandbox
+#
+# Each test logs how long its steps took and how many pages were read and
+# programmed and how many blocks were erased, so that a change making these
+# paths slower, or making them touch the flash more often, shows up in the
+# log. The operation counts are also checked against what the step needs.
+
+import os
+import os.path
+import pytest
+import re
+import time
+import u_boot_utils
+import zlib
+
+# Must match the nand node of the sandbox test device tree
+nand_fn = 'nand.bin'
+page_size = 2048
+pages_per_block = 64
+block_size = page_size * pages_per_block
+chip_blocks = 512
+factory_bad = (5, 300)
+
+mtdids = 'nmbm0=nmbm0'
+mtdparts = 'mtdparts=nmbm0:4m(firmware),4m(backup),-(ubi)'
+firmware_off = 0
+backup_off = 0x400000
+image_size = 1536 * 1024 + 1000
+
+def nand_setup(cons):
+    """Set up the partitions after U-Boot (re)started."""
+
+    cons.run_command('setenv mtdids %s' % mtdids)
+    cons.run_command('setenv mtdparts %s' % mtdparts)
+
+def nand_stats(cons, reset=True):
+    """Return the operation counters of the simulated NAND."""
+
+    output = cons.run_command('sbnand stats%s' % (' reset' if reset else ''))
+    return dict((k, int(v)) for k, v in re.findall(r'(\w+)=(\d+)', output))
+
+def nand_step(cons, name, cmds):
+    """Run some commands, and log how long they took and the flash
+    operations they caused.
+
+    Returns:
+        A tuple of the outputs of the commands, and the counters.
+    """
+
+    nand_stats(cons)
+    start = time.time()
+    outputs = [cons.run_command(cmd) for cmd in cmds]
+    elapsed = time.time() - start
+    stats = nand_stats(cons)
+
+    cons.log.info('%s: %.3f s, %s' % (name, elapsed,
+                  ' '.join('%s=%d' % kv for kv in sorted(stats.items()))))
+
+    return outputs, stats
+
+def phys_block(cons, logical):
+    """Return the physical block a logical block of nmbm0 is mapped to."""
+
+    output = cons.run_command('nmbm nmbm0 mapping all')
+    m = re.search(r'^%d\s+(\d+)\s*$' % logical, output, re.M)
+    assert m
+    return int(m.group(1))
+
+def pages(size):
+    return (size + page_size - 1) // page_size
+
+def blocks(size):
+    return (size + block_size - 1) // block_size
+
+@pytest.fixture(scope='module')
+def nand_image(u_boot_console):
+    """Start from a blank NAND, and make a legacy image to write to it.
+
+    Sandbox only has the NAND, and NMBM on top of it, while its backing file
+    exists. The emulator opens it relative to the source directory, so only
+    a link to an empty file goes there, and never over a real file."""
+
+    cons = u_boot_console
+    link = cons.config.source_dir + '/' + nand_fn
+    if os.path.exists(link) and not os.path.islink(link):
+        pytest.skip('%s is in the way' % link)
+
+    data_dir = cons.config.persistent_data_dir + '/nand_sandbox'
+    u_boot_utils.run_and_log(cons, ['rm', '-rf', data_dir])
+    os.mkdir(data_dir)
+
+    backing = data_dir + '/' + nand_fn
+    open(backing, 'wb').close()
+    u_boot_utils.run_and_log(cons, ['ln', '-sf', backing, link])
+
+    cons.restart_uboot()
+    nand_setup(cons)
+
+    kernel = data_dir + '/kernel.bin'
+    with open(kernel, 'wb') as fh:
+        fh.write(os.urandom(image_size))
+
+    image = data_dir + '/image.bin'
+    mkimage = cons.config.build_dir + '/tools/mkimage'
+    u_boot_utils.run_and_log(cons, [mkimage, '-A', 'sandbox', '-O', 'linux',
+                                    '-T', 'kernel', '-C', 'none', '-a', '0',
+                                    '-e', '0', '-n', 'sandbox-nand',
+                                    '-d', kernel, image])
+
+    # Whole pages, the way firmware images are written
+    with open(image, 'rb') as fh:
+        data = fh.read()
+    data += b'\xff' * (-len(data) % page_size)
+    with open(image, 'wb') as fh:
+        fh.write(data)
+
+    yield image, data
+
+    # Leave sandbox without the NAND for the other tests
+    os.unlink(link)
+    cons.restart_uboot()
+
+def load_image(cons, image, addr):
+    output = cons.run_command('sb load hostfs 0 %x %s' % (addr, image))
+    assert 'bytes read' in output
+
+def check_crc(cons, addr, data):
+    crc = zlib.crc32(data) & 0xffffffff
+    output = cons.run_command('crc32 %x %x' % (addr, len(data)))
+    assert output.endswith('%08x' % crc)
+
+def write_image(cons, name, addr, off, data):
+    """Erase and write an image the way a firmware upgrade does."""
+
+    cmds = ['nmbm nmbm0 erase %x %x' % (off, blocks(len(data)) * block_size),
+            'nmbm nmbm0 write %x %x %x' % (addr, off, len(data))]
+    outputs, stats = nand_step(cons, name, cmds)
+    for output in outputs:
+        assert 'Succeeded' in output
+
+    return stats
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('nand_sandbox')
+@pytest.mark.buildconfigspec('cmd_nmbm')
+def test_nmbm_attach(u_boot_console, nand_image):
+    """Test that NMBM is created on the blank NAND, knows the factory bad
+    blocks, and attaches again without touching the flash."""
+
+    cons = u_boot_console
+
+    output = cons.run_command('nmbm list')
+    assert re.search(r'nmbm0\s+nand0', output)
+
+    output = cons.run_command('nmbm nmbm0 bad')
+    physical = output.split('Logical blocks:')[0]
+    for block in factory_bad:
+        assert re.search(r'^%d\s+\[.*\] - Bad' % block, physical, re.M)
+
+    # The counters now cover the attach during start up
+    start = time.time()
+    cons.restart_uboot()
+    elapsed = time.time() - start
+    nand_setup(cons)
+    stats = nand_stats(cons)
+    cons.log.info('restart with NMBM attach: %.3f s, %s' % (elapsed,
+                  ' '.join('%s=%d' % kv for kv in sorted(stats.items()))))
+
+    assert stats['programs'] == 0
+    assert stats['erases'] == 0
+    # Far from reading every page
+    assert 0 < stats['reads'] < 2 * chip_blocks
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('nand_sandbox')
+@pytest.mark.buildconfigspec('cmd_nmbm')
+@pytest.mark.buildconfigspec('cmd_crc32')
+def test_nmbm_upgrade(u_boot_console, nand_image):
+    """Test writing a firmware image, and reading it back."""
+
+    cons = u_boot_console
+    image, data = nand_image
+    addr = u_boot_utils.find_ram_base(cons) + 0x1000000
+    raddr = addr + 0x1000000
+
+    load_image(cons, image, addr)
+
+    stats = write_image(cons, 'firmware write', addr, firmware_off, data)
+    assert stats['erases'] == blocks(len(data))
+    assert stats['programs'] >= pages(len(data))
+    assert stats['programs'] <= pages(len(data)) + 2 * pages_per_block
+
+    outputs, stats = nand_step(cons, 'firmware read', [
+        'nmbm nmbm0 read %x %x %x' % (raddr, firmware_off, len(data))])
+    assert 'Succeeded' in outputs[0]
+    assert pages(len(data)) <= stats['reads'] <= 2 * pages(len(data))
+    assert stats['programs'] == 0 and stats['erases'] == 0
+    check_crc(cons, raddr, data)
+
+    output = cons.run_command('iminfo %x' % raddr)
+    assert 'sandbox-nand' in output
+    assert 'Verifying Checksum ... OK' in output
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('nand_sandbox')
+@pytest.mark.buildconfigspec('cmd_nmbm')
+@pytest.mark.buildconfigspec('cmd_crc32')
+def test_nmbm_remap(u_boot_console, nand_image):
+    """Test that a block failing while an image is written is replaced, and
+    that the image can be read back."""
+
+    cons = u_boot_console
+    image, data = nand_image
+    addr = u_boot_utils.find_ram_base(cons) + 0x1000000
+    raddr = addr + 0x1000000
+    off = backup_off + 2 * block_size
+
+    load_image(cons, image, addr)
+
+    logical = off // block_size
+    old = phys_block(cons, logical)
+    cons.run_command('sbnand fail %d' % old)
+
+    try:
+        stats = write_image(cons, 'write with failing block', addr, off, data)
+    finally:
+        cons.run_command('sbnand clear')
+
+    assert stats['erase_fails'] + stats['prog_fails'] >= 1
+
+    new = phys_block(cons, logical)
+    assert new != old
+
+    output = cons.run_command('nmbm nmbm0 bad')
+    assert re.search(r'^%d\s+\[.*\] - Bad' % old, output, re.M)
+
+    outputs, stats = nand_step(cons, 'read remapped', [
+        'nmbm nmbm0 read %x %x %x' % (raddr, off, len(data))])
+    assert 'Succeeded' in outputs[0]
+    check_crc(cons, raddr, data)
+
+    # The remapping is kept across a restart
+    cons.restart_uboot()
+    nand_setup(cons)
+    assert phys_block(cons, logical) == new
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('nand_sandbox')
+@pytest.mark.buildconfigspec('cmd_nmbm')
+@pytest.mark.buildconfigspec('cmd_crc32')
+def test_nmbm_dual_image(u_boot_console, nand_image):
+    """Test that bitflips are corrected, and that an image too damaged to
+    be read is restored from the backup copy."""
+
+    cons = u_boot_console
+    image, data = nand_image
+    addr = u_boot_utils.find_ram_base(cons) + 0x1000000
+    raddr = addr + 0x1000000
+
+    load_image(cons, image, addr)
+    write_image(cons, 'firmware write', addr, firmware_off, data)
+    write_image(cons, 'backup write', addr, backup_off, data)
+
+    # A page in the middle of the firmware
+    page = phys_block(cons, 1) * pages_per_block + 3
+
+    with cons.log.section('Correctable bitflip'):
+        cons.run_command('sbnand bitflip %d 1' % page)
+        outputs, stats = nand_step(cons, 'read with bitflip', [
+            'nmbm nmbm0 read %x %x %x' % (raddr, firmware_off, len(data))])
+        assert 'Succeeded' in outputs[0]
+        assert stats['flipped'] >= 1
+        check_crc(cons, raddr, data)
+        cons.run_command('sbnand clear')
+
+    with cons.log.section('Recovery from backup'):
+        cons.run_command('sbnand bitflip %d 2' % page)
+        outputs, stats = nand_step(cons, 'read damaged firmware', [
+            'nmbm nmbm0 read %x %x %x' % (raddr, firmware_off, len(data))])
+        assert 'Failed' in outputs[0]
+
+        outputs, stats = nand_step(cons, 'read backup', [
+            'nmbm nmbm0 read %x %x %x' % (raddr, backup_off, len(data)),
+            'iminfo %x' % raddr])
+        assert 'Succeeded' in outputs[0]
+        assert 'Verifying Checksum ... OK' in outputs[1]
+
+        # Erasing the block gets rid of the bitflips
+        stats = write_image(cons, 'restore firmware', raddr, firmware_off,
+                            data)
+        assert stats['erases'] == blocks(len(data))
+
+        outputs, stats = nand_step(cons, 'read restored firmware', [
+            'nmbm nmbm0 read %x %x %x' % (raddr, firmware_off, len(data))])
+        assert 'Succeeded' in outputs[0]
+        assert stats['flipped'] == 0
+        check_crc(cons, raddr, data)
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('nand_sandbox')
+@pytest.mark.buildconfigspec('cmd_nmbm')
+@pytest.mark.buildconfigspec('cmd_ubi')
+@pytest.mark.buildconfigspec('cmd_crc32')
+def test_nmbm_ubi_boot(u_boot_console, nand_image):
+    """Test loading a kernel image from a UBI volume, as the boot flow does,
+    including attaching UBI again after a restart."""
+
+    cons = u_boot_console
+    image, data = nand_image
+    addr = u_boot_utils.find_ram_base(cons) + 0x1000000
+    raddr = addr + 0x1000000
+
+    load_image(cons, image, addr)
+
+    outputs, stats = nand_step(cons, 'ubi format and write', [
+        'ubi part ubi',
+        'ubi create kernel %x' % (2 * len(data)),
+        'ubi write %x kernel %x' % (addr, len(data))])
+    assert 'written to volume kernel' in outputs[2]
+
+    cons.restart_uboot()
+    nand_setup(cons)
+
+    outputs, stats = nand_step(cons, 'ubi attach', ['ubi part ubi'])
+    assert 'Error' not in outputs[0]
+    assert stats['programs'] == 0 and stats['erases'] == 0
+
+    outputs, stats = nand_step(cons, 'ubi read kernel', [
+        'ubi read %x kernel %x' % (raddr, len(data)),
+        'iminfo %x' % raddr])
+    assert 'Verifying Checksum ... OK' in outputs[1]
+    assert pages(len(data)) <= stats['reads'] <= 2 * pages(len(data))
+    check_crc(cons, raddr, data)
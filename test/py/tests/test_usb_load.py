@@ -0,0 +1,87 @@
+# SPDX-License-Identifier: GPL-2.0+
+#
+# Test loading a file from an emulated USB storage device with "usb load"
+
+import os
+import os.path
+import pytest
+import u_boot_utils
+import zlib
+
+# Backing file of the third flash stick of the sandbox test device tree
+flash_fn = 'testflash2.bin'
+file_name = 'recovery.bin'
+file_size = 3 * 1024 * 1024 + 123
+
+@pytest.fixture(scope='module')
+def usb_load_data(u_boot_console):
+    """Create an ext4 filesystem holding a random file, on the whole disk
+    of a USB flash stick."""
+
+    cons = u_boot_console
+    fs_dir = cons.config.persistent_data_dir + '/usb_load'
+    u_boot_utils.run_and_log(cons, ['rm', '-rf', fs_dir])
+    os.mkdir(fs_dir)
+
+    data = os.urandom(file_size)
+    with open(fs_dir + '/' + file_name, 'wb') as fh:
+        fh.write(data)
+
+    # The emulator opens its backing file relative to the source directory,
+    # so only a link to the image goes there, and never over a real file
+    link = cons.config.source_dir + '/' + flash_fn
+    if os.path.exists(link) and not os.path.islink(link):
+        pytest.skip('%s is in the way' % link)
+
+    image = cons.config.persistent_data_dir + '/' + flash_fn
+    u_boot_utils.run_and_log(cons, ['mkfs.ext4', '-q', '-F', '-d', fs_dir,
+                                    image, '8M'])
+    u_boot_utils.run_and_log(cons, ['ln', '-sf', image, link])
+
+    # Pick up the new backing file
+    cons.run_command('usb stop')
+
+    yield data
+
+    cons.run_command('usb stop')
+    os.unlink(link)
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('usb_storage_load')
+@pytest.mark.buildconfigspec('fs_ext4')
+@pytest.mark.buildconfigspec('cmd_crc32')
+def test_usb_load(u_boot_console, usb_load_data):
+    """Test that the file is found and loaded intact."""
+
+    cons = u_boot_console
+    addr = u_boot_utils.find_ram_base(cons)
+
+    output = cons.run_command('usb load %x %s' % (addr, file_name))
+    assert ('%d bytes read' % file_size) in output
+    output = cons.run_command('printenv filesize')
+    assert output == 'filesize=%x' % file_size
+
+    crc = zlib.crc32(usb_load_data) & 0xffffffff
+    output = cons.run_command('crc32 %x %x' % (addr, file_size))
+    assert output.endswith('%08x' % crc)
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('usb_storage_load')
+@pytest.mark.buildconfigspec('fs_ext4')
+def test_usb_load_errors(u_boot_console, usb_load_data):
+    """Test that a missing or too large file is refused."""
+
+    cons = u_boot_console
+    addr = u_boot_utils.find_ram_base(cons)
+
+    with cons.log.section('Missing file'):
+        output = cons.run_command('usb load %x missing.bin; echo rc=$?' %
+                                  addr)
+        assert 'not found on any USB storage device' in output
+        assert output.endswith('rc=1')
+
+    with cons.log.section('File too large'):
+        output = cons.run_command('usb load %x %s %x; echo rc=$?' %
+                                  (addr, file_name, file_size - 1))
+        assert 'is too large' in output
+        assert output.endswith('rc=1')
@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the named scratch regions and lmb_largest_free()
+ */
+
+#include <common.h>
+#include <command.h>
+#include <lmb.h>
+#include <mapmem.h>
+#include <scratch.h>
+#include <linux/sizes.h>
+#include <test/scratch.h>
+#include <test/suites.h>
+#include <test/ut.h>
+
+#define LMB_TEST_BASE	0x10000000
+
+/* Check that [@a, @a + @alen) and [@b, @b + @blen) don't overlap */
+static bool scratch_test_disjoint(void *a, ulong alen, void *b, ulong blen)
+{
+	ulong abase = map_to_sysmem(a), bbase = map_to_sysmem(b);
+
+	return abase + alen <= bbase || bbase + blen <= abase;
+}
+
+static int scratch_test_lmb_largest_free(struct unit_test_state *uts)
+{
+	struct lmb lmb;
+	phys_addr_t base;
+
+	lmb_init(&lmb);
+
+	/* No memory at all */
+	base = 0;
+	ut_asserteq(0, lmb_largest_free(&lmb, &base));
+	ut_asserteq(0, base);
+
+	/* The whole bank is free */
+	lmb_add(&lmb, LMB_TEST_BASE, SZ_1M);
+	ut_asserteq(SZ_1M, lmb_largest_free(&lmb, &base));
+	ut_asserteq(LMB_TEST_BASE, base);
+
+	/* Gaps of 64K, 448K and 384K, the one in the middle wins */
+	lmb_reserve(&lmb, LMB_TEST_BASE + 0x10000, 0x10000);
+	lmb_reserve(&lmb, LMB_TEST_BASE + 0x90000, 0x10000);
+	ut_asserteq(0x70000, lmb_largest_free(&lmb, &base));
+	ut_asserteq(LMB_TEST_BASE + 0x20000, base);
+
+	/* Fill the middle gap, now the one at the end of the bank wins */
+	lmb_reserve(&lmb, LMB_TEST_BASE + 0x20000, 0x60000);
+	ut_asserteq(0x60000, lmb_largest_free(&lmb, &base));
+	ut_asserteq(LMB_TEST_BASE + 0xa0000, base);
+
+	/* A larger second bank without reservations */
+	lmb_add(&lmb, 2 * LMB_TEST_BASE, SZ_2M);
+	ut_asserteq(SZ_2M, lmb_largest_free(&lmb, &base));
+	ut_asserteq(2 * LMB_TEST_BASE, base);
+
+	/* Reserve the start of the second bank */
+	lmb_reserve(&lmb, 2 * LMB_TEST_BASE, SZ_2M - 0x40000);
+	ut_asserteq(0x60000, lmb_largest_free(&lmb, &base));
+	ut_asserteq(LMB_TEST_BASE + 0xa0000, base);
+
+	/* Nothing left */
+	lmb_reserve(&lmb, LMB_TEST_BASE, SZ_1M);
+	lmb_reserve(&lmb, 2 * LMB_TEST_BASE, SZ_2M);
+	ut_asserteq(0, lmb_largest_free(&lmb, &base));
+
+	return 0;
+}
+SCRATCH_TEST(scratch_test_lmb_largest_free, 0);
+
+static int scratch_test_alloc(struct unit_test_state *uts)
+{
+	phys_size_t max, size;
+	void *a, *b, *p;
+
+	/* Remember how much is free, to check that nothing leaks */
+	ut_assertnonnull(scratch_alloc_max("ut max", &max));
+	scratch_free("ut max");
+
+	a = scratch_alloc("ut a", 0x1000);
+	ut_assertnonnull(a);
+	b = scratch_alloc("ut b", 0x3000);
+	ut_assertnonnull(b);
+	ut_assert(scratch_test_disjoint(a, 0x1000, b, 0x3000));
+
+	/* A region which is large enough is handed out again */
+	ut_asserteq_ptr(a, scratch_alloc("ut a", 0x800));
+	ut_asserteq_ptr(a, scratch_alloc("ut a", 0x1000));
+
+	/* Growing a region may move it, but never over another one */
+	a = scratch_alloc("ut a", SZ_1M);
+	ut_assertnonnull(a);
+	ut_assert(scratch_test_disjoint(a, SZ_1M, b, 0x3000));
+
+	memset(b, 0x5a, 0x3000);
+	memset(a, 0xa5, SZ_1M);
+	ut_asserteq(0x5a, ((u8 *)b)[0]);
+	ut_asserteq(0x5a, ((u8 *)b)[0x2fff]);
+
+	/* More than there is fails, and doesn't keep the old region */
+	ut_assertnull(scratch_alloc("ut a", max + SZ_4K));
+	p = scratch_alloc("ut c", SZ_1M);
+	ut_assertnonnull(p);
+	ut_assert(scratch_test_disjoint(p, SZ_1M, b, 0x3000));
+
+	scratch_free("ut a");
+	scratch_free("ut b");
+	scratch_free("ut c");
+
+	/* Freeing what isn't reserved does nothing */
+	scratch_free("ut none");
+
+	ut_assertnonnull(scratch_alloc_max("ut max", &size));
+	ut_asserteq(max, size);
+	scratch_free("ut max");
+
+	return 0;
+}
+SCRATCH_TEST(scratch_test_alloc, 0);
+
+static int scratch_test_alloc_max(struct unit_test_state *uts)
+{
+	phys_size_t max, size;
+	void *p, *q;
+
+	p = scratch_alloc_max("ut max", &max);
+	ut_assertnonnull(p);
+	ut_assert(max >= SZ_1M);
+	ut_asserteq(0, map_to_sysmem(p) % SZ_4K);
+
+	ut_asserteq(-ENOENT, scratch_shrink("ut none", SZ_4K));
+
+	/* Keep an unaligned size, the rest is given back */
+	ut_assertok(scratch_shrink("ut max", 0x1800));
+	q = scratch_alloc("ut other", max - SZ_1M);
+	ut_assertnonnull(q);
+	ut_assert(scratch_test_disjoint(p, SZ_8K, q, max - SZ_1M));
+
+	scratch_free("ut other");
+
+	/* Shrinking never grows a region, all but 8K stay free */
+	ut_assertok(scratch_shrink("ut max", SZ_1M));
+	q = scratch_alloc_max("ut rest", &size);
+	ut_assertnonnull(q);
+	ut_asserteq(max - SZ_8K, size);
+	ut_assert(scratch_test_disjoint(p, SZ_8K, q, size));
+
+	scratch_free("ut rest");
+	scratch_free("ut max");
+
+	ut_assertnonnull(scratch_alloc_max("ut max", &size));
+	ut_asserteq(max, size);
+	scratch_free("ut max");
+
+	return 0;
+}
+SCRATCH_TEST(scratch_test_alloc_max, 0);
+
+int do_ut_scratch(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	struct unit_test *tests = ll_entry_start(struct unit_test,
+						 scratch_test);
+	const int n_ents = ll_entry_count(struct unit_test, scratch_test);
+
+	return cmd_ut_category("scratch", tests, n_ents, argc, argv);
+}
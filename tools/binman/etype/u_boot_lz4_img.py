@@ -0,0 +1,25 @@
+# SPDX-License-Identifier: GPL-2.0+
+#
+# Entry-type module for U-Boot legacy image with LZ4 compressed content
+#
+
+from entry import Entry
+from blob import Entry_blob
+
+class Entry_u_boot_lz4_img(Entry_blob):
+    """U-Boot legacy image with content LZ4 compressed
+
+    Properties / Entry arguments:
+        - filename: Filename of u-boot-lz4.img (default 'u-boot-lz4.img')
+
+    This is the U-Boot binary as a packaged image, in legacy format. It has a
+    header which allows it to be loaded at the correct address for execution.
+
+    You should use FIT (Flat Image Tree) instead of the legacy image for new
+    applications.
+    """
+    def __init__(self, section, etype, node):
+        Entry_blob.__init__(self, section, etype, node)
+
+    def GetDefaultFilename(self):
+        return 'u-boot-lz4.img'
@@ -631,6 +631,7 @@ static int fit_handle_file(struct image_tool_params *params)
 {
 	char tmpfile[MKIMAGE_MAX_TMPFILE_LEN];
 	char cmd[MKIMAGE_MAX_DTC_CMDLINE_LEN];
+	uint64_t start;
 	size_t size_inc;
 	int ret;
 
@@ -648,6 +649,7 @@ static int fit_handle_file(struct image_tool_params *params)
 	sprintf (tmpfile, "%s%s", params->imagefile, MKIMAGE_TMPFILE_SUFFIX);
 
 	/* We either compile the source file, or use the existing FIT image */
+	start = imagetool_time_us();
 	if (params->auto_its) {
 		if (fit_build(params, tmpfile)) {
 			fprintf(stderr, "%s: failed to build FIT\n",
@@ -669,11 +671,14 @@ static int fit_handle_file(struct image_tool_params *params)
 				params->cmdname, cmd, strerror(errno));
 		goto err_system;
 	}
+	imagetool_time_add(params->auto_its ? "build" : "dtc", start);
 
 	/* Move the data so it is internal to the FIT, if needed */
+	start = imagetool_time_us();
 	ret = fit_import_data(params, tmpfile);
 	if (ret)
 		goto err_system;
+	imagetool_time_add("import", start);
 
 	/*
 	 * Set hashes for images in the blob. Unfortunately we may need more
@@ -683,8 +688,10 @@ static int fit_handle_file(struct image_tool_params *params)
 	 * calculate the signature every time. It would be better to calculate
 	 * all the data and then store it in a separate step. However, this
 	 * would be considerably more complex to implement. Generally a few
-	 * steps of this loop is enough to sign with several keys.
+	 * steps of this loop is enough to sign with several keys. Hashes are
+	 * only calculated in the first step, see fit_add_verification_data().
 	 */
+	start = imagetool_time_us();
 	for (size_inc = 0; size_inc < 64 * 1024; size_inc += 1024) {
 		ret = fit_add_file_data(params, size_inc, tmpfile);
 		if (!ret || ret != -ENOSPC)
@@ -696,12 +703,15 @@ static int fit_handle_file(struct image_tool_params *params)
 			params->cmdname, ret);
 		goto err_system;
 	}
+	imagetool_time_add("hash", start);
 
 	/* Move the data so it is external to the FIT, if requested */
 	if (params->external_data) {
+		start = imagetool_time_us();
 		ret = fit_extract_data(params, tmpfile);
 		if (ret)
 			goto err_system;
+		imagetool_time_add("extract", start);
 	}
 
 	if (rename (tmpfile, params->imagefile) == -1) {
@@ -10,9 +10,194 @@
 
 #include "mkimage.h"
 #include <bootm.h>
+#include <hash.h>
 #include <image.h>
 #include <version.h>
 
+/* Amount of image data fed to all hash algorithms of an image in turn */
+#define FIT_HASH_CHUNK		(64 * 1024)
+
+/*
+ * A hash value calculated by fit_hash_images(). These are kept until exit
+ * since fit_handle_file() may add the verification data several times.
+ */
+struct fit_hash_result {
+	char *image_name;
+	char *algo;
+	size_t size;
+	uint8_t value[FIT_MAX_HASH_LEN];
+	int value_len;		/* 0 if the algorithm is not supported */
+};
+
+static struct fit_hash_result *fit_hash_results;
+static int fit_hash_result_count;
+
+/* The hash values to calculate for one image */
+struct fit_hash_job {
+	const void *data;
+	size_t size;
+	int first;		/* Index of the first result */
+	int count;		/* Number of results */
+};
+
+static struct fit_hash_result *fit_hash_find(const char *image_name,
+					     const char *algo, size_t size)
+{
+	struct fit_hash_result *result;
+	int i;
+
+	for (i = 0; i < fit_hash_result_count; i++) {
+		result = &fit_hash_results[i];
+		if (result->size == size && !strcmp(result->algo, algo) &&
+		    !strcmp(result->image_name, image_name))
+			return result;
+	}
+
+	return NULL;
+}
+
+/* Calculate all hash values of one image with a single pass over its data */
+static int fit_hash_image(void *arg, int index)
+{
+	struct fit_hash_job *job = (struct fit_hash_job *)arg + index;
+	struct fit_hash_result *results = fit_hash_results + job->first;
+	struct hash_algo **algos;
+	size_t offset, len;
+	void **ctxs;
+	int i;
+
+	algos = calloc(job->count, sizeof(*algos));
+	ctxs = calloc(job->count, sizeof(*ctxs));
+	if (!algos || !ctxs) {
+		free(algos);
+		free(ctxs);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < job->count; i++) {
+		ctxs[i] = NULL;
+		if (!hash_progressive_lookup_algo(results[i].algo, &algos[i]) &&
+		    !algos[i]->hash_init(algos[i], &ctxs[i]))
+			continue;
+
+		/* No progressive version, hash the data on its own */
+		ctxs[i] = NULL;
+		if (calculate_hash(job->data, job->size, results[i].algo,
+				   results[i].value, &results[i].value_len))
+			results[i].value_len = 0;
+	}
+
+	for (offset = 0; offset < job->size; offset += len) {
+		len = job->size - offset;
+		if (len > FIT_HASH_CHUNK)
+			len = FIT_HASH_CHUNK;
+
+		for (i = 0; i < job->count; i++) {
+			if (ctxs[i] &&
+			    algos[i]->hash_update(algos[i], ctxs[i],
+						  job->data + offset, len,
+						  offset + len == job->size))
+				ctxs[i] = NULL;
+		}
+	}
+
+	for (i = 0; i < job->count; i++) {
+		if (ctxs[i] &&
+		    !algos[i]->hash_finish(algos[i], ctxs[i], results[i].value,
+					   FIT_MAX_HASH_LEN))
+			results[i].value_len = algos[i]->digest_size;
+	}
+
+	free(algos);
+	free(ctxs);
+
+	return 0;
+}
+
+/**
+ * fit_hash_images() - Calculate the hash values of all images in a FIT
+ *
+ * Images are hashed in parallel. Only missing values are calculated, so
+ * later calls for the same FIT do not hash again. Errors are left to
+ * fit_image_process_hash(), which uses the values found here.
+ *
+ * @fit:	pointer to the FIT format image header
+ * @images_noffset: offset of the images node
+ * @return 0 if ok, -ENOMEM on error
+ */
+static int fit_hash_images(const void *fit, int images_noffset)
+{
+	struct fit_hash_job *jobs = NULL;
+	struct fit_hash_result *result;
+	int image_noffset, noffset;
+	const char *image_name;
+	const void *data;
+	int njobs = 0;
+	size_t size;
+	char *algo;
+	int job, ret;
+
+	for (image_noffset = fdt_first_subnode(fit, images_noffset);
+	     image_noffset >= 0;
+	     image_noffset = fdt_next_subnode(fit, image_noffset)) {
+		if (fit_image_get_data(fit, image_noffset, &data, &size))
+			continue;
+
+		image_name = fit_get_name(fit, image_noffset, NULL);
+		job = -1;
+
+		for (noffset = fdt_first_subnode(fit, image_noffset);
+		     noffset >= 0;
+		     noffset = fdt_next_subnode(fit, noffset)) {
+			if (strncmp(fit_get_name(fit, noffset, NULL),
+				    FIT_HASH_NODENAME,
+				    strlen(FIT_HASH_NODENAME)) ||
+			    fit_image_hash_get_algo(fit, noffset, &algo) ||
+			    fit_hash_find(image_name, algo, size))
+				continue;
+
+			/* Each image is a job, with its results in a row */
+			if (job < 0) {
+				void *tmp;
+
+				tmp = realloc(jobs, (njobs + 1) * sizeof(*jobs));
+				if (!tmp)
+					goto err;
+				jobs = tmp;
+				job = njobs++;
+				jobs[job].data = data;
+				jobs[job].size = size;
+				jobs[job].first = fit_hash_result_count;
+				jobs[job].count = 0;
+			}
+
+			result = realloc(fit_hash_results,
+					 (fit_hash_result_count + 1) *
+					 sizeof(*result));
+			if (!result)
+				goto err;
+			fit_hash_results = result;
+			result += fit_hash_result_count;
+			memset(result, '\0', sizeof(*result));
+			result->image_name = strdup(image_name);
+			result->algo = strdup(algo);
+			result->size = size;
+			if (!result->image_name || !result->algo)
+				goto err;
+			fit_hash_result_count++;
+			jobs[job].count++;
+		}
+	}
+
+	ret = njobs ? imagetool_run_jobs(njobs, fit_hash_image, jobs) : 0;
+	free(jobs);
+
+	return ret;
+err:
+	free(jobs);
+	return -ENOMEM;
+}
+
 /**
  * fit_set_hash_value - set hash value in requested has node
  * @fit: pointer to the FIT format image header
@@ -59,6 +244,7 @@ static int fit_set_hash_value(void *fit, int noffset, uint8_t *value,
 static int fit_image_process_hash(void *fit, const char *image_name,
 		int noffset, const void *data, size_t size)
 {
+	struct fit_hash_result *result;
 	uint8_t value[FIT_MAX_HASH_LEN];
 	const char *node_name;
 	int value_len;
@@ -73,7 +259,11 @@ static int fit_image_process_hash(void *fit, const char *image_name,
 		return -ENOENT;
 	}
 
-	if (calculate_hash(data, size, algo, value, &value_len)) {
+	result = fit_hash_find(image_name, algo, size);
+	if (result && result->value_len) {
+		value_len = result->value_len;
+		memcpy(value, result->value, value_len);
+	} else if (calculate_hash(data, size, algo, value, &value_len)) {
 		printf("Unsupported hash algorithm (%s) for '%s' hash node in '%s' image node\n",
 		       algo, node_name, image_name);
 		return -EPROTONOSUPPORT;
@@ -687,6 +877,10 @@ int fit_add_verification_data(const char *keydir, void *keydest, void *fit,
 		return images_noffset;
 	}
 
+	ret = fit_hash_images(fit, images_noffset);
+	if (ret)
+		return ret;
+
 	/* Process its subnodes, print out component images details */
 	for (noffset = fdt_first_subnode(fit, images_noffset);
 	     noffset >= 0;
@@ -8,6 +8,18 @@
 #include "imagetool.h"
 
 #include <image.h>
+#include <pthread.h>
+
+#define IMAGETOOL_MAX_JOBS	64
+#define IMAGETOOL_MAX_PHASES	16
+
+static struct {
+	const char *name;
+	uint64_t us;
+} imagetool_phases[IMAGETOOL_MAX_PHASES];
+static int imagetool_phase_count;
+static uint64_t imagetool_start_us;
+static const char *imagetool_cmdname;
 
 struct image_type_params *imagetool_get_type(int type)
 {
@@ -134,3 +146,143 @@ time_t imagetool_get_source_date(
 
 	return time;
 }
+
+int imagetool_get_jobs(void)
+{
+	const char *env = getenv("MKIMAGE_JOBS");
+	long jobs;
+
+	if (env)
+		jobs = strtol(env, NULL, 0);
+	else
+		jobs = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (jobs < 1)
+		return 1;
+
+	return jobs > IMAGETOOL_MAX_JOBS ? IMAGETOOL_MAX_JOBS : jobs;
+}
+
+struct imagetool_jobs {
+	int (*func)(void *arg, int index);
+	void *arg;
+	int count;
+	int next;
+	int ret;
+	pthread_mutex_t lock;
+};
+
+static void *imagetool_job_thread(void *data)
+{
+	struct imagetool_jobs *jobs = data;
+	int index, ret;
+
+	for (;;) {
+		pthread_mutex_lock(&jobs->lock);
+		index = jobs->next++;
+		pthread_mutex_unlock(&jobs->lock);
+
+		if (index >= jobs->count)
+			break;
+
+		ret = jobs->func(jobs->arg, index);
+		if (ret) {
+			pthread_mutex_lock(&jobs->lock);
+			if (!jobs->ret)
+				jobs->ret = ret;
+			pthread_mutex_unlock(&jobs->lock);
+		}
+	}
+
+	return NULL;
+}
+
+int imagetool_run_jobs(int count, int (*func)(void *arg, int index),
+		       void *arg)
+{
+	struct imagetool_jobs jobs = {
+		.func = func,
+		.arg = arg,
+		.count = count,
+	};
+	pthread_t threads[IMAGETOOL_MAX_JOBS];
+	int i, started, nthreads;
+
+	nthreads = imagetool_get_jobs();
+	if (nthreads > count)
+		nthreads = count;
+
+	pthread_mutex_init(&jobs.lock, NULL);
+
+	/* The calling thread takes jobs too, and all of them if none start */
+	for (started = 0; started < nthreads - 1; started++) {
+		if (pthread_create(&threads[started], NULL,
+				   imagetool_job_thread, &jobs))
+			break;
+	}
+	imagetool_job_thread(&jobs);
+
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+	pthread_mutex_destroy(&jobs.lock);
+
+	return jobs.ret;
+}
+
+uint64_t imagetool_time_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void imagetool_time_add(const char *phase, uint64_t start)
+{
+	uint64_t us = imagetool_time_us() - start;
+	int i;
+
+	for (i = 0; i < imagetool_phase_count; i++) {
+		if (!strcmp(imagetool_phases[i].name, phase))
+			break;
+	}
+
+	if (i == imagetool_phase_count) {
+		if (i == IMAGETOOL_MAX_PHASES)
+			return;
+		imagetool_phases[i].name = phase;
+		imagetool_phase_count++;
+	}
+
+	imagetool_phases[i].us += us;
+}
+
+static void imagetool_time_report(void)
+{
+	uint64_t total = imagetool_time_us() - imagetool_start_us;
+	uint64_t other = total;
+	int i;
+
+	fprintf(stderr, "%s: time per phase (%d jobs)\n", imagetool_cmdname,
+		imagetool_get_jobs());
+	for (i = 0; i < imagetool_phase_count; i++) {
+		fprintf(stderr, "  %-8s %9.1f ms\n", imagetool_phases[i].name,
+			imagetool_phases[i].us / 1000.0);
+		if (other > imagetool_phases[i].us)
+			other -= imagetool_phases[i].us;
+		else
+			other = 0;
+	}
+	fprintf(stderr, "  %-8s %9.1f ms\n", "other", other / 1000.0);
+	fprintf(stderr, "  %-8s %9.1f ms\n", "total", total / 1000.0);
+}
+
+void imagetool_time_init(const char *cmdname)
+{
+	imagetool_start_us = imagetool_time_us();
+	imagetool_cmdname = cmdname;
+
+	if (getenv("MKIMAGE_TIMING"))
+		atexit(imagetool_time_report);
+}
@@ -224,6 +224,74 @@ time_t imagetool_get_source_date(
 	const char *cmdname,
 	time_t fallback);
 
+/**
+ * imagetool_get_jobs() - Get the number of threads to use for parallel work
+ *
+ * This is the MKIMAGE_JOBS environment variable if set, otherwise the
+ * number of online CPUs.
+ *
+ * @return number of threads, at least 1
+ */
+int imagetool_get_jobs(void);
+
+/**
+ * imagetool_run_jobs() - Run independent jobs on several threads
+ *
+ * Calls @func once for each index below @count, from up to
+ * imagetool_get_jobs() threads including the calling one. Jobs may run in
+ * any order and must not change state shared with other jobs.
+ *
+ * @count:	number of jobs
+ * @func:	function running one job, returning 0 or -ve on error
+ * @arg:	argument passed to @func
+ * @return 0 if all jobs succeeded, else the error of a failed job
+ */
+int imagetool_run_jobs(int count, int (*func)(void *arg, int index),
+		       void *arg);
+
+/**
+ * imagetool_time_us() - Get a time stamp for imagetool_time_add()
+ *
+ * @return monotonic time in microseconds
+ */
+uint64_t imagetool_time_us(void);
+
+/**
+ * imagetool_time_add() - Account the time since @start to a phase
+ *
+ * Phases are reported in the order they were first added.
+ *
+ * @phase:	short name of the phase, e.g. "hash"
+ * @start:	time stamp from imagetool_time_us()
+ */
+void imagetool_time_add(const char *phase, uint64_t start);
+
+/**
+ * imagetool_time_init() - Start the timing breakdown
+ *
+ * If the MKIMAGE_TIMING environment variable is set, the time spent in each
+ * phase and in total is printed to stderr on exit.
+ *
+ * @cmdname:	command name
+ */
+void imagetool_time_init(const char *cmdname);
+
+/**
+ * mblock_build() - Build a multi-block compressed payload for -C mblock
+ *
+ * The data file is compressed in blocks with the tool named by the
+ * MKIMAGE_MBLOCK_COMP environment variable ('lzma' or 'lz4', default
+ * 'lzma') and blocks of MKIMAGE_MBLOCK_SIZE KiB (default 512). Blocks are
+ * compressed in parallel, see imagetool_get_jobs(). If MKIMAGE_CACHE_DIR is
+ * set, compressed blocks are kept there by content and reused by later runs.
+ * On success params->datafile is switched to the payload, a temporary file
+ * removed on exit. A data file which is already such a payload is used as is.
+ *
+ * @params:	mkimage parameters
+ * @return 0 if OK, -ve on error
+ */
+int mblock_build(struct image_tool_params *params);
+
 /*
  * There is a c file associated with supported image type low level code
  * for ex. default_image.c, fit_image.c
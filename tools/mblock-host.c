@@ -0,0 +1,375 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Building multi-block compressed payloads (mkimage -C mblock)
+ *
+ * The data file is split into blocks which are compressed in parallel with
+ * the external 'lzma' or 'lz4' tool, and put together as described in
+ * include/mblock.h. Compressed blocks may be kept in a cache directory named
+ * by their tool and the SHA-256 of their data, so blocks which did not
+ * change are not compressed again by later builds.
+ */
+
+#include "mkimage.h"
+#include <image.h>
+#include <mblock.h>
+#include <u-boot/sha256.h>
+
+#define MBLOCK_DEFAULT_COMP		"lzma"
+#define MBLOCK_DEFAULT_SIZE_KB		512
+#define MBLOCK_SUFFIX			".mblock"
+#define MBLOCK_MAX_TMPFILE_LEN	(MKIMAGE_MAX_TMPFILE_LEN + 16)
+#define MBLOCK_MAX_CMDLINE_LEN		(2 * MBLOCK_MAX_TMPFILE_LEN + 64)
+#define MBLOCK_MAX_CACHEFILE_LEN	4096
+
+#define DIV_ROUND_UP(n, d)		(((n) + (d) - 1) / (d))
+
+static char mblock_file[MKIMAGE_MAX_TMPFILE_LEN];
+
+/* The blocks to compress, one job each */
+struct mblock_jobs {
+	struct image_tool_params *params;
+	const char *tool;
+	const char *cache_dir;
+	const uint8_t *data;
+	size_t size;
+	size_t block_size;
+	void **blocks;
+	size_t *lens;
+	int hits;
+};
+
+static void mblock_cleanup(void)
+{
+	if (*mblock_file)
+		unlink(mblock_file);
+}
+
+static int mblock_write_file(const char *fname, const void *buf, size_t size)
+{
+	int fd, ret = 0;
+
+	fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666);
+	if (fd < 0)
+		return -errno;
+
+	if (write(fd, buf, size) != size)
+		ret = -EIO;
+	close(fd);
+
+	return ret;
+}
+
+static void *mblock_read_file(const char *fname, size_t *sizep)
+{
+	struct stat sbuf;
+	void *buf;
+	int fd;
+
+	fd = open(fname, O_RDONLY | O_BINARY);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &sbuf) < 0)
+		goto err;
+
+	buf = malloc(sbuf.st_size ? sbuf.st_size : 1);
+	if (!buf)
+		goto err;
+
+	if (read(fd, buf, sbuf.st_size) != sbuf.st_size) {
+		free(buf);
+		goto err;
+	}
+
+	close(fd);
+	*sizep = sbuf.st_size;
+
+	return buf;
+err:
+	close(fd);
+	return NULL;
+}
+
+static void *mblock_map_file(const char *fname, size_t *sizep)
+{
+	struct stat sbuf;
+	void *buf;
+	int fd;
+
+	fd = open(fname, O_RDONLY | O_BINARY);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &sbuf) < 0) {
+		close(fd);
+		return NULL;
+	}
+
+	if (!sbuf.st_size) {
+		close(fd);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	buf = mmap(NULL, sbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (buf == MAP_FAILED)
+		return NULL;
+
+	*sizep = sbuf.st_size;
+
+	return buf;
+}
+
+/* Compress one block with the external tool, using temporary files */
+static void *mblock_compress_block(struct image_tool_params *params,
+				   const char *tool, int index,
+				   const void *in, size_t inn, size_t *outn)
+{
+	char mblock_in[MBLOCK_MAX_TMPFILE_LEN];
+	char mblock_out[MBLOCK_MAX_TMPFILE_LEN];
+	char cmd[MBLOCK_MAX_CMDLINE_LEN];
+	void *out = NULL;
+
+	snprintf(mblock_in, sizeof(mblock_in), "%s.%d.in", mblock_file,
+		 index);
+	snprintf(mblock_out, sizeof(mblock_out), "%s.%d.out", mblock_file,
+		 index);
+
+	if (mblock_write_file(mblock_in, in, inn)) {
+		fprintf(stderr, "%s: Can't write %s: %s\n", params->cmdname,
+			mblock_in, strerror(errno));
+		goto out;
+	}
+
+	snprintf(cmd, sizeof(cmd), "%s -9 -c \"%s\" > \"%s\"", tool,
+		 mblock_in, mblock_out);
+	debug("Trying to execute \"%s\"\n", cmd);
+	if (system(cmd)) {
+		fprintf(stderr, "%s: system(%s) failed\n", params->cmdname,
+			cmd);
+		goto out;
+	}
+
+	out = mblock_read_file(mblock_out, outn);
+out:
+	unlink(mblock_in);
+	unlink(mblock_out);
+
+	return out;
+}
+
+/* The cache file of a block is named by its tool and data */
+static void mblock_cache_name(struct mblock_jobs *jobs, const void *in,
+			      size_t inn, char *name, size_t size)
+{
+	uint8_t sum[SHA256_SUM_LEN];
+	sha256_context ctx;
+	int len, i;
+
+	sha256_starts(&ctx);
+	sha256_update(&ctx, (const uint8_t *)jobs->tool,
+		      strlen(jobs->tool) + 1);
+	sha256_update(&ctx, in, inn);
+	sha256_finish(&ctx, sum);
+
+	len = snprintf(name, size, "%s/mblock-%s-", jobs->cache_dir,
+		       jobs->tool);
+	for (i = 0; i < SHA256_SUM_LEN && len + 3 <= size; i++)
+		len += sprintf(name + len, "%02x", sum[i]);
+}
+
+/*
+ * Add a block to the cache. The file appears under its name complete or not
+ * at all, so builds running at the same time may share the cache.
+ */
+static void mblock_cache_store(const char *name, int index, const void *buf,
+			       size_t size)
+{
+	char tmp[MBLOCK_MAX_CACHEFILE_LEN + 32];
+
+	snprintf(tmp, sizeof(tmp), "%s.%d.%d.tmp", name, (int)getpid(),
+		 index);
+	if (mblock_write_file(tmp, buf, size) || rename(tmp, name))
+		unlink(tmp);
+}
+
+static int mblock_compress_job(void *arg, int index)
+{
+	struct mblock_jobs *jobs = arg;
+	size_t offset = (size_t)index * jobs->block_size;
+	char cache[MBLOCK_MAX_CACHEFILE_LEN];
+	const uint8_t *in = jobs->data + offset;
+	size_t inn = jobs->size - offset;
+
+	if (inn > jobs->block_size)
+		inn = jobs->block_size;
+
+	if (jobs->cache_dir) {
+		mblock_cache_name(jobs, in, inn, cache, sizeof(cache));
+		jobs->blocks[index] = mblock_read_file(cache,
+						       &jobs->lens[index]);
+		if (jobs->blocks[index]) {
+			__sync_fetch_and_add(&jobs->hits, 1);
+			return 0;
+		}
+	}
+
+	jobs->blocks[index] = mblock_compress_block(jobs->params, jobs->tool,
+						    index, in, inn,
+						    &jobs->lens[index]);
+	if (!jobs->blocks[index])
+		return -EIO;
+
+	if (jobs->cache_dir)
+		mblock_cache_store(cache, index, jobs->blocks[index],
+				   jobs->lens[index]);
+
+	return 0;
+}
+
+int mblock_build(struct image_tool_params *params)
+{
+	const char *tool = getenv("MKIMAGE_MBLOCK_COMP");
+	const char *size_kb = getenv("MKIMAGE_MBLOCK_SIZE");
+	struct mblock_jobs jobs;
+	struct mblock_header *hdr;
+	struct mblock_entry *ent;
+	size_t size, block_size, offset, len, pad, cap;
+	void *data, *out;
+	uint32_t i, count;
+	int comp, ret = -1;
+
+	if (strchr(params->datafile, ':')) {
+		fprintf(stderr, "%s: mblock needs a single data file\n",
+			params->cmdname);
+		return -1;
+	}
+
+	data = mblock_map_file(params->datafile, &size);
+	if (!data) {
+		fprintf(stderr, "%s: Can't read %s: %s\n", params->cmdname,
+			params->datafile, strerror(errno));
+		return -1;
+	}
+
+	/* Already a multi-block payload, use as is */
+	if (!mblock_check(data, size)) {
+		munmap(data, size);
+		return 0;
+	}
+
+	if (!tool)
+		tool = MBLOCK_DEFAULT_COMP;
+	if (!strcmp(tool, "lzma")) {
+		comp = IH_COMP_LZMA;
+	} else if (!strcmp(tool, "lz4")) {
+		comp = IH_COMP_LZ4;
+	} else {
+		fprintf(stderr, "%s: MKIMAGE_MBLOCK_COMP must be lzma or lz4\n",
+			params->cmdname);
+		goto err_data;
+	}
+
+	block_size = (size_kb ? strtoul(size_kb, NULL, 0) :
+		      MBLOCK_DEFAULT_SIZE_KB) * 1024;
+	if (!block_size || block_size > UINT32_MAX || size > UINT32_MAX) {
+		fprintf(stderr, "%s: Invalid data or block size for mblock\n",
+			params->cmdname);
+		goto err_data;
+	}
+
+	count = DIV_ROUND_UP(size, block_size);
+	if (count > MBLOCK_MAX_BLOCKS) {
+		fprintf(stderr,
+			"%s: %u blocks, more than %u: increase MKIMAGE_MBLOCK_SIZE\n",
+			params->cmdname, count, MBLOCK_MAX_BLOCKS);
+		goto err_data;
+	}
+
+	if (strlen(params->imagefile) + strlen(MBLOCK_SUFFIX) + 5 >
+	    sizeof(mblock_file)) {
+		fprintf(stderr, "%s: Image file name (%s) too long\n",
+			params->cmdname, params->imagefile);
+		goto err_data;
+	}
+	sprintf(mblock_file, "%s%s", params->imagefile, MBLOCK_SUFFIX);
+	atexit(mblock_cleanup);
+
+	memset(&jobs, '\0', sizeof(jobs));
+	jobs.params = params;
+	jobs.tool = tool;
+	jobs.data = data;
+	jobs.size = size;
+	jobs.block_size = block_size;
+	jobs.cache_dir = getenv("MKIMAGE_CACHE_DIR");
+	if (jobs.cache_dir && (!*jobs.cache_dir ||
+	    strlen(jobs.cache_dir) > MBLOCK_MAX_CACHEFILE_LEN - 128))
+		jobs.cache_dir = NULL;
+	if (jobs.cache_dir)
+		mkdir(jobs.cache_dir, 0777);
+
+	out = NULL;
+	jobs.blocks = calloc(count, sizeof(*jobs.blocks));
+	jobs.lens = calloc(count, sizeof(*jobs.lens));
+	if (!jobs.blocks || !jobs.lens)
+		goto err_out;
+
+	if (imagetool_run_jobs(count, mblock_compress_job, &jobs))
+		goto err_out;
+
+	offset = sizeof(*hdr) + count * sizeof(*ent);
+	cap = offset;
+	for (i = 0; i < count; i++)
+		cap += jobs.lens[i] + MBLOCK_ALIGN;
+	out = calloc(1, cap);
+	if (!out)
+		goto err_out;
+
+	for (i = 0; i < count; i++) {
+		len = jobs.lens[i];
+		ent = out + sizeof(*hdr);
+		ent[i].offset = cpu_to_be32(offset);
+		ent[i].size = cpu_to_be32(len);
+		memcpy(out + offset, jobs.blocks[i], len);
+
+		/* Pad to the alignment of the next block */
+		pad = -len & (MBLOCK_ALIGN - 1);
+		offset += len + pad;
+	}
+
+	hdr = out;
+	hdr->magic = cpu_to_be32(MBLOCK_MAGIC);
+	hdr->comp = comp;
+	hdr->block_size = cpu_to_be32(block_size);
+	hdr->size = cpu_to_be32(size);
+	hdr->count = cpu_to_be32(count);
+
+	if (mblock_write_file(mblock_file, out, offset)) {
+		fprintf(stderr, "%s: Can't write %s: %s\n", params->cmdname,
+			mblock_file, strerror(errno));
+		goto err_out;
+	}
+
+	if (params->vflag)
+		fprintf(stderr,
+			"%s: %u %s blocks of %zu KiB, %zu -> %zu bytes, %d cached\n",
+			params->cmdname, count, tool, block_size >> 10, size,
+			offset, jobs.hits);
+
+	params->datafile = mblock_file;
+	ret = 0;
+
+err_out:
+	if (jobs.blocks) {
+		for (i = 0; i < count; i++)
+			free(jobs.blocks[i]);
+	}
+	free(jobs.blocks);
+	free(jobs.lens);
+	free(out);
+err_data:
+	munmap(data, size);
+
+	return ret;
+}
@@ -317,9 +317,11 @@ int main(int argc, char **argv)
 	int retval = 0;
 	struct image_type_params *tparams = NULL;
 	int pad_len = 0;
+	uint64_t start;
 	int dfd;
 
 	params.cmdname = *argv;
+	imagetool_time_init(params.cmdname);
 	params.addr = 0;
 	params.ep = 0;
 
@@ -348,6 +350,15 @@ int main(int argc, char **argv)
 			params.ep += tparams->header_size;
 	}
 
+	/* Compress the data file in blocks before it is used below */
+	if (params.comp == IH_COMP_MBLOCK && params.datafile &&
+	    !params.lflag) {
+		start = imagetool_time_us();
+		if (mblock_build(&params))
+			exit(EXIT_FAILURE);
+		imagetool_time_add("mblock", start);
+	}
+
 	if (params.fflag){
 		if (tparams->fflag_handle)
 			/*
@@ -408,8 +419,10 @@ int main(int argc, char **argv)
 		 * Print the image information for matched image type
 		 * Returns the error code if not matched
 		 */
+		start = imagetool_time_us();
 		retval = imagetool_verify_print_header(ptr, &sbuf,
 				tparams, &params);
+		imagetool_time_add("print", start);
 
 		(void) munmap((void *)ptr, sbuf.st_size);
 		(void) close (ifd);
@@ -443,6 +456,7 @@ int main(int argc, char **argv)
 	 * function is called. This is responsible to
 	 * allocate memory for the header itself.
 	 */
+	start = imagetool_time_us();
 	if (tparams->vrec_header)
 		pad_len = tparams->vrec_header(&params, tparams);
 	else
@@ -558,7 +572,10 @@ int main(int argc, char **argv)
 		}
 	}
 
+	imagetool_time_add("copy", start);
+
 	/* We're a bit of paranoid */
+	start = imagetool_time_us();
 #if defined(_POSIX_SYNCHRONIZED_IO) && \
    !defined(__sun__) && \
    !defined(__FreeBSD__) && \
@@ -568,6 +585,7 @@ int main(int argc, char **argv)
 #else
 	(void) fsync (ifd);
 #endif
+	imagetool_time_add("sync", start);
 
 	if (fstat(ifd, &sbuf) < 0) {
 		fprintf (stderr, "%s: Can't stat %s: %s\n",
@@ -584,6 +602,7 @@ int main(int argc, char **argv)
 	}
 
 	/* Setup the image header as per input image type*/
+	start = imagetool_time_us();
 	if (tparams->set_header)
 		tparams->set_header (ptr, &sbuf, ifd, &params);
 	else {
@@ -592,7 +611,10 @@ int main(int argc, char **argv)
 		exit (EXIT_FAILURE);
 	}
 
+	imagetool_time_add("header", start);
+
 	/* Print the image information by processing image header */
+	start = imagetool_time_us();
 	if (tparams->print_header)
 		tparams->print_header (ptr);
 	else {
@@ -600,9 +622,12 @@ int main(int argc, char **argv)
 			params.cmdname, tparams->name);
 	}
 
+	imagetool_time_add("print", start);
+
 	(void) munmap((void *)ptr, sbuf.st_size);
 
 	/* We're a bit of paranoid */
+	start = imagetool_time_us();
 #if defined(_POSIX_SYNCHRONIZED_IO) && \
    !defined(__sun__) && \
    !defined(__FreeBSD__) && \
@@ -612,6 +637,7 @@ int main(int argc, char **argv)
 #else
 	(void) fsync (ifd);
 #endif
+	imagetool_time_add("sync", start);
 
 	if (close(ifd)) {
 		fprintf (stderr, "%s: Write error on %s: %s\n",
@@ -0,0 +1,257 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-2.0+
+#
+# Send a file to U-Boot with the serial stream protocol
+#
+# See include/serial_stream.h for the protocol. Start the transfer on the
+# target first (the "Serial stream" load method of mtkupgrade, or the
+# emergency mode of SPL), close the terminal program, then run:
+#
+#   serial_stream.py [-b console_baud] [-m max_baud] <port> <file>
+#
+# The link is switched to the highest rate up to max_baud the target
+# agrees to. If the target does not hear us at that rate, lower rates are
+# tried. Needs pyserial.
+
+import argparse
+import struct
+import sys
+import time
+import zlib
+
+import serial
+
+SYNC = b'\xa5\x5a'
+MAX_DATA = 1024
+
+HELLO = 0x01
+SYNC_FRAME = 0x02
+START = 0x03
+DATA = 0x04
+END = 0x05
+ABORT = 0x06
+ACK = 0x80
+NAK = 0x81
+ERR = 0x82
+
+# Sent to a Ymodem receiver (SPL tries both protocols) to make it give up
+CAN = b'\x18' * 5
+
+HELLO_INTERVAL = 0.25
+SYNC_INTERVAL = 0.1
+SYNC_TIME = 1.2
+SWITCH_TIMEOUT = 1.5
+NAK_HOLDOFF = 0.3
+
+
+def crc32(data):
+    return zlib.crc32(data) & 0xffffffff
+
+
+def make_frame(ftype, arg, payload=b''):
+    body = struct.pack('>BBIH', ftype, 0, arg, len(payload)) + payload
+    return SYNC + body + struct.pack('>I', crc32(body))
+
+
+def parse_reply(line):
+    """Decode a reply line of the target, None if it is console output"""
+    idx = line.rfind(b'#')
+    if idx < 0:
+        return None
+
+    text = line[idx + 1:].strip()
+    if len(text) != 24:
+        return None
+
+    try:
+        raw = bytes.fromhex(text.decode('ascii'))
+    except ValueError:
+        return None
+
+    ftype, _, arg, _ = struct.unpack('>BBIH', raw[:8])
+    if struct.unpack('>I', raw[8:])[0] != crc32(raw[:8]):
+        return None
+
+    return ftype, arg
+
+
+class Target:
+    def __init__(self, port, baud, verbose):
+        self.ser = serial.Serial(port, baud, timeout=0)
+        self.verbose = verbose
+        self.buf = b''
+        self.saw_c = False
+
+    def set_baud(self, baud):
+        self.ser.flush()
+        self.ser.baudrate = baud
+        self.buf = b''
+
+    def send(self, ftype, arg, payload=b''):
+        self.ser.write(make_frame(ftype, arg, payload))
+
+    def replies(self, wait=0):
+        """Return the replies received so far, waiting up to @wait seconds
+        for some input"""
+        self.ser.timeout = wait
+        data = self.ser.read(max(self.ser.in_waiting, 1))
+        if not data:
+            return []
+
+        if b'C' in data:
+            self.saw_c = True
+
+        self.buf += data
+        out = []
+        while b'\n' in self.buf:
+            line, self.buf = self.buf.split(b'\n', 1)
+            reply = parse_reply(line)
+            if reply:
+                out.append(reply)
+            elif self.verbose:
+                sys.stderr.write('target: %s\n' %
+                                 line.decode('ascii', 'replace').rstrip())
+        return out
+
+    def wait(self, timeout, types):
+        deadline = time.time() + timeout
+        while True:
+            left = deadline - time.time()
+            if left <= 0:
+                return None
+            for reply in self.replies(min(left, 0.05)):
+                if reply[0] in types:
+                    return reply
+
+
+def negotiate(tgt, console_baud, max_baud):
+    limit = max_baud
+    while True:
+        tgt.set_baud(console_baud)
+        print('Waiting for the target at %d baud...' % console_baud)
+
+        reply = None
+        while not reply:
+            if tgt.saw_c:
+                tgt.ser.write(CAN)
+                tgt.saw_c = False
+            tgt.send(HELLO, limit)
+            reply = tgt.wait(HELLO_INTERVAL, (ACK,))
+
+        baud = reply[1]
+        if baud == console_baud:
+            return baud
+
+        tgt.set_baud(baud)
+        deadline = time.time() + SYNC_TIME
+        while time.time() < deadline:
+            tgt.send(SYNC_FRAME, 0)
+            if tgt.wait(SYNC_INTERVAL, (ACK,)):
+                return baud
+
+        print('No answer at %d baud, trying a lower rate' % baud)
+        # Let the target give up on the new rate too
+        time.sleep(SWITCH_TIMEOUT - SYNC_TIME + 0.2)
+        limit = baud - 1
+
+
+def start(tgt, size):
+    for _ in range(10):
+        tgt.send(START, size)
+        reply = tgt.wait(0.5, (ACK, ERR))
+        if not reply:
+            continue
+        if reply[0] == ERR:
+            sys.exit('The file is too large, the target takes up to %d bytes'
+                     % reply[1])
+        return
+    sys.exit('The target does not answer')
+
+
+def transfer(tgt, data):
+    size = len(data)
+    pos = 0
+    last_nak = (-1, 0)
+    retries = 0
+    end_tries = 0
+    t0 = time.time()
+    shown = 0
+
+    while True:
+        while pos < size:
+            chunk = data[pos:pos + MAX_DATA]
+            tgt.send(DATA, pos, chunk)
+            pos += len(chunk)
+
+            for ftype, arg in tgt.replies():
+                if ftype != NAK or arg > size:
+                    continue
+                # Frames already on their way cause repeated NAKs
+                now = time.time()
+                if arg == last_nak[0] and now - last_nak[1] < NAK_HOLDOFF:
+                    continue
+                last_nak = (arg, now)
+                pos = arg
+                retries += 1
+
+            now = time.time()
+            if now - shown >= 0.5:
+                shown = now
+                sys.stdout.write('\r%3d%% %8d KiB %7.1f KiB/s' %
+                                 (pos * 100 // size, pos >> 10,
+                                  pos / 1024 / max(now - t0, 1e-3)))
+                sys.stdout.flush()
+
+        tgt.send(END, size, struct.pack('>I', crc32(data)))
+        reply = tgt.wait(1.0, (ACK, NAK))
+        if reply and reply[0] == ACK and reply[1] == size:
+            break
+        if reply and reply[0] == NAK:
+            pos = reply[1]
+            retries += 1
+            continue
+
+        end_tries += 1
+        if end_tries > 5:
+            sys.exit('\nThe target does not answer')
+
+    elapsed = time.time() - t0
+    print('\r100%% %8d KiB in %.1f s, %.1f KiB/s, %d retries' %
+          (size >> 10, elapsed, size / 1024 / max(elapsed, 1e-3), retries))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Send a file to U-Boot over the serial console')
+    parser.add_argument('port', help='serial port, e.g. /dev/ttyUSB0')
+    parser.add_argument('file', help='file to send')
+    parser.add_argument('-b', '--baud', type=int, default=115200,
+                        help='console baud rate (default: %(default)s)')
+    parser.add_argument('-m', '--max-baud', type=int, default=921600,
+                        help='highest baud rate to use (default: %(default)s)')
+    parser.add_argument('-v', '--verbose', action='store_true',
+                        help='show the console output of the target')
+    args = parser.parse_args()
+
+    with open(args.file, 'rb') as f:
+        data = f.read()
+    if not data:
+        sys.exit('%s is empty' % args.file)
+
+    tgt = Target(args.port, args.baud, args.verbose)
+    try:
+        baud = negotiate(tgt, args.baud, args.max_baud)
+        print('Sending %s (%d bytes) at %d baud' % (args.file, len(data),
+                                                   baud))
+        start(tgt, len(data))
+        transfer(tgt, data)
+    except KeyboardInterrupt:
+        tgt.send(ABORT, 0)
+        tgt.ser.flush()
+        sys.exit('\nAborted')
+    finally:
+        tgt.set_baud(args.baud)
+
+
+if __name__ == '__main__':
+    main()